@@ -23,6 +23,7 @@ set(OCPN_RELEASE_REPO
     "opencpn/vdr-prod"
     CACHE STRING "Default repository for tagged builds not matching 'beta'"
 )
+option(VDR_BUILD_TOOLS "Build command line tools like dm2vdr" OFF)
 
 #
 #
@@ -65,6 +66,42 @@ set(SRC
   src/record_play_mgr.cpp
   src/dm_replay_mgr.h
   src/dm_replay_mgr.cpp
+  src/dm_decoder.h
+  src/dm_decoder.cpp
+  src/dm_converter.h
+  src/dm_converter.cpp
+  src/file_path.h
+  src/file_path.cpp
+  src/file_sniffer.h
+  src/file_sniffer.cpp
+  src/record_clock.h
+  src/record_clock.cpp
+  src/record_decimator.h
+  src/record_decimator.cpp
+  src/record_dedup.h
+  src/record_dedup.cpp
+  src/record_formatter.h
+  src/record_formatter.cpp
+  src/speed_tracker.h
+  src/speed_tracker.cpp
+  src/pre_record_buffer.h
+  src/pre_record_buffer.cpp
+  src/record_writer.h
+  src/record_writer.cpp
+  src/n2k_encoder.h
+  src/n2k_encoder.cpp
+  src/n2k_ingest.h
+  src/n2k_ingest.cpp
+  src/replay_engine.h
+  src/replay_engine.cpp
+  src/replay_fanout.h
+  src/replay_fanout.cpp
+  src/replay_sinks.h
+  src/replay_sinks.cpp
+  src/replay_stats.h
+  src/replay_stats.cpp
+  src/vdr_decoders.h
+  src/vdr_decoders.cpp
 )
 
 set(PKG_API_LIB api-18)  #  A directory in libs/ e. g., api-18 or api-19
@@ -76,8 +113,13 @@ macro(add_plugin_libraries)
   target_link_libraries(${PACKAGE_NAME} ocpn::filesystem)
   add_subdirectory(${CMAKE_SOURCE_DIR}/opencpn-libs/plugin_dc)
   target_link_libraries(${PACKAGE_NAME} ocpn::plugin-dc)
+  add_subdirectory(${CMAKE_SOURCE_DIR}/opencpn-libs/wxJSON)
+  target_link_libraries(${PACKAGE_NAME} ocpn::wxjson)
   if (BUILD_TESTING)
     enable_testing()
     add_subdirectory(${CMAKE_SOURCE_DIR}/test)
   endif ()
+  if (VDR_BUILD_TOOLS)
+    add_subdirectory(${CMAKE_SOURCE_DIR}/tools)
+  endif ()
 endmacro ()
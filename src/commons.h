@@ -27,6 +27,14 @@ enum class ReplayMode {
   kLoopback      // Use WriteCommDriver() on loopback driver
 };
 
+/** Network output framing of replayed NMEA 2000 messages. */
+enum class N2kNetFormat {
+  kText,       //!< Forward text formats ($PCDIN, $MXPGN, ...) unmodified
+  kActisense,  //!< Actisense N2K binary (BST 0x93, DLE framed)
+  kYdRaw,      //!< Yacht Devices RAW, one line per CAN frame
+  kSocketCan   //!< Linux SocketCAN struct can_frame, 16 bytes per frame
+};
+
 /**
  * Network settings for protocol output.
  */
@@ -65,12 +73,16 @@ struct VdrProtocolSettings {
   ConnectionSettings signalkNet;   //!< Signal K connection settings
 
   ReplayMode replay_mode;
+  N2kNetFormat n2k_format;  //!< NMEA 2000 network output framing
+  bool relay_while_recording;  //!< Relay recorded data to network servers
 
   VdrProtocolSettings()
       : nmea0183(true),
         nmea2000(false),
         signalK(false),
-        replay_mode(ReplayMode::kInternalApi)
+        replay_mode(ReplayMode::kInternalApi),
+        n2k_format(N2kNetFormat::kText),
+        relay_while_recording(false)
   // nmea0183ReplayMode(NMEA0183ReplayMode::INTERNAL_API)
   {}
 };
@@ -0,0 +1,283 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement dm_converter.h
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#include "dm_converter.h"
+#include "file_path.h"
+#include "n2k_encoder.h"
+#include "record_formatter.h"
+#include "std_filesystem.h"
+
+/** Header line of VDR CSV recordings, as written when recording. */
+static const char* const kCsvHeader = "timestamp,type,id,message\n";
+
+/**
+ * Append record as a VDR CSV line to out.
+ * @return false if record cannot be converted, out is then unchanged.
+ */
+static bool AppendRecord(const ReplayRecord& record,
+                         RecordFormatter& formatter, std::string& out) {
+  // Actisense header, data and some slack for separators.
+  constexpr size_t kMaxHexLen = 2 * 256;
+
+  if (record.stamp == 0) return false;
+  const ReplayMessage& msg = record.msg;
+  const char* begin = msg.text.data();
+  const char* end = begin + msg.text.size();
+  while (begin < end && std::isspace(static_cast<unsigned char>(*begin)))
+    begin++;
+  while (end > begin && std::isspace(static_cast<unsigned char>(end[-1])))
+    end--;
+  if (begin == end) return false;
+
+  switch (msg.type) {
+    case ReplayMsgType::kN2k: {
+      // Hex encoded GetN2000Payload() bytes, possibly space separated.
+      char hex[kMaxHexLen];
+      size_t len = 0;
+      for (const char* p = begin; p < end; ++p) {
+        const auto c = static_cast<unsigned char>(*p);
+        if (std::isspace(c)) continue;
+        if (!std::isxdigit(c) || len == sizeof(hex)) return false;
+        hex[len++] = static_cast<char>(std::toupper(c));
+      }
+      N2kMessage n2k;
+      if (!ParseOcpnN2kHex(hex, len, n2k)) return false;
+      formatter.AppendTime(record.stamp, out);
+      out += ",NMEA2000,";
+      RecordFormatter::AppendDecimal(n2k.pgn, out);
+      out += ',';
+      out.append(hex, len);
+      out += '\n';
+      return true;
+    }
+    case ReplayMsgType::kNmea0183:
+      formatter.AppendNmea0183Csv(record.stamp, begin, end - begin, out);
+      break;
+    case ReplayMsgType::kSignalK:
+      formatter.AppendSignalKCsv(record.stamp, begin, end - begin, out);
+      break;
+  }
+  return true;
+}
+
+DataMonitorConverter::DataMonitorConverter(const std::string& src,
+                                           const std::string& dest,
+                                           VdrMsgCallback vdr_message)
+    : m_src(src),
+      m_dest(dest),
+      m_vdr_message(std::move(vdr_message)),
+      m_threads(0),
+      m_chunk_size(kDefaultChunkSize),
+      m_written(0),
+      m_window(1),
+      m_next_chunk(0),
+      m_input_done(0),
+      m_input_size(0),
+      m_cancelled(false),
+      m_done(false),
+      m_ok(false),
+      m_converted(0),
+      m_skipped(0) {}
+
+DataMonitorConverter::~DataMonitorConverter() {
+  if (m_thread.joinable()) {
+    Cancel();
+    m_thread.join();
+  }
+}
+
+void DataMonitorConverter::Start() {
+  if (m_thread.joinable()) return;
+  m_done = false;
+  m_thread = std::thread([this] { Run(); });
+}
+
+void DataMonitorConverter::Cancel() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cancelled = true;
+  }
+  m_cv.notify_all();
+}
+
+double DataMonitorConverter::GetProgress() const {
+  if (m_done) return 1.0;
+  if (m_input_size == 0) return 0;
+  return static_cast<double>(m_input_done) / m_input_size;
+}
+
+void DataMonitorConverter::Message(VdrMsgType type, const std::string& msg) {
+  std::lock_guard<std::mutex> lock(m_message_mutex);
+  m_vdr_message(type, msg);
+}
+
+bool DataMonitorConverter::Run() {
+  m_converted = 0;
+  m_skipped = 0;
+  m_input_done = 0;
+  FileSniff sniff;
+  if (!SniffFile(m_src, sniff)) {
+    Message(VdrMsgType::kInfo, "Cannot read " + m_src);
+    m_ok = false;
+    m_done = true;
+    return false;
+  }
+  const std::string tmp_path = m_dest + ".tmp";
+  std::FILE* out = OpenStdioFile(tmp_path, "wb");
+  if (!out) {
+    Message(VdrMsgType::kInfo, "Cannot create " + tmp_path);
+    m_ok = false;
+    m_done = true;
+    return false;
+  }
+
+  const uint64_t size = sniff.size;
+  m_input_size = size;
+  m_chunks.clear();
+  for (uint64_t begin = 0; begin < size; begin += m_chunk_size) {
+    m_chunks.emplace_back(begin, std::min(begin + m_chunk_size, size));
+  }
+  // An empty file is still checked for a valid header.
+  if (m_chunks.empty()) m_chunks.emplace_back(0, 0);
+  unsigned threads = m_threads;
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  threads = static_cast<unsigned>(
+      std::max<size_t>(1, std::min<size_t>(threads, m_chunks.size())));
+  m_written = 0;
+  m_window = 2 * threads;
+  m_next_chunk = 0;
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; ++i) {
+    workers.emplace_back([this, &sniff] { Work(sniff); });
+  }
+
+  ReplayIndex index;
+  uint64_t out_size = std::strlen(kCsvHeader);
+  bool ok = std::fputs(kCsvHeader, out) >= 0;
+  for (size_t i = 0; ok && i < m_chunks.size(); ++i) {
+    Chunk& chunk = m_chunks[i];
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [&] { return chunk.done || m_cancelled; });
+    }
+    if (!chunk.done) {
+      ok = false;
+      break;
+    }
+    if (std::fwrite(chunk.text.data(), 1, chunk.text.size(), out) !=
+        chunk.text.size()) {
+      Message(VdrMsgType::kInfo, "Write error on " + tmp_path);
+      ok = false;
+      break;
+    }
+    index.Append(chunk.index, out_size);
+    out_size += chunk.text.size();
+    m_converted += chunk.converted;
+    m_skipped += chunk.skipped;
+    std::string().swap(chunk.text);  // Release memory
+    m_input_done += chunk.end - chunk.begin;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_written = i + 1;
+    }
+    m_cv.notify_all();
+  }
+  if (!ok) Cancel();  // Stop workers
+  for (auto& worker : workers) worker.join();
+  // A failed chunk or user abort may come after the last chunk is done.
+  ok = ok && !m_cancelled;
+  if (std::fclose(out) != 0) ok = false;
+
+  std::error_code ec;
+  const std::string index_path = ReplayIndex::GetPath(m_dest);
+  if (ok) {
+    // An index left by an earlier conversion must not outlive its dest.
+    fs::remove(ToFsPath(index_path), ec);
+    fs::rename(ToFsPath(tmp_path), ToFsPath(m_dest), ec);
+    if (ec) {
+      Message(VdrMsgType::kInfo,
+              "Cannot create " + m_dest + ": " + ec.message());
+      ok = false;
+    }
+  }
+  if (ok && !index.Save(index_path, out_size)) {
+    Message(VdrMsgType::kInfo, "Cannot create " + index_path);
+    fs::remove(ToFsPath(index_path), ec);
+  }
+  if (!ok) fs::remove(ToFsPath(tmp_path), ec);
+  m_chunks.clear();
+  m_ok = ok;
+  m_done = true;
+  return ok;
+}
+
+void DataMonitorConverter::Work(const FileSniff& sniff) {
+  for (;;) {
+    const size_t i = m_next_chunk++;
+    if (i >= m_chunks.size()) return;
+    {
+      // Bound memory use when the output is slower than the workers.
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [&] { return i < m_written + m_window || m_cancelled; });
+    }
+    if (m_cancelled) return;
+    if (!ConvertChunk(sniff, m_chunks[i])) {
+      Cancel();  // Wake up the writer, which fails the conversion
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_chunks[i].done = true;
+    }
+    m_cv.notify_all();
+  }
+}
+
+bool DataMonitorConverter::ConvertChunk(const FileSniff& sniff,
+                                        Chunk& chunk) {
+  DataMonitorDecoder decoder(
+      sniff, [this](VdrMsgType type, const std::string& msg) {
+        Message(type, msg);
+      });
+  // Bad header, already reported.
+  if (!decoder.Open(chunk.begin)) return false;
+  chunk.text.reserve(chunk.end - chunk.begin);
+  RecordFormatter formatter;
+  ReplayRecord record;
+  while (!m_cancelled && decoder.Read(record) && record.offset < chunk.end) {
+    const size_t offset = chunk.text.size();
+    if (AppendRecord(record, formatter, chunk.text)) {
+      chunk.index.Add(record.stamp, offset);
+      chunk.converted += 1;
+    } else {
+      chunk.skipped += 1;
+    }
+  }
+  return !m_cancelled;
+}
@@ -0,0 +1,163 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Offline conversion of Data Monitor VDR mode logs to the plugin's own CSV
+ * recording format, which is played and seeked by the main playback path
+ * without a loopback driver. A sidecar ReplayIndex is written along with
+ * the recording, so it is seeked without scanning it first. Used by the
+ * plugin as a background task and by the dm2vdr command line tool.
+ */
+
+#ifndef DM_CONVERTER_H_
+#define DM_CONVERTER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dm_decoder.h"
+
+/**
+ * Convert a Data Monitor log to a VDR CSV recording. The input is split in
+ * chunks at line boundaries which are decoded and formatted by a pool of
+ * worker threads, the output is written in chunk order by a single thread.
+ * The output index, see ReplayIndex::GetPath(), is merged from the chunk
+ * indexes by the same thread.
+ *
+ * Records without a valid timestamp and NMEA 2000 records which cannot be
+ * decoded are skipped and counted, see GetSkipped().
+ */
+class DataMonitorConverter {
+public:
+  /** Default input chunk size handled by a worker at a time. */
+  static constexpr uint64_t kDefaultChunkSize = 4 * 1024 * 1024;
+
+  /**
+   * @param src Log file created by Data Monitor in VDR mode.
+   * @param dest Output VDR CSV file, replaced if it exists.
+   * @param vdr_message Callback handling user info, invoked from worker
+   *     threads. Calls are serialized.
+   */
+  DataMonitorConverter(const std::string& src, const std::string& dest,
+                       VdrMsgCallback vdr_message);
+
+  /** Cancel and wait for a conversion started by Start(). */
+  ~DataMonitorConverter();
+
+  DataMonitorConverter(const DataMonitorConverter&) = delete;
+  DataMonitorConverter& operator=(const DataMonitorConverter&) = delete;
+
+  /** Set number of worker threads, 0 means one per hardware thread. */
+  void SetThreads(unsigned threads) { m_threads = threads; }
+
+  /** Set input chunk size, mostly useful for tests. */
+  void SetChunkSize(uint64_t size) { m_chunk_size = size ? size : 1; }
+
+  /**
+   * Convert in calling thread. The output is written to a temporary file
+   * renamed to dest when complete, dest is not touched on errors. A
+   * missing index is not an error, dest is then scanned when played.
+   * @return true if output was successfully written.
+   */
+  bool Run();
+
+  /**
+   * Run() in a background thread, poll using IsDone(). A converter is
+   * only used once, by either Run() or Start().
+   */
+  void Start();
+
+  /** Stop conversion as soon as possible, making it fail. */
+  void Cancel();
+
+  [[nodiscard]] bool IsDone() const { return m_done; }
+
+  /** Return result of Run(), valid when IsDone(). */
+  [[nodiscard]] bool IsOk() const { return m_ok; }
+
+  /** Return how much of the input is converted, between 0 and 1. */
+  [[nodiscard]] double GetProgress() const;
+
+  /** Return number of records written, valid when IsDone(). */
+  [[nodiscard]] uint64_t GetConverted() const { return m_converted; }
+
+  /** Return number of records skipped, valid when IsDone(). */
+  [[nodiscard]] uint64_t GetSkipped() const { return m_skipped; }
+
+private:
+  /** A part of the input, converted by one worker. */
+  struct Chunk {
+    uint64_t begin;      //!< First input offset
+    uint64_t end;        //!< Offset after last input byte
+    std::string text;    //!< Converted output
+    ReplayIndex index;   //!< Records in text, offsets relative to text
+    uint64_t converted;  //!< Number of records in text
+    uint64_t skipped;    //!< Number of records dropped
+    bool done;           //!< Conversion is complete
+
+    Chunk(uint64_t b, uint64_t e)
+        : begin(b), end(e), converted(0), skipped(0), done(false) {}
+  };
+
+  /**
+   * Convert chunks until there are no more, worker thread body.
+   * @param sniff Input file head, shared by all workers.
+   */
+  void Work(const FileSniff& sniff);
+
+  /**
+   * Decode and format records starting in chunk into chunk.text.
+   * @return false if conversion failed or was cancelled.
+   */
+  bool ConvertChunk(const FileSniff& sniff, Chunk& chunk);
+
+  /** Thread safe m_vdr_message wrapper. */
+  void Message(VdrMsgType type, const std::string& msg);
+
+  const std::string m_src;
+  const std::string m_dest;
+  const VdrMsgCallback m_vdr_message;
+  unsigned m_threads;
+  uint64_t m_chunk_size;
+  std::thread m_thread;  //!< Background thread started by Start()
+
+  std::mutex m_message_mutex;  //!< Serializes m_vdr_message calls
+
+  std::mutex m_mutex;  //!< Guards m_chunks and m_written
+  std::condition_variable m_cv;
+  std::vector<Chunk> m_chunks;
+  size_t m_written;  //!< Number of chunks written to output
+  size_t m_window;   //!< Max number of chunks converted but not written
+
+  std::atomic<size_t> m_next_chunk;  //!< Next chunk to be converted
+  std::atomic<uint64_t> m_input_done;  //!< Input bytes written to output
+  std::atomic<uint64_t> m_input_size;
+  std::atomic<bool> m_cancelled;
+  std::atomic<bool> m_done;
+  std::atomic<bool> m_ok;
+  std::atomic<uint64_t> m_converted;
+  std::atomic<uint64_t> m_skipped;
+};
+
+#endif  // DM_CONVERTER_H_
@@ -0,0 +1,611 @@
+/***************************************************************************
+ *   Copyright (C) 2025 Alec Leamas                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement dm_decoder.h
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#include <wx/intl.h>
+#include <wx/string.h>
+
+#include "dm_decoder.h"
+#include "file_path.h"
+
+/** Skip spaces, return pointer to first non-space or end. */
+static const char* SkipSpace(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t')) ++p;
+  return p;
+}
+
+/**
+ * Parse an unsigned decimal number of at most max_digits digits.
+ * @return Pointer past the number, nullptr if there are no digits.
+ */
+static const char* ParseNumber(const char* p, const char* end, int max_digits,
+                               int& value) {
+  const char* begin = p;
+  value = 0;
+  for (; p < end && p - begin < max_digits && *p >= '0' && *p <= '9'; ++p)
+    value = value * 10 + (*p - '0');
+  return p == begin ? nullptr : p;
+}
+
+/**
+ * Parse a "Created at:" header timestamp in C locale asctime() format like
+ * "Mon Jan  6 09:00:00 2025" as local time. Does not use locales and does
+ * not allocate.
+ * @return false if text cannot be parsed.
+ */
+static bool ParseTimeStamp(const char* p, const char* end, uint64_t& ms) {
+  static const char* const kMonths = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+  std::tm tm{};
+  p = SkipSpace(p, end);
+  if (end - p < 4) return false;
+  p += 3;  // Weekday, redundant
+  p = SkipSpace(p, end);
+  if (end - p < 3) return false;
+  tm.tm_mon = -1;
+  for (int m = 0; m < 12; ++m) {
+    const char* name = kMonths + 3 * m;
+    auto equal = [](char c1, char c2) {
+      return std::tolower(static_cast<unsigned char>(c1)) ==
+             std::tolower(static_cast<unsigned char>(c2));
+    };
+    if (equal(p[0], name[0]) && equal(p[1], name[1]) && equal(p[2], name[2])) {
+      tm.tm_mon = m;
+      break;
+    }
+  }
+  if (tm.tm_mon < 0) return false;
+  p = SkipSpace(p + 3, end);
+  if (!(p = ParseNumber(p, end, 2, tm.tm_mday))) return false;
+  p = SkipSpace(p, end);
+  if (!(p = ParseNumber(p, end, 2, tm.tm_hour)) || p == end || *p++ != ':')
+    return false;
+  if (!(p = ParseNumber(p, end, 2, tm.tm_min)) || p == end || *p++ != ':')
+    return false;
+  if (!(p = ParseNumber(p, end, 2, tm.tm_sec))) return false;
+  p = SkipSpace(p, end);
+  if (!(p = ParseNumber(p, end, 4, tm.tm_year))) return false;
+  if (tm.tm_mday < 1 || tm.tm_mday > 31 || tm.tm_hour > 23 ||
+      tm.tm_min > 59 || tm.tm_sec > 60) {
+    return false;
+  }
+  tm.tm_year -= 1900;
+  tm.tm_isdst = -1;  // Let mktime() figure out DST
+  const std::time_t t = std::mktime(&tm);
+  if (t == static_cast<std::time_t>(-1)) return false;
+  ms = static_cast<uint64_t>(t) * 1000;
+  return true;
+}
+
+/** Position file at offset, supporting files larger than 2 GB. */
+static bool SeekFile(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+/**
+ * Parse leading decimal digits in [begin, end) as a millisecond timestamp.
+ * Digits after the 18th are not consumed, which avoids overflow.
+ * @return Pointer to first byte after digits, begin if there are none.
+ */
+static const char* ParseMillis(const char* begin, const char* end,
+                               uint64_t& ms) {
+  constexpr int kMaxDigits = 18;
+  ms = 0;
+  const char* p = begin;
+  for (; p < end && p - begin < kMaxDigits && *p >= '0' && *p <= '9'; ++p)
+    ms = ms * 10 + (*p - '0');
+  return p;
+}
+
+/**
+ * Byte source reading from file filtering blank and comment lines away.
+ *
+ * The file is read in large blocks. Filtering is done in a single pass
+ * while copying from the block to the decoder's buffer, nothing else is
+ * copied or allocated.
+ *
+ * The decoder reads ahead of the rows it returns. The file offsets of the
+ * lines returned by read() are kept until GetLineOffset() is invoked,
+ * allowing exact progress reports.
+ */
+class DataMonitorDecoder::FilteredByteSource {
+public:
+  /**
+   * @param path File to read.
+   * @param offset Start position in file. If not 0 the line containing
+   *     offset - 1 is skipped, i.e., reading starts at the first line
+   *     starting at offset or later.
+   * @param prefix Text returned before file contents, typically the CSV
+   *     header line when starting in the middle of a file.
+   * @param sniff Head of file, used instead of reading it again when
+   *     offset is 0. The file is not opened if the head is complete.
+   */
+  FilteredByteSource(const std::string& path, uint64_t offset,
+                     const std::string& prefix, const FileSniff& sniff)
+      : m_file(nullptr),
+        m_block(kBlockSize),
+        m_block_offset(offset > 0 ? offset - 1 : 0),
+        m_pos(0),
+        m_end(0),
+        m_state(offset > 0 ? State::kComment : State::kLineStart),
+        m_prefix(prefix),
+        m_prefix_pos(0),
+        m_line_offsets(kInitialLines),
+        m_first_line(1),
+        m_next_line(1),
+        m_read_offset(offset) {
+    static_assert(kBlockSize >= FileSniff::kHeadSize, "Head too large");
+    uint64_t file_offset = m_block_offset;
+    if (offset == 0) {
+      std::memcpy(m_block.data(), sniff.head.data(), sniff.head.size());
+      m_end = sniff.head.size();
+      file_offset = m_end;
+    }
+    if (offset > 0 || !sniff.IsComplete()) {
+      m_file = OpenStdioFile(path, "rb");
+    }
+    if (m_file && file_offset > 0 && !SeekFile(m_file, file_offset)) {
+      std::fclose(m_file);
+      m_file = nullptr;
+    }
+    if (!m_prefix.empty()) {
+      if (m_prefix.back() != '\n') m_prefix += '\n';
+      m_new_lines.push_back(offset);
+    }
+  }
+
+  ~FilteredByteSource() {
+    if (m_file) std::fclose(m_file);
+  }
+
+  FilteredByteSource(const FilteredByteSource&) = delete;
+  FilteredByteSource& operator=(const FilteredByteSource&) = delete;
+
+  /** Read at most count filtered bytes, return number read. */
+  size_t Read(char* returned, size_t count) {
+    char* out = returned;
+    char* const out_end = returned + count;
+    if (m_prefix_pos < m_prefix.size()) {
+      auto count = std::min(m_prefix.size() - m_prefix_pos,
+                            static_cast<size_t>(out_end - out));
+      std::memcpy(out, m_prefix.data() + m_prefix_pos, count);
+      m_prefix_pos += count;
+      out += count;
+    }
+    while (out < out_end) {
+      if (m_pos == m_end && !FillBlock()) {
+        // Terminate a last line lacking newline.
+        if (m_state == State::kInLine) {
+          *out++ = '\n';
+          m_state = State::kLineStart;
+        }
+        break;
+      }
+      const char* in = m_block.data() + m_pos;
+      const char* const in_end = m_block.data() + m_end;
+      switch (m_state) {
+        case State::kLineStart:
+          // Drop leading whitespace, blank lines included.
+          while (in < in_end &&
+                 std::isspace(static_cast<unsigned char>(*in))) {
+            in++;
+          }
+          if (in < in_end) {
+            if (*in == '#') {
+              m_state = State::kComment;
+            } else {
+              m_state = State::kInLine;
+              m_new_lines.push_back(m_block_offset + (in - m_block.data()));
+            }
+          }
+          break;
+        case State::kComment: {
+          auto nl =
+              static_cast<const char*>(std::memchr(in, '\n', in_end - in));
+          in = nl ? nl + 1 : in_end;
+          if (nl) m_state = State::kLineStart;
+          break;
+        }
+        case State::kInLine: {
+          auto count = std::min(in_end - in, out_end - out);
+          auto nl = static_cast<const char*>(std::memchr(in, '\n', count));
+          if (nl) {
+            count = nl - in + 1;
+            m_state = State::kLineStart;
+          }
+          std::memcpy(out, in, count);
+          out += count;
+          in += count;
+          break;
+        }
+      }
+      m_pos = in - m_block.data();
+    }
+    PublishLineOffsets();
+    return out - returned;
+  }
+
+  /**
+   * Return file offset of given line as counted by the decoder, first
+   * line is 1. Offsets of earlier lines are discarded, lines must be
+   * queried in increasing order.
+   */
+  uint64_t GetLineOffset(uint64_t line) {
+    if (line >= m_next_line) return m_read_offset;
+    m_first_line = std::max(m_first_line, line);
+    return m_line_offsets[(line - 1) % m_line_offsets.size()];
+  }
+
+private:
+  static constexpr size_t kBlockSize = 256 * 1024;
+  static constexpr size_t kInitialLines = 16 * 1024;
+
+  /** Where in a line the next input byte is. */
+  enum class State { kLineStart, kComment, kInLine };
+
+  /** Read next block, return false on end of file or error. */
+  bool FillBlock() {
+    if (!m_file) return false;
+    m_block_offset += m_end;
+    m_pos = 0;
+    m_end = std::fread(m_block.data(), 1, m_block.size(), m_file);
+    return m_end > 0;
+  }
+
+  /** Move offsets found by last read() to the shared line offset ring. */
+  void PublishLineOffsets() {
+    m_read_offset = m_block_offset + m_pos;
+    const uint64_t used = m_next_line - m_first_line;
+    if (used + m_new_lines.size() > m_line_offsets.size()) {
+      // The decoder reads ahead a MB at most, this does not repeat.
+      size_t size = m_line_offsets.size();
+      while (used + m_new_lines.size() > size) size *= 2;
+      std::vector<uint64_t> offsets(size);
+      for (uint64_t line = m_first_line; line < m_next_line; ++line) {
+        offsets[(line - 1) % size] =
+            m_line_offsets[(line - 1) % m_line_offsets.size()];
+      }
+      m_line_offsets.swap(offsets);
+    }
+    for (uint64_t offset : m_new_lines) {
+      m_line_offsets[(m_next_line - 1) % m_line_offsets.size()] = offset;
+      m_next_line += 1;
+    }
+    m_new_lines.clear();
+  }
+
+  std::FILE* m_file;
+  std::vector<char> m_block;
+  uint64_t m_block_offset;  ///< File offset of m_block[0]
+  size_t m_pos;             ///< Next unread byte in m_block
+  size_t m_end;             ///< End of valid data in m_block
+  State m_state;
+  std::string m_prefix;
+  size_t m_prefix_pos;  ///< Next prefix byte to return
+
+  /** Offsets of lines found by current Read(). */
+  std::vector<uint64_t> m_new_lines;
+
+  std::vector<uint64_t> m_line_offsets;  ///< Ring indexed by line - 1
+  uint64_t m_first_line;                 ///< First line kept in ring
+  uint64_t m_next_line;                  ///< Line number of next offset
+  uint64_t m_read_offset;                ///< File offset of data read
+};
+
+uint64_t DataMonitorDecoder::ParseCreatedAt(const std::string& head) {
+  static const char* const kCreatedAt = "Created at:";
+  const size_t created_at_len = std::strlen(kCreatedAt);
+  size_t line_start = 0;
+  for (int i = 0; i < 10 && line_start < head.size(); ++i) {
+    size_t line_end = head.find('\n', line_start);
+    if (line_end == std::string::npos) line_end = head.size();
+    const char* begin = head.data() + line_start;
+    const char* end = head.data() + line_end;
+    const char* pos = std::search(begin, end, kCreatedAt,
+                                  kCreatedAt + created_at_len);
+    if (pos != end) {
+      uint64_t ms = 0;
+      ParseTimeStamp(pos + created_at_len, end, ms);
+      return ms;
+    }
+    line_start = line_end + 1;
+  }
+  return 0;
+}
+
+/** Map protocol column to message type, return false if unknown. */
+static bool ParseProtocol(const char* protocol, size_t size,
+                          ReplayMsgType& type) {
+  // NMEA2000, NMEA0183 or SignalK, told apart by at most two characters.
+  if (size == 0) return false;
+  switch (protocol[0]) {
+    case 'N':
+      if (size != 8) return false;
+      switch (protocol[4]) {
+        case '2':
+          type = ReplayMsgType::kN2k;
+          return true;
+        case '0':
+          type = ReplayMsgType::kNmea0183;
+          return true;
+        default:
+          return false;
+      }
+    case 'S':
+      type = ReplayMsgType::kSignalK;
+      return size == 7;
+    default:
+      return false;
+  }
+}
+
+DataMonitorDecoder::DataMonitorDecoder(const FileSniff& sniff,
+                                       VdrMsgCallback vdr_message)
+    : m_path(sniff.path),
+      m_vdr_message(std::move(vdr_message)),
+      m_sniff(sniff),
+      m_header_line(sniff.GetFirstDataLine()),
+      m_pos(0),
+      m_end(0),
+      m_eof(true),
+      m_skipping(false),
+      m_line(0),
+      m_column_index{} {}
+
+DataMonitorDecoder::~DataMonitorDecoder() = default;
+
+size_t DataMonitorDecoder::SplitFields(char* line, size_t length,
+                                       Field* fields, size_t max_fields) {
+  char* p = line;
+  char* const end = line + length;
+  size_t count = 0;
+  for (;;) {
+    while (p < end && *p == ' ') p++;
+    char* begin = p;
+    char* field_end;
+    if (p < end && *p == '"') {
+      // Quoted, "" is an escaped quote. Unquoted in place, the result is
+      // never longer than the input.
+      char* out = p++;
+      begin = out;
+      while (p < end) {
+        if (*p == '"') {
+          if (p + 1 < end && p[1] == '"') {
+            *out++ = '"';
+            p += 2;
+            continue;
+          }
+          p++;
+          break;
+        }
+        *out++ = *p++;
+      }
+      field_end = out;
+      while (p < end && *p != ',') p++;
+    } else {
+      while (p < end && *p != ',') p++;
+      field_end = p;
+      while (field_end > begin && field_end[-1] == ' ') field_end--;
+    }
+    if (count < max_fields) {
+      fields[count] = {begin, static_cast<size_t>(field_end - begin)};
+    }
+    count++;
+    if (p == end) return count;
+    p++;  // Skip ','
+  }
+}
+
+DataMonitorDecoder::LineStatus DataMonitorDecoder::NextLine(char*& line,
+                                                            size_t& length) {
+  for (;;) {
+    char* begin = m_buffer.data() + m_pos;
+    const size_t available = m_end - m_pos;
+    auto nl = static_cast<char*>(std::memchr(begin, '\n', available));
+    if (nl || (m_eof && available > 0)) {
+      length = nl ? nl - begin : available;
+      m_pos += nl ? length + 1 : length;
+      m_line++;
+      if (m_skipping) {
+        m_skipping = false;
+        return LineStatus::kTooLong;
+      }
+      if (length > 0 && begin[length - 1] == '\r') length--;
+      line = begin;
+      return LineStatus::kOk;
+    }
+    if (m_eof) return LineStatus::kEnd;
+    if (available == m_buffer.size()) {
+      // No line ending in a full buffer, drop the line.
+      m_skipping = true;
+      m_pos = m_end = 0;
+    } else if (m_pos > 0) {
+      std::memmove(m_buffer.data(), begin, available);
+      m_pos = 0;
+      m_end = available;
+    }
+    const size_t count =
+        m_byte_source->Read(m_buffer.data() + m_end, m_buffer.size() - m_end);
+    m_end += count;
+    m_eof = count == 0;
+  }
+}
+
+void DataMonitorDecoder::ReportLineError(const char* error) {
+  m_vdr_message(VdrMsgType::kMessage, std::string(error) + " in line " +
+                                          std::to_string(m_line) +
+                                          " in file " + m_path);
+}
+
+bool DataMonitorDecoder::ReadHeader(std::string& error) {
+  static const char* const kNames[kColumns] = {
+      "received_at", "protocol", "msg_type", "source", "raw_data"};
+  char* line;
+  size_t length;
+  if (NextLine(line, length) != LineStatus::kOk) {
+    error = "Header missing";
+    return false;
+  }
+  const size_t count = SplitFields(line, length, nullptr, 0);
+  m_fields.resize(count);
+  SplitFields(line, length, m_fields.data(), count);
+  for (size_t column = 0; column < kColumns; column++) {
+    const size_t name_len = std::strlen(kNames[column]);
+    auto it = std::find_if(m_fields.begin(), m_fields.end(), [&](Field f) {
+      return f.size == name_len &&
+             std::memcmp(f.data, kNames[column], name_len) == 0;
+    });
+    if (it == m_fields.end()) {
+      error = std::string("Missing column ") + kNames[column];
+      return false;
+    }
+    // Extra columns are ignored.
+    m_column_index[column] = it - m_fields.begin();
+  }
+  return true;
+}
+
+bool DataMonitorDecoder::Open(uint64_t offset) {
+  if (offset > 0 && m_header_line.empty()) ReadHeaderLine();
+  if (m_header_line.empty()) offset = 0;
+  m_byte_source = std::make_unique<FilteredByteSource>(
+      m_path, offset, offset > 0 ? m_header_line : std::string(), m_sniff);
+  m_buffer.resize(kMaxLineLength);
+  m_pos = m_end = 0;
+  m_eof = m_skipping = false;
+  m_line = 0;
+  std::string error;
+  if (!ReadHeader(error)) {
+    std::string s(_("CSV header parse error: ").ToStdString() + error);
+    m_vdr_message(VdrMsgType::kInfo, s);
+    return false;
+  }
+  return true;
+}
+
+bool DataMonitorDecoder::Read(ReplayRecord& record) {
+  // Give up on files which are not CSV files at all.
+  constexpr int kMaxErrors = 100;
+
+  ReplayMessage& msg = record.msg;
+  for (int errors = 0; errors < kMaxErrors;) {
+    char* line;
+    size_t length;
+    const LineStatus status = NextLine(line, length);
+    if (status == LineStatus::kEnd) return false;
+    if (status == LineStatus::kTooLong) {
+      ReportLineError("Line too long");
+      errors++;
+      continue;
+    }
+    const size_t count =
+        SplitFields(line, length, m_fields.data(), m_fields.size());
+    if (count != m_fields.size()) {
+      ReportLineError(count < m_fields.size() ? "Too few columns"
+                                              : "Too many columns");
+      errors++;
+      continue;
+    }
+    const Field& protocol = m_fields[m_column_index[kProtocol]];
+    if (!ParseProtocol(protocol.data, protocol.size, msg.type)) continue;
+    const Field& msg_type = m_fields[m_column_index[kMsgType]];
+    const Field& source = m_fields[m_column_index[kSource]];
+    const Field& raw_data = m_fields[m_column_index[kRawData]];
+    msg.msg_type.assign(msg_type.data, msg_type.size);
+    msg.source.assign(source.data, source.size);
+    msg.text.assign(raw_data.data, raw_data.size);
+    msg.has_n2k = false;
+    record.offset = m_byte_source->GetLineOffset(m_line);
+    const Field& stamp = m_fields[m_column_index[kReceivedAt]];
+    const char* stamp_end = stamp.data + stamp.size;
+    if (stamp.size == 0 ||
+        ParseMillis(stamp.data, stamp_end, record.stamp) != stamp_end) {
+      const std::string text(stamp.data, stamp.size);
+      m_vdr_message(VdrMsgType::kDebug, "Illegal timestamp: " + text);
+      record.stamp = 0;
+    }
+    return true;
+  }
+  return false;
+}
+
+void DataMonitorDecoder::Scan(const ScanVisitor& visitor) {
+  std::ifstream stream(ToFsPath(m_path), std::ios::binary);
+  std::string line;
+  uint64_t offset = 0;
+  bool header_found = false;
+  while (std::getline(stream, line)) {
+    const uint64_t line_offset = offset;
+    offset += line.size() + 1;
+    const char* begin = SkipWhitespace(line);
+    const char* const end = line.data() + line.size();
+    if (begin == end || *begin == '#') continue;
+    if (!header_found) {
+      header_found = true;
+      if (m_header_line.empty()) m_header_line.assign(begin, end);
+      continue;
+    }
+    uint64_t stamp;
+    const char* stamp_end = ParseMillis(begin, end, stamp);
+    if (stamp_end == begin || stamp_end == end || *stamp_end != ',') {
+      continue;
+    }
+    visitor(stamp, line_offset);
+  }
+}
+
+const char* DataMonitorDecoder::SkipWhitespace(const std::string& line) {
+  const char* p = line.data();
+  const char* const end = p + line.size();
+  while (p < end && std::isspace(static_cast<unsigned char>(*p))) p++;
+  return p;
+}
+
+void DataMonitorDecoder::ReadHeaderLine() {
+  std::ifstream stream(ToFsPath(m_path), std::ios::binary);
+  std::string line;
+  while (std::getline(stream, line)) {
+    const char* begin = SkipWhitespace(line);
+    const char* const end = line.data() + line.size();
+    if (begin == end || *begin == '#') continue;
+    m_header_line.assign(begin, end);
+    return;
+  }
+}
+
+bool DataMonitorDecoder::IsVdrFormat(const std::string& path) {
+  FileSniff sniff;
+  return SniffFile(path, sniff) &&
+         sniff.format == VdrFileFormat::kDataMonitor;
+}
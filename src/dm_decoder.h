@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   Copyright (C) 2025 Alec Leamas                                        *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Data Monitor VDR mode log file decoding. Does not use the plugin API,
+ * also used by the command line converter.
+ */
+
+#ifndef DM_DECODER_H_
+#define DM_DECODER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "file_sniffer.h"
+#include "replay_engine.h"
+
+/** Debug and Message assumed to be logged, Info presented as a GUI dialog. */
+enum class VdrMsgType { kDebug, kMessage, kInfo };
+
+using VdrMsgCallback = std::function<void(VdrMsgType, const std::string&)>;
+
+/**
+ * ReplayDecoder reading a Data Monitor VDR mode CSV log file. Lines are
+ * split into fields in place, errors are reported without exceptions and
+ * no memory is allocated per row once buffers have grown.
+ */
+class DataMonitorDecoder : public ReplayDecoder {
+public:
+  /**
+   * @param sniff Log file created by Data Monitor in VDR mode, as
+   *     returned by SniffFile().
+   * @param vdr_message Callback handling user info.
+   */
+  DataMonitorDecoder(const FileSniff& sniff, VdrMsgCallback vdr_message);
+
+  ~DataMonitorDecoder() override;
+
+  bool Open(uint64_t offset) override;
+
+  bool Read(ReplayRecord& record) override;
+
+  [[nodiscard]] uint64_t GetSize() const override { return m_sniff.size; }
+
+  void Scan(const ScanVisitor& visitor) override;
+
+  /** Return true if file on path seems to be a Data Monitor VDR logfile */
+  static bool IsVdrFormat(const std::string& path);
+
+  /**
+   * Return "Created at:" header time in head of a file, ms since 1/1 1970.
+   * Returns 0 if there is no such header.
+   */
+  static uint64_t ParseCreatedAt(const std::string& head);
+
+private:
+  /** Byte source dropping comments and blank lines. */
+  class FilteredByteSource;
+
+  /** Columns used, index in m_column_index. */
+  enum Column { kReceivedAt, kProtocol, kMsgType, kSource, kRawData, kColumns };
+
+  /** A CSV field, unquoted in place in m_buffer. */
+  struct Field {
+    const char* data;
+    size_t size;
+  };
+
+  /** Result of NextLine(). */
+  enum class LineStatus { kOk, kTooLong, kEnd };
+
+  /** Max line length, longer lines are skipped. */
+  static constexpr size_t kMaxLineLength = 1024 * 1024;
+
+  /**
+   * Split a CSV line into fields, removing quotes and surrounding spaces.
+   * @return Number of fields in line, at most max_fields are stored.
+   */
+  static size_t SplitFields(char* line, size_t length, Field* fields,
+                            size_t max_fields);
+
+  /** Get next line from m_byte_source, without line ending. */
+  LineStatus NextLine(char*& line, size_t& length);
+
+  /** Parse CSV header in first line. @return false and error if invalid. */
+  bool ReadHeader(std::string& error);
+
+  /** Report an error in current line. */
+  void ReportLineError(const char* error);
+
+  /** Return pointer to first non-whitespace character in line. */
+  static const char* SkipWhitespace(const std::string& line);
+
+  /** Set m_header_line to first line which is not blank or a comment. */
+  void ReadHeaderLine();
+
+  const std::string m_path;
+  const VdrMsgCallback m_vdr_message;
+  const FileSniff m_sniff;
+  std::string m_header_line;  ///< CSV header, used when starting mid-file
+
+  std::unique_ptr<FilteredByteSource> m_byte_source;
+
+  std::vector<char> m_buffer;  ///< Lines read from m_byte_source
+  size_t m_pos;                ///< Start of next line in m_buffer
+  size_t m_end;                ///< End of valid data in m_buffer
+  bool m_eof;                  ///< m_byte_source is exhausted
+  bool m_skipping;             ///< Discarding a line longer than m_buffer
+  uint64_t m_line;             ///< Lines returned, header is line 1
+
+  size_t m_column_index[kColumns];  ///< Field index of each column
+  std::vector<Field> m_fields;      ///< Fields of current row
+};
+
+#endif  // DM_DECODER_H_
@@ -22,19 +22,10 @@
  */
 
 #include <algorithm>
-#include <cassert>
-#include <cctype>
-#include <fstream>
-#include <iomanip>
-#include <sstream>
+#include <cstdint>
+#include <cstring>
 
 #include "dm_replay_mgr.h"
-#include "csv.h"
-#include "std_filesystem.h"
-
-using namespace std::chrono_literals;
-
-static constexpr auto kEpoch = ReplayTimepoint{};  ///< 1/1 1970
 
 static const char* const kNoDriverMessage =
     _(R"(I cannot find any loopback driver and is thus unable
@@ -60,193 +51,133 @@ static std::vector<DriverHandle> GetLoopbackDriver() {
   return rv;
 }
 
-static ReplayTimepoint ParseTimeStamp(const std::string& stamp) {
-  const char* const format = "%a %b %d %H:%M:%S %Y";
-  std::istringstream is(stamp);
-  is.imbue(std::locale("en_US.utf-8"));
-  std::tm tm{0};
-  is >> std::get_time(&tm, format);
-  return ReplayClock::from_time_t(std::mktime(&tm));
-}
+LoopbackSink::LoopbackSink(DriverHandle driver)
+    : m_driver(std::move(driver)), m_next_payload(0) {}
 
-/**
- * fast_csv_reader byte source reading from file filtering blank and comment
- * lines away. This should be done automagically by the reader, but I
- * don't get it to work.
- */
-class DataMonitorReplayMgr::FilteredByteSource : public io::ByteSourceBase {
-public:
-  explicit FilteredByteSource(const std::string& path) : m_stream(path) {}
-  ~FilteredByteSource() override = default;
-
-  int read(char* returned, int scount) override {
-    assert(scount >= 0);
-    auto count = static_cast<size_t>(scount);
-    while (m_buff.size() < count && m_stream.good()) {
-      std::string line;
-      std::getline(m_stream, line);
-      while (!line.empty() && std::isspace(line[0])) line = line.substr(1);
-      if (line.empty()) continue;
-      if (line[0] == '#') continue;
-      m_buff.append(line + "\n");
+std::shared_ptr<std::vector<uint8_t>>& LoopbackSink::GetFreePayload() {
+  for (size_t i = 0; i < kPayloadPoolSize; ++i) {
+    auto& payload = m_payload_pool[(m_next_payload + i) % kPayloadPoolSize];
+    if (payload && payload.use_count() == 1) {
+      m_next_payload = (m_next_payload + i + 1) % kPayloadPoolSize;
+      payload->clear();
+      return payload;
     }
-    auto length = static_cast<std::streamsize>(std::min(count, m_buff.size()));
-    std::memcpy(returned, m_buff.c_str(), length);
-    m_buff = m_buff.substr(length);
-    return static_cast<int>(length);
   }
+  // All busy, replace the next one. The driver keeps the old one alive.
+  auto& payload = m_payload_pool[m_next_payload];
+  m_next_payload = (m_next_payload + 1) % kPayloadPoolSize;
+  payload = std::make_shared<std::vector<uint8_t>>();
+  return payload;
+}
 
-private:
-  std::string m_buff;
-  std::ifstream m_stream;
-};
-
-DataMonitorReplayMgr::Log::Log(const std::string& path) : read_bytes(0) {
-  std::ifstream stream(path);
-  if (!stream.good()) {
-    file_size = 0;
-    return;
-  }
-  for (int i = 0; i < 10 && stream.good(); ++i) {
-    std::string line;
-    std::getline(stream, line);
-    if (line.find("Created at:") == std::string::npos) continue;
-
-    size_t colon_pos = line.find(':');
-    std::string timestamp = line.substr(colon_pos + 1);
-    curr_stamp = ParseTimeStamp(timestamp);
-    break;
-  }
-  file_size = fs::file_size(path);
+void LoopbackSink::Deliver(const ReplayMessage& msg) {
+  static const char* const kPrefixes[] = {"nmea0183 ", "nmea2000 ",
+                                          "signalk "};
+  if (msg.msg_type.empty()) return;
+  const char* prefix = kPrefixes[static_cast<int>(msg.type)];
+
+  std::shared_ptr<std::vector<uint8_t>>& payload = GetFreePayload();
+  auto append = [&payload](const char* data, size_t size) {
+    payload->insert(payload->end(), data, data + size);
+  };
+  append(prefix, std::strlen(prefix));
+  append(msg.source.data(), msg.source.size());
+  append(" ", 1);
+  append(msg.msg_type.data(), msg.msg_type.size());
+  append(" ", 1);
+  append(msg.text.data(), msg.text.size());
+  WriteCommDriver(m_driver, payload);
 }
 
 DataMonitorReplayMgr::DataMonitorReplayMgr(
-    const std::string& path, std::function<void()> update_controls,
+    const FileSniff& sniff, std::function<void()> update_controls,
     VdrMsgCallback vdr_message)
     : m_state(State::kNotInited),
-      m_log(path),
-      m_csv_reader(path, std::make_unique<FilteredByteSource>(path)),
       m_update_controls(std::move(update_controls)),
-      m_vdr_message(std::move(vdr_message)) {
-  if (path.empty()) return;
-
-  try {
-    m_csv_reader.read_header(io::ignore_extra_column, "received_at", "protocol",
-                             "msg_type", "source", "raw_data");
-  } catch (io::error::base& e) {
+      m_vdr_message(std::move(vdr_message)),
+      m_created_at(0),
+      m_fanout(kFanoutCapacity) {
+  if (sniff.path.empty()) return;
+
+  m_created_at = DataMonitorDecoder::ParseCreatedAt(sniff.head);
+  m_engine = std::make_unique<ReplayEngine>(
+      std::make_unique<DataMonitorDecoder>(sniff, m_vdr_message), m_fanout);
+  if (!m_engine->Open()) {
     m_state = State::kError;
-    std::string s(_("CSV header parse error: ").ToStdString() + e.what());
-    m_vdr_message(VdrMsgType::kInfo, s);
     return;
   }
-  m_loopback_drivers = GetLoopbackDriver();
-  m_state = m_loopback_drivers.empty() ? State::kNoDriver : State::kIdle;
-  if (m_state == State::kNoDriver)
+  std::vector<DriverHandle> drivers = GetLoopbackDriver();
+  if (drivers.empty()) {
+    m_state = State::kNoDriver;
     m_vdr_message(VdrMsgType::kInfo, kNoDriverMessage);
+    return;
+  }
+  m_fanout.AddSink(std::make_shared<LoopbackSink>(drivers[0]));
+  m_state = State::kReady;
 }
 
 DataMonitorReplayMgr::~DataMonitorReplayMgr() = default;
 
-void DataMonitorReplayMgr::HandleRow(const std::string& protocol,
-                                     const std::string& msg_type,
-                                     const std::string& source,
-                                     const std::string& raw_data) const {
-  std::stringstream ss;
-  if (protocol == "NMEA2000")
-    ss << "nmea2000 " << source << " " << msg_type << " " << raw_data;
-  else if (protocol == "NMEA0183")
-    ss << "nmea0183 " << source << " " << msg_type << " " << raw_data;
-  else if (protocol == "SignalK")
-    ss << "signalk " << source << " " << msg_type << " " << raw_data;
+void DataMonitorReplayMgr::Start() {
+  if (m_state != State::kReady) return;
+  m_engine->Start();
+  Notify();
+}
 
-  const auto s = ss.str();
-  if (s.empty()) return;
-  auto payload = std::make_shared<std::vector<uint8_t>>(s.begin(), s.end());
-  WriteCommDriver(m_loopback_drivers[0], payload);
+void DataMonitorReplayMgr::Pause() {
+  if (m_state == State::kReady) m_engine->Pause();
 }
 
-void DataMonitorReplayMgr::Start() {
-  if (m_state == State::kIdle) m_log.read_bytes = 0;
-  if (m_state == State::kPaused || m_state == State::kIdle)
-    m_state = State::kPlaying;
-  Notify();
+void DataMonitorReplayMgr::SetSpeed(double speed) {
+  if (m_engine) m_engine->SetSpeed(speed);
+}
+
+void DataMonitorReplayMgr::SetBatchBudget(unsigned max_rows,
+                                          std::chrono::milliseconds max_time) {
+  if (m_engine) m_engine->SetBatchBudget(max_rows, max_time);
+}
+
+void DataMonitorReplayMgr::SetStats(ReplayStats* stats) {
+  if (m_engine) m_engine->SetStats(stats);
 }
 
 int DataMonitorReplayMgr::Notify() {
-  if (m_state != State::kPlaying && m_state != State::kIdle) return -1;
-  std::string received_at;
-  std::string protocol;
-  std::string msg_type;
-  std::string source;
-  std::string raw_data;
-  bool there_is_more = false;
-  try {
-    there_is_more = m_csv_reader.read_row(received_at, protocol, msg_type,
-                                          source, raw_data);
-  } catch (io::error::base& err) {
-    m_vdr_message(VdrMsgType::kMessage, err.what());
-    return 0;
-  }
-  m_log.read_bytes += received_at.size() + protocol.size() + msg_type.size() +
-                      source.size() + raw_data.size() + 5;
-  HandleRow(protocol, msg_type, source, raw_data);
-  if (!there_is_more) {
-    m_state = State::kEof;
-    m_update_controls();
-    return -1;
-  }
-  if (m_state == State::kIdle) m_state = State::kPlaying;
-  std::chrono::milliseconds delay = ComputeDelay(received_at, m_log);
-  return static_cast<int>(delay.count());
-}
-
-std::chrono::milliseconds DataMonitorReplayMgr::ComputeDelay(
-    const std::string& received_at, Log& log) const {
-  using namespace std::chrono;
-  constexpr auto kDefaultDelay = 100ms;
-
-  const ReplayTimepoint now = ReplayClock::now();
-  if (log.start_time == kEpoch) log.start_time = now;
-  ReplayTimepoint timestamp = kEpoch;
-  milliseconds duration_from_start;
-  try {
-    timestamp = kEpoch + milliseconds(std::stol(received_at));
-    if (log.first_stamp == kEpoch) log.first_stamp = timestamp;
-    duration_from_start =
-        duration_cast<milliseconds>(timestamp - log.first_stamp);
-  } catch (std::logic_error&) {
-    m_vdr_message(VdrMsgType::kDebug,
-                  std::string("Illegal timestamp: ") + received_at);
-    duration_from_start =
-        duration_cast<milliseconds>(now - log.start_time) + kDefaultDelay;
-  }
-  if (timestamp != kEpoch) log.curr_stamp = timestamp;
+  if (m_state != State::kReady) return -1;
+  const bool was_playing = m_engine->IsPlaying();
+  const int delay = m_engine->Notify();
+  if (was_playing && m_engine->IsAtEnd()) m_update_controls();
+  return delay;
+}
+
+bool DataMonitorReplayMgr::SeekToFraction(double fraction) {
+  return m_state == State::kReady && m_engine->SeekToFraction(fraction);
+}
+
+bool DataMonitorReplayMgr::SeekToTimestamp(uint64_t timestamp) {
+  return m_state == State::kReady && m_engine->SeekToTimestamp(timestamp);
+}
+
+void DataMonitorReplayMgr::BuildIndex() {
+  if (m_engine) m_engine->BuildIndex();
+}
 
-  const ReplayTimepoint replay_time = log.start_time + duration_from_start;
-  if (replay_time <= now) return 0ms;  // catching up...
-  return duration_cast<milliseconds>(replay_time - now);
+uint64_t DataMonitorReplayMgr::GetFirstTimestamp() const {
+  return m_engine ? m_engine->GetFirstTimestamp() : 0;
+}
+
+uint64_t DataMonitorReplayMgr::GetLastTimestamp() const {
+  return m_engine ? m_engine->GetLastTimestamp() : 0;
 }
 
 uint64_t DataMonitorReplayMgr::GetCurrentTimestamp() const {
-  using namespace std::chrono;
-  return static_cast<uint64_t>(
-      duration_cast<milliseconds>(m_log.curr_stamp - kEpoch).count());
+  uint64_t stamp = m_engine ? m_engine->GetCurrentTimestamp() : 0;
+  return stamp != 0 ? stamp : m_created_at;
 }
 
 double DataMonitorReplayMgr::GetProgressFraction() const {
-  return static_cast<double>(m_log.read_bytes) / m_log.file_size;
+  return m_engine ? m_engine->GetProgressFraction() : 0;
 }
 
 bool DataMonitorReplayMgr::IsVdrFormat(const std::string& path) {
-  std::ifstream stream(path);
-  for (int i = 0; i < 5; ++i) {
-    if (!stream.good()) return false;
-    std::string line;
-    std::getline(stream, line);
-    if (line.find("timestamp_format") != std::string::npos &&
-        line.find("EPOCH_MILLIS") != std::string::npos) {
-      return true;
-    }
-  }
-  return false;
+  return DataMonitorDecoder::IsVdrFormat(path);
 }
@@ -24,81 +24,134 @@
 #ifndef Data_MonitoR_RePlaY_MgR_h
 #define Data_MonitoR_RePlaY_MgR_h
 
+#include <array>
 #include <chrono>
 #include <cstdint>
 #include <functional>
-#include <limits>
+#include <memory>
 #include <string>
 #include <vector>
 
-#include "csv.h"
+#include "dm_decoder.h"
 #include "ocpn_plugin.h"
+#include "replay_engine.h"
+#include "replay_fanout.h"
 
-enum class VdrMsgType;  // forward
+/**
+ * Replay output to the OpenCPN loopback driver. Messages are written as
+ * "<protocol> <source> <msg_type> <text>", messages without a msg_type
+ * i.e., not from a Data Monitor recording, are ignored.
+ *
+ * Each message is a separate WriteCommDriver() call. The loopback driver
+ * parses exactly one message per payload and announces no capability
+ * which could tell otherwise, so messages cannot be batched into fewer
+ * driver writes. The work per timer tick is instead bounded by
+ * DataMonitorReplayMgr::SetBatchBudget().
+ */
+class LoopbackSink : public ReplaySink {
+public:
+  explicit LoopbackSink(DriverHandle driver);
+
+  [[nodiscard]] const char* GetName() const override { return "loopback"; }
 
-using VdrMsgCallback = std::function<void(VdrMsgType, const std::string&)>;
+  /** The plugin API is used from the main thread only. */
+  [[nodiscard]] bool IsThreaded() const override { return false; }
 
-/** See libs/fast_csv_reader/fast_csv_reader/README.md */
-using CsvReader =
-    io::CSVReader<5, io::trim_chars<' '>, io::double_quote_escape<',', '\"'>,
-                  io::single_line_comment<'#'>>;
+  void Deliver(const ReplayMessage& msg) override;
 
-using ReplayClock = std::chrono::system_clock;
-using ReplayTimepoint = std::chrono::time_point<ReplayClock>;
+private:
+  /** Number of payloads in m_payload_pool. */
+  static constexpr size_t kPayloadPoolSize = 16;
+
+  /** Return an empty payload not referenced by anyone else. */
+  std::shared_ptr<std::vector<uint8_t>>& GetFreePayload();
 
-/** Debug and Message assumed to be logged, Info presented as a GUI dialog. */
-enum class VdrMsgType { kDebug, kMessage, kInfo };
+  const DriverHandle m_driver;
+
+  /**
+   * Loopback driver payloads. The driver may keep a payload after
+   * WriteCommDriver() returns, so a payload is only reused when the pool
+   * holds the last reference.
+   */
+  std::array<std::shared_ptr<std::vector<uint8_t>>, kPayloadPoolSize>
+      m_payload_pool;
+  size_t m_next_payload;  ///< Where to start looking for a free payload
+};
 
 /**
  * Handle replaying of data recorded by Data Monitor. A model object, GUI
- * interaction is handled by callbacks.
+ * interaction is handled by callbacks. Decoding is done by a
+ * DataMonitorDecoder, timing, seeking and progress by a ReplayEngine
+ * feeding a LoopbackSink.
  */
 class DataMonitorReplayMgr {
 public:
   /**
    * Create instance  ready to play a log file.
-   * @param path Log file created by Data Monitor in VDR mode.
+   * @param sniff Log file created by Data Monitor in VDR mode, as
+   *     returned by SniffFile(). Idle instance if path is empty.
    * @param update_controls Callback updating GUI based on current state.
    * @param vdr_message Callback handling user info.
    */
-  DataMonitorReplayMgr(const std::string& path,
+  DataMonitorReplayMgr(const FileSniff& sniff,
                        std::function<void()> update_controls,
                        VdrMsgCallback vdr_message);
 
   /** Create instance in idle state doing nothing. */
   DataMonitorReplayMgr()
       : DataMonitorReplayMgr(
-            "", [] {}, [](VdrMsgType, const std::string&) {}) {}
+            FileSniff(), [] {}, [](VdrMsgType, const std::string&) {}) {}
 
   ~DataMonitorReplayMgr();
 
   /** Start or restart playing file */
   void Start();
 
-  /** Pause playing */
-  void Pause() {
-    if (m_state == State::kPlaying) m_state = State::kPaused;
-  }
+  /** Pause playing, timing is rebased when resumed by Start(). */
+  void Pause();
+
+  /**
+   * Set replay speed multiplier, 1.0 is real time. Timing is rebased at
+   * current position, playing continues smoothly at new speed.
+   */
+  void SetSpeed(double speed);
 
   /**
-   * Handle data monitor logfile replay timer tick, typically sending
-   * one message.
+   * Handle data monitor logfile replay timer tick, sending all messages
+   * which are due within the limits set by SetBatchBudget().
    * @return Milliseconds to next message. Value < 0 means
    *    there is nothing more to send. Value == 0 indicates
-   *    that we are catching up, next message should already have
-   *    been sent.
+   *    that we are catching up, the budget was exhausted before all
+   *    due messages were sent.
    */
   int Notify();
 
-  [[nodiscard]] bool IsPlaying() const { return m_state == State::kPlaying; }
+  /** @see ReplayEngine::SetBatchBudget() */
+  void SetBatchBudget(unsigned max_rows, std::chrono::milliseconds max_time);
 
-  [[nodiscard]] bool IsAtEnd() const { return m_state == State::kEof; }
+  /** Record timing statistics in stats, which must outlive this. */
+  void SetStats(ReplayStats* stats);
+
+  [[nodiscard]] bool IsPlaying() const {
+    return m_state == State::kReady && m_engine->IsPlaying();
+  }
+
+  [[nodiscard]] bool IsAtEnd() const {
+    return m_state == State::kReady && m_engine->IsAtEnd();
+  }
 
-  [[nodiscard]] bool IsError() const { return m_state == State::kError; }
+  [[nodiscard]] bool IsError() const {
+    return m_state == State::kError ||
+           (m_state == State::kReady && m_engine->IsError());
+  }
 
-  [[nodiscard]] bool IsIdle() const { return m_state == State::kIdle; }
+  [[nodiscard]] bool IsIdle() const {
+    return m_state == State::kReady && m_engine->IsIdle();
+  }
 
-  [[nodiscard]] bool IsPaused() const { return m_state == State::kPaused; }
+  [[nodiscard]] bool IsPaused() const {
+    return m_state == State::kReady && m_engine->IsPaused();
+  }
 
   [[nodiscard]] bool IsDriverMissing() const {
     return m_state == State::kNoDriver;
@@ -107,59 +160,54 @@ public:
   /** Return how much of current file is played, number between 0 and 1. */
   [[nodiscard]] double GetProgressFraction() const;
 
+  /**
+   * Move play position to the first row starting at given fraction of the
+   * file size or later. Timing restarts from the new position.
+   * @return false on errors.
+   */
+  bool SeekToFraction(double fraction);
+
+  /**
+   * Move play position to the first row with received_at >= timestamp.
+   * Timing restarts from the new position.
+   * @param timestamp Milliseconds since 1/1 1970.
+   * @return false on errors.
+   */
+  bool SeekToTimestamp(uint64_t timestamp);
+
+  /**
+   * Scan file and build the offset index used when seeking. Invoked on
+   * first seek unless done before.
+   */
+  void BuildIndex();
+
+  /** Return first timestamp in file, ms since 1/1 1970, 0 if unknown. */
+  [[nodiscard]] uint64_t GetFirstTimestamp() const;
+
+  /** Return last timestamp in file, ms since 1/1 1970, 0 if unknown. */
+  [[nodiscard]] uint64_t GetLastTimestamp() const;
+
   /**
    * Return currently played timestamp, milliseconds since 1/1 1970.
-   * Undefined if nothing played.
- . */
+   * Before playing, this is the "Created at" header time, if any.
+   */
   [[nodiscard]] uint64_t GetCurrentTimestamp() const;
 
   /** Return true if file on path seems to be a Data Monitor VDR logfile */
   static bool IsVdrFormat(const std::string& path);
 
 private:
-  /** CsvReader byte source handling comments and space. */
-  class FilteredByteSource;
-
-  enum class State {
-    kNotInited,
-    kIdle,
-    kPlaying,
-    kPaused,
-    kEof,
-    kError,
-    kNoDriver
-  } m_state;
-
-  /** Status with respect to the logfile. */
-  struct Log {
-    ReplayTimepoint start_time;   ///< When the replay started
-    ReplayTimepoint first_stamp;  ///< First log line timestamp
-    ReplayTimepoint curr_stamp;   ///< Currently played timestamp
-    unsigned read_bytes;          ///< # read bytes so far
-    unsigned file_size;
-
-    explicit Log(unsigned _file_size) : read_bytes(0), file_size(_file_size) {}
-    explicit Log(const std::string& path);
-  } m_log;
-
-  CsvReader m_csv_reader;
+  enum class State { kNotInited, kReady, kError, kNoDriver } m_state;
+
   std::function<void()> m_update_controls;
   VdrMsgCallback m_vdr_message;
+  uint64_t m_created_at;  ///< "Created at" header timestamp, or 0
 
-  /** A single loopback driver or empty if none available. */
-  std::vector<DriverHandle> m_loopback_drivers;
-
-  void HandleRow(const std::string& protocol, const std::string& msg_type,
-                 const std::string& source, const std::string& raw_data) const;
+  /** Only inline sinks, the ring is not used. */
+  static constexpr size_t kFanoutCapacity = 64;
 
-  /**
-   * Compute duration to next message to be sent <br> and update
-   * log timestamps.
-   * @param ms Current processed logfile entry, milliseconds timestamp.
-   * @param log Current used timestamps
-   * @return Duration to next message.
-   */
-  std::chrono::milliseconds ComputeDelay(const std::string& ms, Log& log) const;
+  ReplayFanout m_fanout;
+  std::unique_ptr<ReplayEngine> m_engine;  ///< Uses m_fanout
 };
 
 #endif  //  Data_MonitoR_RePlaY_MgR_h
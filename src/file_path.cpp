@@ -0,0 +1,70 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement file_path.h
+ */
+
+#include <cstring>
+
+#include <wx/string.h>
+#include <wx/strconv.h>
+
+#include "file_path.h"
+
+std::string ToFilePath(const wxString& path) {
+#ifdef _WIN32
+  return std::string(path.utf8_str());
+#else
+  return std::string(path.mb_str(wxConvFile));
+#endif
+}
+
+wxString FromFilePath(const std::string& path) {
+#ifdef _WIN32
+  return wxString::FromUTF8(path.c_str());
+#else
+  return wxString(path.c_str(), wxConvFile);
+#endif
+}
+
+fs::path ToFsPath(const std::string& path) {
+#ifdef _WIN32
+  return fs::u8path(path);
+#else
+  return fs::path(path);
+#endif
+}
+
+std::string FromFsPath(const fs::path& path) {
+#ifdef _WIN32
+  return path.u8string();
+#else
+  return path.string();
+#endif
+}
+
+std::FILE* OpenStdioFile(const std::string& path, const char* mode) {
+#ifdef _WIN32
+  const std::wstring wide_mode(mode, mode + std::strlen(mode));
+  return _wfopen(ToFsPath(path).c_str(), wide_mode.c_str());
+#else
+  return std::fopen(path.c_str(), mode);
+#endif
+}
@@ -0,0 +1,52 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * File names in the wx independent recording and playback code. These are
+ * kept as std::string in the wxConvFile encoding, except on Windows where
+ * it is a legacy code page: file names are then UTF-8 and files are opened
+ * using the wide character API, so all file names work.
+ */
+
+#ifndef FILE_PATH_H_
+#define FILE_PATH_H_
+
+#include <cstdio>
+#include <string>
+
+#include "std_filesystem.h"
+
+class wxString;
+
+/** Convert a wx file name to a std::string file name. */
+std::string ToFilePath(const wxString& path);
+
+/** Convert a std::string file name to a wx file name. */
+wxString FromFilePath(const std::string& path);
+
+/** Return file name as a fs::path, also usable by file streams. */
+fs::path ToFsPath(const std::string& path);
+
+/** Return std::string file name of a fs::path. */
+std::string FromFsPath(const fs::path& path);
+
+/** Open file as std::fopen(). */
+std::FILE* OpenStdioFile(const std::string& path, const char* mode);
+
+#endif  // FILE_PATH_H_
@@ -0,0 +1,184 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement file_sniffer.h
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#include "file_path.h"
+#include "file_sniffer.h"
+
+/** Return true if c is whitespace, not using locales. */
+static bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' ||
+         c == '\v';
+}
+
+/**
+ * Return first line in [begin, end) which is not blank or a comment,
+ * without surrounding space.
+ * @param complete If true, a last line lacking newline is accepted.
+ */
+static std::string FirstDataLine(const char* begin, const char* end,
+                                 bool complete) {
+  const char* p = begin;
+  while (p < end) {
+    while (p < end && IsSpace(*p)) ++p;
+    const char* eol = std::find(p, end, '\n');
+    if (p < end && *p != '#') {
+      if (eol == end && !complete) return "";
+      const char* last = eol;
+      while (last > p && IsSpace(last[-1])) --last;
+      return std::string(p, last);
+    }
+    p = eol;
+  }
+  return "";
+}
+
+/** Return true if head starts with the gzip magic number. */
+static bool IsGzip(const std::string& head) {
+  return head.size() >= 2 && head[0] == '\x1f' && head[1] == '\x8b';
+}
+
+/** Return true if head starts with another compressed file magic number. */
+static bool IsCompressed(const std::string& head) {
+  static const struct {
+    const char* magic;
+    size_t size;
+  } kMagics[] = {
+      {"PK\x03\x04", 4},                // zip
+      {"BZh", 3},                       // bzip2
+      {"\xfd" "7zXZ\x00", 6},           // xz
+      {"\x28\xb5\x2f\xfd", 4},          // zstd
+  };
+  for (const auto& m : kMagics) {
+    if (head.size() >= m.size && std::memcmp(head.data(), m.magic, m.size) == 0)
+      return true;
+  }
+  return false;
+}
+
+/** Return true if head does not look like text. */
+static bool IsBinary(const std::string& head) {
+  size_t control = 0;
+  for (char ch : head) {
+    const auto c = static_cast<unsigned char>(ch);
+    if (c == 0) return true;
+    if (c < 0x20 && !IsSpace(ch) && c != 0x1b) control += 1;
+  }
+  // Allow for the occasional line noise in serial captures.
+  return control > head.size() / 10;
+}
+
+/** Return true if one of the first lines marks a Data Monitor log. */
+static bool IsDataMonitor(const std::string& head) {
+  constexpr int kMaxLines = 5;
+  size_t pos = 0;
+  for (int i = 0; i < kMaxLines && pos < head.size(); ++i) {
+    size_t eol = head.find('\n', pos);
+    if (eol == std::string::npos) eol = head.size();
+    const std::string line = head.substr(pos, eol - pos);
+    if (line.find("timestamp_format") != std::string::npos &&
+        line.find("EPOCH_MILLIS") != std::string::npos) {
+      return true;
+    }
+    pos = eol + 1;
+  }
+  return false;
+}
+
+/**
+ * Return true if line is a CSV header with timestamp and message columns,
+ * as checked by VdrCsvDecoder::ParseHeader().
+ */
+static bool IsVdrCsvHeader(const std::string& line) {
+  std::string lower(line);
+  std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  });
+  bool has_timestamp = false;
+  bool has_message = false;
+  size_t pos = 0;
+  while (pos <= lower.size()) {
+    size_t comma = lower.find(',', pos);
+    if (comma == std::string::npos) comma = lower.size();
+    const std::string field = lower.substr(pos, comma - pos);
+    if (field.find("timestamp") != std::string::npos) {
+      has_timestamp = true;
+    } else if (field.find("message") != std::string::npos) {
+      has_message = true;
+    }
+    pos = comma + 1;
+  }
+  return has_timestamp && has_message;
+}
+
+std::string FileSniff::GetFirstDataLine() const {
+  return FirstDataLine(head.data(), head.data() + head.size(), IsComplete());
+}
+
+VdrFileFormat ClassifyHead(const std::string& head) {
+  if (IsGzip(head)) return VdrFileFormat::kGzip;
+  if (IsCompressed(head)) return VdrFileFormat::kCompressed;
+  if (IsBinary(head)) return VdrFileFormat::kBinary;
+  if (IsDataMonitor(head)) return VdrFileFormat::kDataMonitor;
+
+  const std::string line =
+      FirstDataLine(head.data(), head.data() + head.size(), true);
+  if (line.empty()) return VdrFileFormat::kEmpty;
+  if (line[0] == '$' || line[0] == '!' || line[0] == '{')
+    return VdrFileFormat::kRawNmea;
+  if (IsVdrCsvHeader(line)) return VdrFileFormat::kVdrCsv;
+  return VdrFileFormat::kUnknown;
+}
+
+bool SniffFile(const std::string& path, FileSniff& sniff) {
+  std::FILE* file = OpenStdioFile(path, "rb");
+  if (!file) return false;
+  sniff.path = path;
+  sniff.head.resize(FileSniff::kHeadSize);
+  const size_t count =
+      std::fread(&sniff.head[0], 1, sniff.head.size(), file);
+  sniff.head.resize(count);
+  bool ok = !std::ferror(file);
+  if (ok && count < FileSniff::kHeadSize) {
+    sniff.size = count;
+  } else if (ok) {
+    // Size from the open file, saves a stat() round trip on network shares.
+#ifdef _WIN32
+    ok = _fseeki64(file, 0, SEEK_END) == 0;
+    const __int64 size = _ftelli64(file);
+#else
+    ok = fseeko(file, 0, SEEK_END) == 0;
+    const off_t size = ftello(file);
+#endif
+    ok = ok && size >= 0;
+    sniff.size = ok ? static_cast<uint64_t>(size) : 0;
+  }
+  std::fclose(file);
+  if (!ok) return false;
+  sniff.format = ClassifyHead(sniff.head);
+  return true;
+}
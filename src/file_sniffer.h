@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Format detection of playback files. The first block of a file is read
+ * once, classified and then handed to the decoder, which does not need to
+ * reopen the file to check headers.
+ */
+
+#ifndef FILE_SNIFFER_H_
+#define FILE_SNIFFER_H_
+
+#include <cstdint>
+#include <string>
+
+/** Playback file formats told apart by SniffFile(). */
+enum class VdrFileFormat {
+  kEmpty,        //!< No data, or only blank and comment lines
+  kRawNmea,      //!< NMEA 0183, AIS, $PCDIN or Signal K lines
+  kVdrCsv,       //!< CSV with timestamp and message columns
+  kDataMonitor,  //!< Data Monitor VDR mode CSV log
+  kGzip,         //!< gzip data, e.g. a compressed recording
+  kCompressed,   //!< zip, bzip2, xz or zstd data
+  kBinary,       //!< Not text
+  kUnknown       //!< Text in some other format
+};
+
+/** Result of SniffFile(). */
+struct FileSniff {
+  /** Max number of bytes read and kept in head. */
+  static constexpr size_t kHeadSize = 64 * 1024;
+
+  std::string path;
+  VdrFileFormat format;
+  uint64_t size;     //!< File size when sniffed
+  std::string head;  //!< First kHeadSize bytes of file
+
+  FileSniff() : format(VdrFileFormat::kUnknown), size(0) {}
+
+  /** Return true if head is the complete file. */
+  [[nodiscard]] bool IsComplete() const { return head.size() == size; }
+
+  /**
+   * Return first line in head which is not blank or a comment, without
+   * line ending and surrounding space. Empty if there is no such line or
+   * the line is not complete in head.
+   */
+  [[nodiscard]] std::string GetFirstDataLine() const;
+};
+
+/**
+ * Read first block of file on path and classify it.
+ * @return false if file cannot be read, sniff is then undefined.
+ */
+bool SniffFile(const std::string& path, FileSniff& sniff);
+
+/** Classify first block of a file, see SniffFile(). */
+VdrFileFormat ClassifyHead(const std::string& head);
+
+#endif  // FILE_SNIFFER_H_
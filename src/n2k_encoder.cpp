@@ -0,0 +1,314 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement n2k_encoder.h
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "n2k_encoder.h"
+
+static constexpr uint8_t kDle = 0x10;
+static constexpr uint8_t kStx = 0x02;
+static constexpr uint8_t kEtx = 0x03;
+static constexpr uint8_t kN2kMsgReceived = 0x93;
+
+/** Size of the Actisense header following the length byte. */
+static constexpr size_t kActisenseHeaderLen = 11;
+
+/** Worst case output: a 223 byte fast packet as 32 YD RAW lines. */
+static constexpr size_t kMaxEncodedSize = 2048;
+
+static constexpr uint32_t kCanEffFlag = 0x80000000U;
+
+static const char* const kHexDigits = "0123456789ABCDEF";
+
+static int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+/** Decode hex digits into bytes, return number of bytes or -1 on errors. */
+static int DecodeHex(const char* hex, size_t length, uint8_t* out,
+                     size_t out_size) {
+  if (length % 2 != 0 || length / 2 > out_size) return -1;
+  for (size_t i = 0; i < length; i += 2) {
+    int hi = HexValue(hex[i]);
+    int lo = HexValue(hex[i + 1]);
+    if (hi < 0 || lo < 0) return -1;
+    out[i / 2] = static_cast<uint8_t>(hi << 4 | lo);
+  }
+  return static_cast<int>(length / 2);
+}
+
+/** Parse hex number in [begin, end), return false on bad digits. */
+static bool ParseHexNumber(const char* begin, const char* end,
+                           uint32_t& value) {
+  if (begin == end) return false;
+  value = 0;
+  for (const char* p = begin; p < end; ++p) {
+    int v = HexValue(*p);
+    if (v < 0) return false;
+    value = value << 4 | static_cast<uint32_t>(v);
+  }
+  return true;
+}
+
+/** Parse decimal number in [begin, end), return false on bad digits. */
+static bool ParseDecNumber(const char* begin, const char* end,
+                           uint32_t& value) {
+  if (begin == end) return false;
+  value = 0;
+  for (const char* p = begin; p < end; ++p) {
+    if (*p < '0' || *p > '9') return false;
+    value = value * 10 + static_cast<uint32_t>(*p - '0');
+  }
+  return true;
+}
+
+bool ParseOcpnN2kPayload(const uint8_t* payload, size_t length,
+                         N2kMessage& msg) {
+  if (length < 2 + kActisenseHeaderLen) return false;
+  msg.priority = payload[2] & 0x7;
+  msg.pgn = payload[3] | (payload[4] << 8) | ((payload[5] & 0x03) << 16);
+  msg.destination = payload[6];
+  msg.source = payload[7];
+  size_t data_len = payload[12];
+  data_len = std::min(data_len, length - 2 - kActisenseHeaderLen);
+  data_len = std::min(data_len, N2kMessage::kMaxDataLen);
+  msg.data_len = static_cast<uint8_t>(data_len);
+  std::memcpy(msg.data, payload + 2 + kActisenseHeaderLen, data_len);
+  return true;
+}
+
+bool ParseOcpnN2kHex(const char* hex, size_t length, N2kMessage& msg) {
+  uint8_t buff[2 + kActisenseHeaderLen + N2kMessage::kMaxDataLen];
+  int count = DecodeHex(hex, length, buff, sizeof(buff));
+  if (count < 0) return false;
+  return ParseOcpnN2kPayload(buff, static_cast<size_t>(count), msg);
+}
+
+bool ParsePcdin(const char* line, size_t length, N2kMessage& msg) {
+  static const char* const kPcdin = "$PCDIN,";
+  const size_t prefix_len = std::strlen(kPcdin);
+  if (length < prefix_len || std::strncmp(line, kPcdin, prefix_len) != 0)
+    return false;
+  const char* end = line + length;
+  while (end > line && (end[-1] == '\r' || end[-1] == '\n')) --end;
+  const char* star = std::find(line, end, '*');
+  end = star;
+
+  // Split fields after the "$PCDIN," tag.
+  const char* fields[5];
+  const char* field_ends[5];
+  size_t n_fields = 0;
+  const char* p = line + prefix_len;
+  while (n_fields < 5) {
+    const char* comma = std::find(p, end, ',');
+    fields[n_fields] = p;
+    field_ends[n_fields] = comma;
+    n_fields += 1;
+    if (comma == end) break;
+    p = comma + 1;
+  }
+  if (n_fields == 2) {
+    // VDR raw recording: $PCDIN,<pgn>,<GetN2000Payload() as hex>
+    uint32_t pgn;
+    if (!ParseDecNumber(fields[0], field_ends[0], pgn)) return false;
+    if (!ParseOcpnN2kHex(fields[1], field_ends[1] - fields[1], msg))
+      return false;
+    msg.pgn = pgn;
+    return true;
+  }
+  if (n_fields == 4) {
+    // SeaSmart: $PCDIN,<pgn>,<timestamp>,<source>,<data>*hh
+    uint32_t pgn;
+    uint32_t source;
+    if (!ParseHexNumber(fields[0], field_ends[0], pgn)) return false;
+    if (!ParseHexNumber(fields[2], field_ends[2], source)) return false;
+    int count = DecodeHex(fields[3], field_ends[3] - fields[3], msg.data,
+                          N2kMessage::kMaxDataLen);
+    if (count < 0) return false;
+    msg.pgn = pgn;
+    msg.source = static_cast<uint8_t>(source);
+    msg.destination = 255;
+    msg.priority = 6;
+    msg.data_len = static_cast<uint8_t>(count);
+    return true;
+  }
+  return false;
+}
+
+uint32_t N2kCanId(const N2kMessage& msg) {
+  uint32_t id = static_cast<uint32_t>(msg.priority & 0x7) << 26;
+  const uint32_t pf = (msg.pgn >> 8) & 0xFF;
+  if (pf < 240) {
+    // PDU1, addressed: PS field holds destination.
+    id |= (msg.pgn & 0x3FF00) << 8;
+    id |= static_cast<uint32_t>(msg.destination) << 8;
+  } else {
+    id |= (msg.pgn & 0x3FFFF) << 8;
+  }
+  return id | msg.source;
+}
+
+void AppendPcdin(const N2kMessage& msg, std::string& out) {
+  const size_t start = out.size();
+  auto put_hex = [&out](uint32_t value, int digits) {
+    for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4)
+      out.push_back(kHexDigits[(value >> shift) & 0xF]);
+  };
+  out.append("$PCDIN,");
+  put_hex(msg.pgn, 6);
+  out.append(",00000000,");
+  put_hex(msg.source, 2);
+  out.push_back(',');
+  for (size_t i = 0; i < msg.data_len; i++) put_hex(msg.data[i], 2);
+  uint8_t checksum = 0;
+  for (size_t i = start + 1; i < out.size(); i++)
+    checksum ^= static_cast<uint8_t>(out[i]);
+  out.push_back('*');
+  put_hex(checksum, 2);
+}
+
+N2kEncoder::N2kEncoder(N2kNetFormat format)
+    : m_format(format), m_fast_packet_seq(0) {
+  m_buffer.reserve(kMaxEncodedSize);
+}
+
+const std::vector<uint8_t>& N2kEncoder::Encode(const N2kMessage& msg,
+                                               uint32_t ms_of_day) {
+  m_buffer.clear();
+  switch (m_format) {
+    case N2kNetFormat::kActisense:
+      EncodeActisense(msg);
+      break;
+    case N2kNetFormat::kYdRaw:
+      EncodeYdRaw(msg, ms_of_day);
+      break;
+    case N2kNetFormat::kSocketCan:
+      EncodeSocketCan(msg);
+      break;
+    case N2kNetFormat::kText:
+      break;
+  }
+  return m_buffer;
+}
+
+template <typename F>
+void N2kEncoder::ForEachFrame(const N2kMessage& msg, F f) {
+  uint8_t frame[8];
+  if (msg.data_len <= 8) {
+    std::memset(frame, 0xFF, sizeof(frame));
+    std::memcpy(frame, msg.data, msg.data_len);
+    f(frame, msg.data_len);
+    return;
+  }
+  const uint8_t seq = static_cast<uint8_t>((m_fast_packet_seq & 0x7) << 5);
+  m_fast_packet_seq = (m_fast_packet_seq + 1) & 0x7;
+  size_t pos = 0;
+  for (uint8_t index = 0; pos < msg.data_len; ++index) {
+    std::memset(frame, 0xFF, sizeof(frame));
+    frame[0] = seq | (index & 0x1F);
+    size_t offset = 1;
+    if (index == 0) frame[offset++] = msg.data_len;
+    size_t count = std::min(sizeof(frame) - offset, msg.data_len - pos);
+    std::memcpy(frame + offset, msg.data + pos, count);
+    pos += count;
+    f(frame, 8);
+  }
+}
+
+void N2kEncoder::EncodeActisense(const N2kMessage& msg) {
+  uint8_t sum = 0;
+  auto put = [&](uint8_t b) {
+    sum += b;
+    m_buffer.push_back(b);
+    if (b == kDle) m_buffer.push_back(kDle);
+  };
+  m_buffer.push_back(kDle);
+  m_buffer.push_back(kStx);
+  put(kN2kMsgReceived);
+  put(static_cast<uint8_t>(kActisenseHeaderLen + msg.data_len));
+  put(msg.priority & 0x7);
+  put(msg.pgn & 0xFF);
+  put((msg.pgn >> 8) & 0xFF);
+  put((msg.pgn >> 16) & 0x03);
+  put(msg.destination);
+  put(msg.source);
+  for (int i = 0; i < 4; ++i) put(0);  // timestamp
+  put(msg.data_len);
+  for (size_t i = 0; i < msg.data_len; ++i) put(msg.data[i]);
+  put(static_cast<uint8_t>(256 - sum));
+  m_buffer.push_back(kDle);
+  m_buffer.push_back(kEtx);
+}
+
+void N2kEncoder::EncodeYdRaw(const N2kMessage& msg, uint32_t ms_of_day) {
+  // hh:mm:ss.sss R 09F80115 A0 7D E6 18 00 00 00 00\r\n
+  char stamp[13];
+  uint32_t ms = ms_of_day % (24 * 3600 * 1000);
+  const unsigned fields[] = {ms / 3600000, ms / 60000 % 60, ms / 1000 % 60};
+  char* s = stamp;
+  for (int i = 0; i < 3; ++i) {
+    *s++ = static_cast<char>('0' + fields[i] / 10);
+    *s++ = static_cast<char>('0' + fields[i] % 10);
+    *s++ = i < 2 ? ':' : '.';
+  }
+  *s++ = static_cast<char>('0' + ms % 1000 / 100);
+  *s++ = static_cast<char>('0' + ms % 100 / 10);
+  *s++ = static_cast<char>('0' + ms % 10);
+
+  const uint32_t can_id = N2kCanId(msg);
+  ForEachFrame(msg, [&](const uint8_t* frame, size_t length) {
+    m_buffer.insert(m_buffer.end(), stamp, stamp + sizeof(stamp) - 1);
+    m_buffer.push_back(' ');
+    m_buffer.push_back('R');
+    m_buffer.push_back(' ');
+    for (int shift = 28; shift >= 0; shift -= 4)
+      m_buffer.push_back(kHexDigits[(can_id >> shift) & 0xF]);
+    for (size_t i = 0; i < length; ++i) {
+      m_buffer.push_back(' ');
+      m_buffer.push_back(kHexDigits[frame[i] >> 4]);
+      m_buffer.push_back(kHexDigits[frame[i] & 0xF]);
+    }
+    m_buffer.push_back('\r');
+    m_buffer.push_back('\n');
+  });
+}
+
+void N2kEncoder::EncodeSocketCan(const N2kMessage& msg) {
+  // struct can_frame: u32 can_id, u8 len, u8 pad, u8 res0, u8 len8_dlc,
+  // u8 data[8]. Little endian as on all supported SocketCAN hosts.
+  const uint32_t can_id = N2kCanId(msg) | kCanEffFlag;
+  ForEachFrame(msg, [&](const uint8_t* frame, size_t length) {
+    for (int shift = 0; shift < 32; shift += 8)
+      m_buffer.push_back(static_cast<uint8_t>(can_id >> shift));
+    m_buffer.push_back(static_cast<uint8_t>(length));
+    m_buffer.push_back(0);
+    m_buffer.push_back(0);
+    m_buffer.push_back(0);
+    for (size_t i = 0; i < 8; ++i)
+      m_buffer.push_back(i < length ? frame[i] : 0);
+  });
+}
@@ -0,0 +1,127 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Decoding of recorded NMEA 2000 messages and encoding into binary gateway
+ * framings used when replaying over the network.
+ */
+
+#ifndef N2K_ENCODER_H_
+#define N2K_ENCODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "commons.h"
+
+/**
+ * A single, fully assembled NMEA 2000 message.
+ *
+ * Fixed size storage so that decoding and encoding never allocates.
+ */
+struct N2kMessage {
+  static constexpr size_t kMaxDataLen = 223;  //!< Max fast-packet payload
+
+  uint32_t pgn;
+  uint8_t priority;
+  uint8_t source;
+  uint8_t destination;
+  uint8_t data_len;
+  uint8_t data[kMaxDataLen];
+
+  N2kMessage()
+      : pgn(0), priority(6), source(0), destination(255), data_len(0) {}
+};
+
+/**
+ * Decode a payload as returned by GetN2000Payload(), i. e. an Actisense
+ * BST 0x93 message without DLE framing:
+ *
+ *   [0] 0x93, [1] length, [2] priority, [3..5] PGN, [6] destination,
+ *   [7] source, [8..11] timestamp, [12] data length, [13..] data
+ *
+ * @return true if payload could be decoded.
+ */
+bool ParseOcpnN2kPayload(const uint8_t* payload, size_t length,
+                         N2kMessage& msg);
+
+/**
+ * Decode a hex encoded GetN2000Payload() payload, as stored in the message
+ * column of CSV recordings.
+ */
+bool ParseOcpnN2kHex(const char* hex, size_t length, N2kMessage& msg);
+
+/**
+ * Decode a $PCDIN line. Handles both the SeaSmart layout
+ * ($PCDIN,<pgn hex>,<timestamp hex>,<src hex>,<data hex>*hh) and the
+ * layout used by raw VDR recordings ($PCDIN,<pgn>,<payload hex>).
+ */
+bool ParsePcdin(const char* line, size_t length, N2kMessage& msg);
+
+/**
+ * Encode N2kMessage instances into a gateway framing. The output buffer is
+ * allocated once by the constructor and reused for all messages.
+ */
+class N2kEncoder {
+public:
+  explicit N2kEncoder(N2kNetFormat format = N2kNetFormat::kActisense);
+
+  void SetFormat(N2kNetFormat format) { m_format = format; }
+
+  [[nodiscard]] N2kNetFormat GetFormat() const { return m_format; }
+
+  /**
+   * Encode message according to current format.
+   * @param msg Message to encode.
+   * @param ms_of_day Milliseconds since midnight UTC, used by YD RAW.
+   * @return Encoded bytes, valid until next call. Empty if format is
+   *     kText or message cannot be encoded.
+   */
+  const std::vector<uint8_t>& Encode(const N2kMessage& msg,
+                                     uint32_t ms_of_day);
+
+private:
+  N2kNetFormat m_format;
+  std::vector<uint8_t> m_buffer;
+  uint8_t m_fast_packet_seq;  //!< 3-bit fast packet sequence counter
+
+  void EncodeActisense(const N2kMessage& msg);
+  void EncodeYdRaw(const N2kMessage& msg, uint32_t ms_of_day);
+  void EncodeSocketCan(const N2kMessage& msg);
+
+  /**
+   * Split message into CAN frames, single frame or fast packet.
+   * @param f Invoked as f(frame_data, frame_length) for each frame.
+   */
+  template <typename F>
+  void ForEachFrame(const N2kMessage& msg, F f);
+};
+
+/** Return 29-bit CAN identifier for message. */
+uint32_t N2kCanId(const N2kMessage& msg);
+
+/**
+ * Append msg as a SeaSmart sentence, $PCDIN,<pgn>,<timestamp>,<src>,<data>*hh
+ * without line ending, to out.
+ */
+void AppendPcdin(const N2kMessage& msg, std::string& out);
+
+#endif  // N2K_ENCODER_H_
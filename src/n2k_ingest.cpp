@@ -0,0 +1,199 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement n2k_ingest.h
+ */
+
+#include <cctype>
+
+#include "n2k_ingest.h"
+
+/** PGNs recorded by default. */
+static const struct {
+  uint32_t pgn;
+  const char* name;
+} kDefaultPgns[] = {
+    // System & ISO messages
+    {59392, "ISO Acknowledgement"},
+    {59904, "ISO Request"},
+    {60160, "ISO Transport Protocol, Data Transfer"},
+    {60416, "ISO Transport Protocol, Connection Management"},
+    {60928, "ISO Address Claim"},
+    {61184, "Manufacturer Proprietary Single Frame"},
+    {65280, "Manufacturer Proprietary Single Frame"},
+
+    // B&G Proprietary
+    {65305, "B&G AC12 Autopilot Status"},
+    {65309, "B&G WS320 Wind Sensor Battery Status"},
+    {65312, "B&G WS320 Wind Sensor Wireless Status"},
+    {65340, "B&G AC12 Autopilot Mode"},
+    {65341, "B&G AC12 Wind Angle"},
+
+    // Time & Navigation
+    {126992, "System Time"},
+    {127233, "MOB (Man Overboard) Data"},
+    {127237, "Heading/Track Control"},
+    {127245, "Rudder Angle"},
+    {127250, "Vessel Heading"},
+    {127251, "Rate of Turn"},
+    {127252, "Heave"},
+    {127257, "Vessel Attitude (Roll/Pitch)"},
+    {127258, "Magnetic Variation"},
+    {128259, "Speed Through Water"},
+    {128267, "Water Depth Below Transducer"},
+    {128275, "Distance Log (Total/Trip)"},
+    {128777, "Anchor Windlass Status"},
+    {129025, "Position Rapid Update (Lat/Lon)"},
+    {129026, "Course/Speed Over Ground (COG/SOG)"},
+    {129029, "GNSS Position Data"},
+    {129283, "Cross Track Error"},
+    {129284, "Navigation Data (WP Info)"},
+    {129285, "Navigation Route/WP Info"},
+    {129540, "GNSS Satellites in View"},
+    {130577, "Direction Data (Set/Drift)"},
+
+    // AIS
+    {129038, "AIS Class A Position Report"},
+    {129039, "AIS Class B Position Report"},
+    {129793, "AIS UTC and Date Report"},
+    {129794, "AIS Class A Static Data"},
+    {129798, "AIS SAR Aircraft Position"},
+    {129802, "AIS Safety Broadcast"},
+
+    // Environmental & Systems
+    {127488, "Engine Parameters, Rapid"},
+    {127489, "Engine Parameters, Dynamic"},
+    {127505, "Fluid Level"},
+    {127508, "Battery Status"},
+    {130306, "Wind Speed/Angle"},
+    {130310, "Environmental Parameters (Air/Water)"},
+    {130311, "Environmental Parameters (Alt Format)"},
+    {130313, "Humidity"},
+    {130314, "Actual Pressure"},
+    {130316, "Temperature Extended Range"}};
+
+/** Max probes in the hash table before giving up on a source and PGN. */
+static constexpr size_t kProbes = 8;
+
+/** 64 bit FNV-1a hash of destination and data of msg. */
+static uint64_t Hash(const N2kMessage& msg) {
+  uint64_t hash = (14695981039346656037ULL ^ msg.destination) *
+                  1099511628211ULL;
+  for (size_t i = 0; i < msg.data_len; i++) {
+    hash ^= msg.data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+N2kIngest::N2kIngest() : m_interval(0), m_checked(0), m_repeats(0) {
+  for (const auto& pgn : kDefaultPgns) m_allowed.set(pgn.pgn);
+}
+
+bool N2kIngest::SetAllowList(const std::string& list, std::string& error) {
+  m_allowed.reset();
+  error.clear();
+  std::string item;
+  bool empty = true;
+  for (size_t pos = 0; pos <= list.size(); pos++) {
+    const char c = pos < list.size() ? list[pos] : ',';
+    if (c != ',' && c != ';' && !std::isspace(static_cast<unsigned char>(c))) {
+      item += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+      continue;
+    }
+    if (item.empty()) continue;
+    empty = false;
+    if (item == kDefaultList) {
+      for (const auto& pgn : kDefaultPgns) m_allowed.set(pgn.pgn);
+      item.clear();
+      continue;
+    }
+    const bool remove = item[0] == '!';
+    const std::string number = item.substr(remove ? 1 : 0);
+    if (number.empty() || number.size() > 6 ||
+        number.find_first_not_of("0123456789") != std::string::npos ||
+        std::stoul(number) >= kPgnCount) {
+      error = "Invalid PGN in recorded PGN list: " + item;
+      break;
+    }
+    m_allowed.set(std::stoul(number), !remove);
+    item.clear();
+  }
+  if (empty || !error.empty()) {
+    m_allowed.reset();
+    for (const auto& pgn : kDefaultPgns) m_allowed.set(pgn.pgn);
+  }
+  return error.empty();
+}
+
+std::vector<uint32_t> N2kIngest::GetAllowedPgns() const {
+  std::vector<uint32_t> pgns;
+  for (uint32_t pgn = 0; pgn < kPgnCount; pgn++) {
+    if (m_allowed[pgn]) pgns.push_back(pgn);
+  }
+  return pgns;
+}
+
+void N2kIngest::SetRepeatInterval(std::chrono::milliseconds interval) {
+  using std::chrono::microseconds;
+  const auto count = std::chrono::duration_cast<microseconds>(interval).count();
+  m_interval = count > 0 ? static_cast<uint64_t>(count) : 0;
+  if (m_interval == 0) {
+    std::vector<Entry>().swap(m_entries);
+  } else if (m_entries.empty()) {
+    m_entries.resize(kCapacity);
+  }
+  Clear();
+}
+
+void N2kIngest::Clear() {
+  for (auto& entry : m_entries) entry = Entry{0, 0, 0, 0};
+}
+
+bool N2kIngest::IsRepeat(const N2kMessage& msg, uint64_t now_us) {
+  // Never 0, PGNs are 17 bits.
+  const uint32_t key = 1U << 25 | uint32_t{msg.source} << 17 | msg.pgn;
+  const uint64_t hash = Hash(msg);
+  // Fibonacci hashing, the top 10 bits of the product depend on all key
+  // bits, source included.
+  static_assert(kCapacity == 1 << 10, "Slot is 10 bits");
+  const uint64_t slot = (uint64_t{key} * 11400714819323198485ULL) >> 54;
+  for (size_t i = 0; i < kProbes; i++) {
+    Entry& entry = m_entries[(slot + i) % kCapacity];
+    if (entry.key != key && entry.key != 0) continue;
+    // Also recorded if the clock went backwards.
+    if (entry.key == key && entry.hash == hash && entry.len == msg.data_len &&
+        now_us >= entry.time && now_us - entry.time < m_interval) {
+      return true;
+    }
+    entry = Entry{key, msg.data_len, hash, now_us};
+    return false;
+  }
+  return false;
+}
+
+bool N2kIngest::Accept(const N2kMessage& msg, uint64_t now_us) {
+  if (!IsAllowed(msg.pgn)) return false;
+  if (m_entries.empty()) return true;
+  m_checked += 1;
+  if (!IsRepeat(msg, now_us)) return true;
+  m_repeats += 1;
+  return false;
+}
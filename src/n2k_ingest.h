@@ -0,0 +1,121 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Filtering of received NMEA 2000 messages before recording: a PGN allow
+ * list and suppression of unchanged repeats. Runs for every message on
+ * the bus, so there are no allocations after configuration.
+ */
+
+#ifndef N2K_INGEST_H_
+#define N2K_INGEST_H_
+
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "n2k_encoder.h"
+
+/**
+ * Decides which fully assembled NMEA 2000 messages are recorded. Fast
+ * packets are reassembled by OpenCPN before messages reach the plugin.
+ *
+ * The allow list is a bitset indexed by PGN. Optionally, a message with
+ * the same data as the last one with the same PGN from the same source is
+ * dropped unless the repeat interval has passed since it was recorded, so
+ * static data like tank levels is still recorded now and then.
+ */
+class N2kIngest {
+public:
+  /** Number of possible PGNs. */
+  static constexpr uint32_t kPgnCount = 0x20000;
+
+  /** Max number of source and PGN pairs tracked for repeats. */
+  static constexpr size_t kCapacity = 1024;
+
+  /** Sentinel in allow lists, the PGNs recorded by default. */
+  static constexpr const char* kDefaultList = "default";
+
+  /** Allow the default PGNs, repeats are not suppressed. */
+  N2kIngest();
+
+  /**
+   * Set allowed PGNs from a list like "default, 130312, !127257", where
+   * "default" adds the default PGNs and a leading '!' removes a PGN. An
+   * empty list means "default".
+   * @return false on syntax errors, the default PGNs are then allowed and
+   *     error describes the problem.
+   */
+  bool SetAllowList(const std::string& list, std::string& error);
+
+  /** Return true if PGN is in the allow list. */
+  [[nodiscard]] bool IsAllowed(uint32_t pgn) const {
+    return pgn < kPgnCount && m_allowed[pgn];
+  }
+
+  /** Return allowed PGNs in ascending order, used for subscriptions. */
+  [[nodiscard]] std::vector<uint32_t> GetAllowedPgns() const;
+
+  /**
+   * Set how long unchanged repeats are dropped, 0 disables it and releases
+   * the table.
+   */
+  void SetRepeatInterval(std::chrono::milliseconds interval);
+
+  /**
+   * Return true if msg received at now_us, a monotonic time in
+   * microseconds, is allowed and not an unchanged repeat.
+   */
+  bool Accept(const N2kMessage& msg, uint64_t now_us);
+
+  /** Forget the last seen data. */
+  void Clear();
+
+  /** Return number of messages checked by Accept(). */
+  [[nodiscard]] uint64_t GetChecked() const { return m_checked; }
+
+  /** Return number of unchanged repeats dropped. */
+  [[nodiscard]] uint64_t GetRepeats() const { return m_repeats; }
+
+  /** Reset the counters. */
+  void ResetCounts() { m_checked = m_repeats = 0; }
+
+private:
+  /** Last seen data for a source and PGN, free if key is 0. */
+  struct Entry {
+    uint32_t key;
+    uint32_t len;
+    uint64_t hash;  //!< Of destination and data
+    uint64_t time;  //!< When last recorded, microseconds
+  };
+
+  /** Return true if msg has the same data as last time. */
+  bool IsRepeat(const N2kMessage& msg, uint64_t now_us);
+
+  std::bitset<kPgnCount> m_allowed;
+  uint64_t m_interval;  //!< Repeat interval in microseconds, 0 if disabled
+  std::vector<Entry> m_entries;  //!< Open addressing hash table
+  uint64_t m_checked;
+  uint64_t m_repeats;
+};
+
+#endif  // N2K_INGEST_H_
@@ -0,0 +1,90 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement pre_record_buffer.h
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "pre_record_buffer.h"
+
+PreRecordBuffer::PreRecordBuffer()
+    : m_max_age(0), m_head(0), m_used(0), m_first(0), m_count(0) {}
+
+void PreRecordBuffer::SetLimits(std::chrono::seconds max_age,
+                                size_t max_bytes) {
+  if (max_age.count() <= 0) max_bytes = 0;
+  m_max_age = max_age;
+  if (max_bytes != m_data.size()) {
+    std::vector<char>(max_bytes).swap(m_data);
+    std::vector<Entry>(max_bytes / kMinMessageSize).swap(m_entries);
+  }
+  Clear();
+}
+
+void PreRecordBuffer::Clear() {
+  m_head = 0;
+  m_used = 0;
+  m_first = 0;
+  m_count = 0;
+}
+
+void PreRecordBuffer::PopFront() {
+  const Entry& entry = m_entries[m_first];
+  m_head = (m_head + entry.len) % m_data.size();
+  m_used -= entry.len;
+  m_first = (m_first + 1) % m_entries.size();
+  m_count -= 1;
+}
+
+void PreRecordBuffer::Expire(Clock::time_point now) {
+  while (m_count > 0 && now - m_entries[m_first].time > m_max_age) {
+    PopFront();
+  }
+}
+
+void PreRecordBuffer::Push(const char* data, size_t len,
+                           Clock::time_point now) {
+  const size_t size = m_data.size();
+  if (len == 0 || len > size || m_entries.empty()) return;
+  Expire(now);
+  while (m_count == m_entries.size() || m_used + len > size) PopFront();
+
+  // Copy to the free space following the used part, wrapping at the end.
+  const size_t tail = (m_head + m_used) % size;
+  const size_t first_part = std::min(len, size - tail);
+  std::memcpy(&m_data[tail], data, first_part);
+  std::memcpy(&m_data[0], data + first_part, len - first_part);
+  m_used += len;
+  m_entries[(m_first + m_count) % m_entries.size()] = {
+      now, static_cast<uint32_t>(len)};
+  m_count += 1;
+}
+
+void PreRecordBuffer::Flush(const Writer& writer, Clock::time_point now) {
+  Expire(now);
+  if (m_used > 0) {
+    const size_t first_part = std::min(m_used, m_data.size() - m_head);
+    writer(&m_data[m_head], first_part);
+    if (first_part < m_used) writer(&m_data[0], m_used - first_part);
+  }
+  Clear();
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * In memory buffer of the most recent formatted messages while not
+ * recording, written first to the file when recording starts.
+ */
+
+#ifndef PRE_RECORD_BUFFER_H_
+#define PRE_RECORD_BUFFER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * Ring buffer keeping formatted messages for at most a given time and a
+ * given number of bytes. Memory is allocated by SetLimits(), Push() just
+ * copies into the fixed size arena and evicts the oldest messages.
+ */
+class PreRecordBuffer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /** Callback writing a chunk of buffered data. */
+  using Writer = std::function<void(const char* data, size_t len)>;
+
+  /** Assumed minimum average message size when sizing the index. */
+  static constexpr size_t kMinMessageSize = 16;
+
+  PreRecordBuffer();
+
+  /**
+   * Set limits, clearing the buffer. A zero limit disables buffering and
+   * releases the memory.
+   * @param max_age Max age of buffered messages.
+   * @param max_bytes Size of arena holding message data.
+   */
+  void SetLimits(std::chrono::seconds max_age, size_t max_bytes);
+
+  /** Return true if SetLimits() enabled buffering. */
+  [[nodiscard]] bool IsEnabled() const { return !m_data.empty(); }
+
+  /**
+   * Add a message received at given time, evicting the oldest messages as
+   * needed. Messages larger than the arena are dropped.
+   */
+  void Push(const char* data, size_t len, Clock::time_point now = Clock::now());
+
+  /**
+   * Pass buffered messages not older than max_age to writer, oldest first,
+   * in at most two chunks. The buffer is then empty.
+   */
+  void Flush(const Writer& writer, Clock::time_point now = Clock::now());
+
+  /** Discard all buffered messages. */
+  void Clear();
+
+  /** Return number of buffered messages. */
+  [[nodiscard]] size_t GetCount() const { return m_count; }
+
+  /** Return number of buffered bytes. */
+  [[nodiscard]] size_t GetSize() const { return m_used; }
+
+private:
+  /** Index entry for a message in m_data. */
+  struct Entry {
+    Clock::time_point time;
+    uint32_t len;
+  };
+
+  /** Drop oldest message. */
+  void PopFront();
+
+  /** Drop messages older than max age. */
+  void Expire(Clock::time_point now);
+
+  Clock::duration m_max_age;
+  std::vector<char> m_data;  //!< Arena, byte ring buffer
+  size_t m_head;             //!< Offset of oldest byte in m_data
+  size_t m_used;             //!< Bytes used in m_data
+
+  std::vector<Entry> m_entries;  //!< Message ring buffer
+  size_t m_first;                //!< Index of oldest message
+  size_t m_count;                //!< Number of messages
+};
+
+#endif  // PRE_RECORD_BUFFER_H_
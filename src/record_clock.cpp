@@ -0,0 +1,62 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement record_clock.h
+ */
+
+#include "record_clock.h"
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+uint64_t RecordClock::Now() {
+  const Clock::time_point mono = Clock::now();
+  if (mono >= m_next_check) Check(mono, SystemClock::now());
+  return Stamp(mono);
+}
+
+uint64_t RecordClock::Now(Clock::time_point mono, SystemClock::time_point utc) {
+  if (mono >= m_next_check) Check(mono, utc);
+  return Stamp(mono);
+}
+
+void RecordClock::Check(Clock::time_point mono, SystemClock::time_point utc) {
+  m_next_check = mono + kCheckInterval;
+  const int64_t utc_us =
+      duration_cast<microseconds>(utc.time_since_epoch()).count();
+  const int64_t derived =
+      m_utc_base + duration_cast<microseconds>(mono - m_mono_base).count();
+  const int64_t max_drift = duration_cast<microseconds>(kMaxDrift).count();
+  const int64_t drift = utc_us - derived;
+  if (m_anchored && drift <= max_drift && drift >= -max_drift) return;
+  // Follow a step backwards rather than stalling until it is caught up.
+  if (m_anchored && drift < 0) m_last = 0;
+  m_anchored = true;
+  m_mono_base = mono;
+  m_utc_base = utc_us;
+}
+
+uint64_t RecordClock::Stamp(Clock::time_point mono) {
+  const int64_t us =
+      m_utc_base + duration_cast<microseconds>(mono - m_mono_base).count();
+  m_last = us > static_cast<int64_t>(m_last) ? static_cast<uint64_t>(us)
+                                              : m_last + 1;
+  return m_last;
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Receive timestamps for recorded messages. All protocols are stamped by
+ * the same clock so that messages in a recording are ordered and spaced
+ * as received, regardless of their type.
+ */
+
+#ifndef RECORD_CLOCK_H_
+#define RECORD_CLOCK_H_
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * UTC time derived from the monotonic steady clock, anchored to the system
+ * clock. Timestamps are strictly increasing and thus unique, and are not
+ * affected by system clock jitter. The system clock is only read once per
+ * kCheckInterval; if it has drifted more than kMaxDrift, e.g. when set
+ * from GPS, the clock is anchored again and follows the step.
+ */
+class RecordClock {
+public:
+  using Clock = std::chrono::steady_clock;
+  using SystemClock = std::chrono::system_clock;
+
+  /** Time between checks of the system clock. */
+  static constexpr std::chrono::seconds kCheckInterval{1};
+
+  /** Max difference to the system clock before anchoring again. */
+  static constexpr std::chrono::milliseconds kMaxDrift{100};
+
+  RecordClock() : m_anchored(false), m_utc_base(0), m_last(0) {}
+
+  /** Return current time, microseconds since 1/1 1970 UTC. */
+  uint64_t Now();
+
+  /**
+   * Return time for given steady clock time, utc is the corresponding
+   * system clock time, only used if a check is due.
+   */
+  uint64_t Now(Clock::time_point mono, SystemClock::time_point utc);
+
+private:
+  /** Anchor to utc if not anchored or if drift exceeds kMaxDrift. */
+  void Check(Clock::time_point mono, SystemClock::time_point utc);
+
+  /** Return strictly increasing timestamp for mono. */
+  uint64_t Stamp(Clock::time_point mono);
+
+  bool m_anchored;
+  Clock::time_point m_mono_base;  //!< Steady time when anchored
+  int64_t m_utc_base;             //!< UTC microseconds when anchored
+  Clock::time_point m_next_check;
+  uint64_t m_last;  //!< Last returned timestamp
+};
+
+#endif  // RECORD_CLOCK_H_
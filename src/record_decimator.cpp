@@ -0,0 +1,224 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement record_decimator.h
+ */
+
+#include <cctype>
+#include <cstring>
+
+#include "record_decimator.h"
+
+/** Key bits telling NMEA 0183 and NMEA 2000 keys apart, never 0. */
+static constexpr uint64_t kSentenceTag = 1ULL << 56;
+static constexpr uint64_t kPgnTag = 2ULL << 56;
+
+/** Max probes in the hash table before giving up on a message kind. */
+static constexpr size_t kProbes = 16;
+
+/** Sentence types whose parts are numbered in fields 1 and 2. */
+static constexpr const char* kMultipartTypes[] = {"GSV", "RTE", "TXT", "VDM",
+                                                  "VDO"};
+
+/** Return count characters packed into an integer. */
+static uint64_t Pack(const char* chars, size_t count) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < count; i++) {
+    value = (value << 8) | static_cast<unsigned char>(chars[i]);
+  }
+  return value;
+}
+
+/**
+ * Return part number of a multipart sentence like $GPGSV,3,2,..., 0 if
+ * sentence is not split into parts.
+ */
+static unsigned GetPartNumber(const char* sentence, size_t len) {
+  bool multipart = false;
+  for (const char* type : kMultipartTypes) {
+    multipart = multipart || std::memcmp(sentence + 3, type, 3) == 0;
+  }
+  if (!multipart || len < 7 || sentence[6] != ',') return 0;
+  size_t pos = 7;
+  for (int field = 1; field <= 2; field++) {
+    unsigned value = 0;
+    const size_t start = pos;
+    while (pos < len && pos - start < 3 &&
+           std::isdigit(static_cast<unsigned char>(sentence[pos]))) {
+      value = value * 10 + (sentence[pos++] - '0');
+    }
+    if (pos == start) return 0;
+    if (field == 2) return value;
+    if (pos >= len || sentence[pos++] != ',') return 0;
+  }
+  return 0;
+}
+
+/**
+ * Parse interval in seconds, like 10 or 0.5, or "off".
+ * @return false on syntax errors.
+ */
+static bool ParseInterval(const std::string& text, uint64_t never,
+                          uint64_t& interval) {
+  if (text == "OFF") {
+    interval = never;
+    return true;
+  }
+  // Parsed by hand, strtod() depends on the locale decimal point.
+  uint64_t us = 0;
+  uint64_t scale = 1000000;
+  bool fraction = false;
+  bool digits = false;
+  for (char c : text) {
+    if (c == '.' && !fraction) {
+      fraction = true;
+    } else if (std::isdigit(static_cast<unsigned char>(c)) && !fraction) {
+      if (us > 1000000ULL * 1000000000ULL) return false;
+      us = us * 10 + (c - '0') * 1000000ULL;
+      digits = true;
+    } else if (std::isdigit(static_cast<unsigned char>(c))) {
+      scale /= 10;
+      us += (c - '0') * scale;
+      digits = true;
+    } else {
+      return false;
+    }
+  }
+  interval = us;
+  return digits;
+}
+
+bool RecordDecimator::SetPolicy(const std::string& policy,
+                                std::string& error) {
+  m_rules.clear();
+  error.clear();
+  std::string rule;
+  for (size_t pos = 0; pos <= policy.size(); pos++) {
+    const char c = pos < policy.size() ? policy[pos] : ',';
+    if (c != ',' && c != ';' && !std::isspace(static_cast<unsigned char>(c))) {
+      rule += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+      continue;
+    }
+    if (rule.empty()) continue;
+    const size_t equals = rule.find('=');
+    const std::string name = rule.substr(0, equals);
+    uint64_t interval = 0;
+    bool ok = equals != std::string::npos &&
+              ParseInterval(rule.substr(equals + 1), kNever, interval);
+    uint64_t key = 0;
+    if (ok && !name.empty() && name.size() <= 6 &&
+        name.find_first_not_of("0123456789") == std::string::npos) {
+      const unsigned long pgn = std::stoul(name);
+      ok = pgn > 0 && pgn <= 0x1FFFF;
+      key = kPgnTag | pgn;
+    } else if (ok && (name.size() == 3 || name.size() == 5)) {
+      for (char n : name) {
+        ok = ok && std::isalnum(static_cast<unsigned char>(n));
+      }
+      key = kSentenceTag | (name.size() == 5 ? Pack(name.data(), 2) << 24 : 0) |
+            Pack(name.data() + name.size() - 3, 3);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      error = "Invalid recording policy rule: " + rule;
+      m_rules.clear();
+      break;
+    }
+    m_rules[key] = interval;
+    rule.clear();
+  }
+  if (m_rules.empty()) {
+    std::vector<Entry>().swap(m_entries);
+  } else if (m_entries.empty()) {
+    m_entries.resize(kCapacity);
+  }
+  Clear();
+  return error.empty();
+}
+
+void RecordDecimator::Clear() {
+  for (auto& entry : m_entries) entry = Entry{0, 0, 0, false, false};
+}
+
+RecordDecimator::Entry* RecordDecimator::Find(uint64_t key, uint64_t rule_key,
+                                              uint64_t fallback_key) {
+  // Fibonacci hashing spreads the packed characters over the table.
+  const uint64_t hash = (key * 11400714819323198485ULL) >> 32;
+  for (size_t i = 0; i < kProbes; i++) {
+    Entry& entry = m_entries[(hash + i) % kCapacity];
+    if (entry.key == key) return &entry;
+    if (entry.key != 0) continue;
+    auto rule = m_rules.find(rule_key);
+    if (rule == m_rules.end()) rule = m_rules.find(fallback_key);
+    entry = Entry{key, rule == m_rules.end() ? 0 : rule->second, 0, false,
+                  true};
+    return &entry;
+  }
+  return nullptr;
+}
+
+bool RecordDecimator::Keep(Entry& entry, uint64_t now_us) {
+  if (entry.interval == 0) return true;
+  if (entry.interval == kNever) return false;
+  // Also kept if the clock went backwards.
+  const uint64_t min_interval =
+      entry.interval - entry.interval / kJitterDivisor;
+  if (entry.recorded && now_us >= entry.last &&
+      now_us - entry.last < min_interval) {
+    return false;
+  }
+  entry.last = now_us;
+  entry.recorded = true;
+  return true;
+}
+
+bool RecordDecimator::KeepSentence(const char* sentence, size_t len,
+                                   uint64_t now_us) {
+  if (m_entries.empty() || len < 6 ||
+      (sentence[0] != '$' && sentence[0] != '!')) {
+    return true;
+  }
+  m_checked += 1;
+  const uint64_t type = Pack(sentence + 3, 3);
+  const uint64_t key = kSentenceTag | Pack(sentence + 1, 2) << 24 | type;
+  Entry* entry = Find(key, key, kSentenceTag | type);
+  if (!entry) return true;
+  bool keep;
+  if (GetPartNumber(sentence, len) > 1) {
+    keep = entry->keep_parts;
+  } else {
+    keep = Keep(*entry, now_us);
+    entry->keep_parts = keep;
+  }
+  if (!keep) m_dropped += 1;
+  return keep;
+}
+
+bool RecordDecimator::KeepPgn(uint32_t pgn, uint8_t source, uint64_t now_us) {
+  if (m_entries.empty()) return true;
+  m_checked += 1;
+  const uint64_t rule_key = kPgnTag | (pgn & 0x1FFFF);
+  Entry* entry = Find(rule_key | uint64_t{source} << 24, rule_key, rule_key);
+  if (!entry) return true;
+  const bool keep = Keep(*entry, now_us);
+  if (!keep) m_dropped += 1;
+  return keep;
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Thinning of high rate, low value data while recording, following a
+ * policy of minimum intervals per sentence type and per PGN.
+ */
+
+#ifndef RECORD_DECIMATOR_H_
+#define RECORD_DECIMATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Decides if a message is recorded given the time the previous message of
+ * the same kind was recorded. The policy is a list of rules like
+ *
+ *     GSV=60, GPGSA=10, HDT=1, XDR=off, 127257=1, 130312=5
+ *
+ * where the key is a sentence type for any talker, talker plus sentence
+ * type or a PGN, and the value is the minimum interval in seconds or "off"
+ * to not record it at all. Data without a rule is always recorded.
+ *
+ * Sentences are thinned per talker and sentence type, NMEA 2000 messages
+ * per PGN and source. Rules are resolved the first time a kind of message
+ * is seen, after that a message is handled with a lookup in a fixed size
+ * hash table. Sentences split over several parts such as GSV and AIS VDM
+ * are kept or dropped as a whole, decided by the first part.
+ */
+class RecordDecimator {
+public:
+  /** Max number of message kinds tracked, others are always recorded. */
+  static constexpr size_t kCapacity = 1024;
+
+  /** Intervals are shortened by 1/kJitterDivisor to allow for jitter. */
+  static constexpr uint64_t kJitterDivisor = 10;
+
+  RecordDecimator() : m_checked(0), m_dropped(0) {}
+
+  /**
+   * Set policy, see class description. An empty policy disables
+   * decimation.
+   * @return false on syntax errors, decimation is then disabled and
+   *     error describes the problem.
+   */
+  bool SetPolicy(const std::string& policy, std::string& error);
+
+  /** Return true if a policy with rules has been set. */
+  [[nodiscard]] bool IsEnabled() const { return !m_rules.empty(); }
+
+  /**
+   * Return true if NMEA 0183 sentence received at now_us, a monotonic
+   * time in microseconds, should be recorded.
+   */
+  bool KeepSentence(const char* sentence, size_t len, uint64_t now_us);
+
+  /** Return true if NMEA 2000 message should be recorded. */
+  bool KeepPgn(uint32_t pgn, uint8_t source, uint64_t now_us);
+
+  /** Forget when messages were last recorded. */
+  void Clear();
+
+  /** Return number of messages checked when enabled. */
+  [[nodiscard]] uint64_t GetChecked() const { return m_checked; }
+
+  /** Return number of messages not to be recorded. */
+  [[nodiscard]] uint64_t GetDropped() const { return m_dropped; }
+
+  /** Reset the counters. */
+  void ResetCounts() { m_checked = m_dropped = 0; }
+
+private:
+  /** Interval meaning "off". */
+  static constexpr uint64_t kNever = UINT64_MAX;
+
+  /** State of a message kind, free if key is 0. */
+  struct Entry {
+    uint64_t key;
+    uint64_t interval;  //!< Microseconds, 0 if no rule
+    uint64_t last;      //!< When last recorded, microseconds
+    bool recorded;      //!< Whether last recorded is valid
+    bool keep_parts;    //!< Decision for remaining parts of a message
+  };
+
+  /** Return entry for key, resolving its rule if new, nullptr if full. */
+  Entry* Find(uint64_t key, uint64_t rule_key, uint64_t fallback_key);
+
+  /** Return true if a message for entry received at now_us is kept. */
+  bool Keep(Entry& entry, uint64_t now_us);
+
+  /** Interval by rule key, only used when a message kind is first seen. */
+  std::unordered_map<uint64_t, uint64_t> m_rules;
+  std::vector<Entry> m_entries;  //!< Open addressing hash table
+  uint64_t m_checked;
+  uint64_t m_dropped;
+};
+
+#endif  // RECORD_DECIMATOR_H_
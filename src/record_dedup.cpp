@@ -0,0 +1,84 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement record_dedup.h
+ */
+
+#include <cstring>
+
+#include "record_dedup.h"
+
+/** 64 bit FNV-1a hash of data. */
+static uint64_t Hash(const char* data, size_t len) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+void RecordDedup::SetWindow(std::chrono::milliseconds window) {
+  using std::chrono::microseconds;
+  const auto count = std::chrono::duration_cast<microseconds>(window).count();
+  m_window = count > 0 ? static_cast<uint64_t>(count) : 0;
+  if (m_window == 0) {
+    std::vector<Entry>().swap(m_entries);
+  } else if (m_entries.empty()) {
+    m_entries.resize(kCapacity);
+  }
+  Clear();
+}
+
+void RecordDedup::Clear() {
+  for (auto& entry : m_entries) entry.len = 0;
+}
+
+bool RecordDedup::IsDuplicate(const char* data, size_t len, uint64_t now_us) {
+  if (m_entries.empty() || len == 0 || len > kMaxLength) return false;
+  m_checked += 1;
+  const uint64_t hash = Hash(data, len);
+  Entry* free_entry = nullptr;
+  Entry* oldest = nullptr;
+  for (size_t i = 0; i < kProbes; i++) {
+    Entry& entry = m_entries[(hash + i) % kCapacity];
+    // Also expired if the clock went backwards.
+    const bool expired = entry.len == 0 || now_us < entry.time ||
+                         now_us - entry.time > m_window;
+    if (expired) {
+      if (!free_entry) free_entry = &entry;
+      continue;
+    }
+    if (entry.hash == hash && entry.len == len &&
+        std::memcmp(entry.data, data, len) == 0) {
+      // The time is not updated, a steady repetition is let through once
+      // per window.
+      m_dropped += 1;
+      return true;
+    }
+    if (!oldest || entry.time < oldest->time) oldest = &entry;
+  }
+  Entry& entry = free_entry ? *free_entry : *oldest;
+  entry.hash = hash;
+  entry.time = now_us;
+  entry.len = static_cast<uint32_t>(len);
+  std::memcpy(entry.data, data, len);
+  return false;
+}
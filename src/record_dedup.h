@@ -0,0 +1,99 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Removal of duplicate sentences received from redundant inputs, e.g. two
+ * GPS receivers or an AIS transponder plus a network feed.
+ */
+
+#ifndef RECORD_DEDUP_H_
+#define RECORD_DEDUP_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Set of recently seen sentences in a fixed size hash table. A sentence is
+ * a duplicate if an identical one was seen within the time window. Entries
+ * hold the complete sentence, so a hash collision never makes a distinct
+ * sentence a duplicate. When the table is crowded the oldest entry is
+ * replaced, at worst letting a duplicate through.
+ *
+ * The window should be shorter than the period of the sentences, or
+ * identical sentences sent repeatedly by a single source are thinned.
+ */
+class RecordDedup {
+public:
+  /** Longer sentences are never duplicates, NMEA 0183 max is 82. */
+  static constexpr size_t kMaxLength = 96;
+
+  /** Number of table entries. */
+  static constexpr size_t kCapacity = 1024;
+
+  /** Number of entries checked for each sentence. */
+  static constexpr size_t kProbes = 8;
+
+  RecordDedup() : m_window(0), m_checked(0), m_dropped(0) {}
+
+  /**
+   * Set time window, allocating the table. 0 disables deduplication and
+   * releases the memory.
+   */
+  void SetWindow(std::chrono::milliseconds window);
+
+  /** Return true if SetWindow() enabled deduplication. */
+  [[nodiscard]] bool IsEnabled() const { return !m_entries.empty(); }
+
+  /**
+   * Check sentence and remember it if not a duplicate.
+   * @param now_us Receive time in microseconds, from a monotonic clock.
+   * @return true if the sentence should be dropped.
+   */
+  bool IsDuplicate(const char* data, size_t len, uint64_t now_us);
+
+  /** Forget all seen sentences. */
+  void Clear();
+
+  /** Return number of sentences checked by IsDuplicate(). */
+  [[nodiscard]] uint64_t GetChecked() const { return m_checked; }
+
+  /** Return number of duplicates found by IsDuplicate(). */
+  [[nodiscard]] uint64_t GetDropped() const { return m_dropped; }
+
+  /** Reset the counters. */
+  void ResetCounts() { m_checked = m_dropped = 0; }
+
+private:
+  /** A seen sentence, free if len is 0. */
+  struct Entry {
+    uint64_t hash;
+    uint64_t time;  //!< When first seen, microseconds
+    uint32_t len;
+    char data[kMaxLength];
+  };
+
+  uint64_t m_window;  //!< Microseconds
+  std::vector<Entry> m_entries;
+  uint64_t m_checked;
+  uint64_t m_dropped;
+};
+
+#endif  // RECORD_DEDUP_H_
@@ -0,0 +1,177 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement record_formatter.h
+ */
+
+#include "record_formatter.h"
+
+/** Return true if c is whitespace, not using locales. */
+static bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' ||
+         c == '\v';
+}
+
+void RecordFormatter::AppendTime(uint64_t ms, std::string& out) {
+  const auto seconds = static_cast<std::time_t>(ms / 1000);
+  if (seconds != m_seconds) {
+    m_seconds = seconds;
+    std::tm tm{};
+#ifdef _WIN32
+    gmtime_s(&tm, &seconds);
+#else
+    gmtime_r(&seconds, &tm);
+#endif
+    m_prefix_len =
+        std::strftime(m_prefix, sizeof(m_prefix), "%Y-%m-%dT%H:%M:%S.", &tm);
+  }
+  const auto millis = static_cast<unsigned>(ms % 1000);
+  const char digits[] = {static_cast<char>('0' + millis / 100),
+                         static_cast<char>('0' + millis / 10 % 10),
+                         static_cast<char>('0' + millis % 10), 'Z'};
+  out.append(m_prefix, m_prefix_len);
+  out.append(digits, sizeof(digits));
+}
+
+void RecordFormatter::AppendTextCsv(uint64_t ms, const char* type,
+                                    const char* text, size_t len,
+                                    std::string& out) {
+  const char* begin = text;
+  const char* end = text + len;
+  while (begin < end && IsSpace(*begin)) begin++;
+  while (end > begin && IsSpace(end[-1])) end--;
+  AppendTime(ms, out);
+  out += type;
+  AppendCsvField(begin, end, out);
+  out += '\n';
+}
+
+void RecordFormatter::AppendNmea0183Csv(uint64_t ms, const char* text,
+                                        size_t len, std::string& out) {
+  size_t skip = 0;
+  while (skip < len && IsSpace(text[skip])) skip++;
+  const bool is_ais = skip < len && text[skip] == '!';
+  AppendTextCsv(ms, is_ais ? ",AIS,," : ",NMEA0183,,", text, len, out);
+}
+
+void RecordFormatter::AppendSignalKCsv(uint64_t ms, const char* text,
+                                       size_t len, std::string& out) {
+  AppendTextCsv(ms, ",SignalK,,", text, len, out);
+}
+
+void RecordFormatter::AppendN2kCsv(uint64_t ms, uint32_t pgn,
+                                   const uint8_t* payload, size_t len,
+                                   std::string& out) {
+  AppendTime(ms, out);
+  out += ",NMEA2000,";
+  AppendDecimal(pgn, out);
+  out += ',';
+  AppendHex(payload, len, out);
+  out += '\n';
+}
+
+void RecordFormatter::AppendPcdin(uint32_t pgn, const uint8_t* payload,
+                                  size_t len, std::string& out) {
+  out += "$PCDIN,";
+  AppendDecimal(pgn, out);
+  out += ',';
+  AppendHex(payload, len, out);
+  out += "\r\n";
+}
+
+void RecordFormatter::AppendRawLine(const char* text, size_t len,
+                                    std::string& out) {
+  while (len > 0 && IsSpace(text[len - 1])) len--;
+  out.append(text, len);
+  out += "\r\n";
+}
+
+void RecordFormatter::AppendTagBlock(uint64_t ms, std::string& out) {
+  const size_t start = out.size();
+  out += "\\c:";
+  AppendDecimal(ms, out);
+  uint8_t checksum = 0;
+  for (size_t i = start + 1; i < out.size(); i++) checksum ^= out[i];
+  out += '*';
+  AppendHex(&checksum, 1, out);
+  out += '\\';
+}
+
+void RecordFormatter::AppendCsvField(const char* begin, const char* end,
+                                     std::string& out) {
+  bool quote = false;
+  bool escape = false;
+  for (const char* p = begin; p < end; ++p) {
+    switch (*p) {
+      case ',':
+        quote = true;
+        break;
+      case '"':
+        quote = true;
+        escape = true;
+        break;
+      case '\r':
+      case '\n':
+        escape = true;
+        break;
+    }
+  }
+  if (quote) out += '"';
+  if (!escape) {
+    out.append(begin, end);
+  } else {
+    for (const char* p = begin; p < end; ++p) {
+      switch (*p) {
+        case '"':
+          out += "\"\"";
+          break;
+        case '\r':
+        case '\n':
+          out += ' ';
+          break;
+        default:
+          out += *p;
+      }
+    }
+  }
+  if (quote) out += '"';
+}
+
+void RecordFormatter::AppendHex(const uint8_t* data, size_t len,
+                                std::string& out) {
+  static const char* const kDigits = "0123456789ABCDEF";
+  const size_t start = out.size();
+  out.resize(start + 2 * len);
+  char* p = &out[start];
+  for (size_t i = 0; i < len; ++i) {
+    *p++ = kDigits[data[i] >> 4];
+    *p++ = kDigits[data[i] & 0x0f];
+  }
+}
+
+void RecordFormatter::AppendDecimal(uint64_t value, std::string& out) {
+  char buff[20];
+  char* p = buff + sizeof(buff);
+  do {
+    *--p = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+  out.append(p, buff + sizeof(buff) - p);
+}
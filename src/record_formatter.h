@@ -0,0 +1,104 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Formatting of recorded messages as VDR CSV and raw NMEA lines. Lines are
+ * appended to a caller supplied buffer which is meant to be reused, so
+ * that steady state recording does not allocate.
+ */
+
+#ifndef RECORD_FORMATTER_H_
+#define RECORD_FORMATTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+/**
+ * Appends recorded messages to a std::string buffer. The CSV format is
+ * timestamp,type,id,message where the timestamp is formatted like
+ * YYYY-MM-DDTHH:MM:SS.mmmZ in UTC. The date and time part is cached, it
+ * rarely changes between consecutive messages.
+ */
+class RecordFormatter {
+public:
+  RecordFormatter() : m_seconds(-1), m_prefix_len(0) {}
+
+  /** Append timestamp, ms since 1/1 1970, to out. */
+  void AppendTime(uint64_t ms, std::string& out);
+
+  /**
+   * Append a NMEA 0183 sentence as a CSV line, type AIS if it starts
+   * with '!'. Surrounding whitespace is removed.
+   */
+  void AppendNmea0183Csv(uint64_t ms, const char* text, size_t len,
+                         std::string& out);
+
+  /** Append a Signal K delta as a CSV line, see AppendNmea0183Csv(). */
+  void AppendSignalKCsv(uint64_t ms, const char* text, size_t len,
+                        std::string& out);
+
+  /**
+   * Append a NMEA 2000 message as a CSV line with pgn as id and the
+   * GetN2000Payload() bytes hex encoded.
+   */
+  void AppendN2kCsv(uint64_t ms, uint32_t pgn, const uint8_t* payload,
+                    size_t len, std::string& out);
+
+  /** Append $PCDIN,<pgn>,<hex payload> line as written to raw files. */
+  static void AppendPcdin(uint32_t pgn, const uint8_t* payload, size_t len,
+                          std::string& out);
+
+  /** Append text without trailing whitespace plus a CRLF line ending. */
+  static void AppendRawLine(const char* text, size_t len, std::string& out);
+
+  /**
+   * Append NMEA 4.x tag block \\c:<ms>*hh\\ with the receive time, ms since
+   * 1/1 1970 UTC, to be followed by a sentence. The standard unit of c: is
+   * seconds; milliseconds, a common extension, keep the resolution of the
+   * CSV format.
+   */
+  static void AppendTagBlock(uint64_t ms, std::string& out);
+
+  /**
+   * Append [begin, end) as a CSV field. The field is only quoted if it
+   * contains a comma or a quote, line breaks are replaced by space since
+   * playback is line based.
+   */
+  static void AppendCsvField(const char* begin, const char* end,
+                             std::string& out);
+
+  /** Append upper case hex encoded data to out. */
+  static void AppendHex(const uint8_t* data, size_t len, std::string& out);
+
+  /** Append decimal value to out. */
+  static void AppendDecimal(uint64_t value, std::string& out);
+
+private:
+  /** Append CSV line with given type and empty id for a text message. */
+  void AppendTextCsv(uint64_t ms, const char* type, const char* text,
+                     size_t len, std::string& out);
+
+  std::time_t m_seconds;  //!< Time in m_prefix
+  char m_prefix[32];      //!< Date and time up to and including the '.'
+  size_t m_prefix_len;
+};
+
+#endif  // RECORD_FORMATTER_H_
@@ -16,6 +16,7 @@
  **************************************************************************/
 
 #include <algorithm>
+#include <cctype>
 #include <cstring>
 #include <typeinfo>
 
@@ -30,12 +31,17 @@
 #include "wx/filefn.h"
 #include "wx/filename.h"
 #include "wx/image.h"
+#include "wx/jsonval.h"
+#include "wx/jsonwriter.h"
 #include "wx/log.h"
 #include "wx/tokenzr.h"
+#include "wx/wfstream.h"
+#include "wx/zstream.h"
 
 #include "dm_replay_mgr.h"
 
 #include "commons.h"
+#include "file_path.h"
 #include "icons.h"
 #include "ocpn_plugin.h"
 #include "record_play_mgr.h"
@@ -46,20 +52,53 @@
 wxDEFINE_EVENT(EVT_N2K, ObservedEvt);
 wxDEFINE_EVENT(EVT_SIGNALK, ObservedEvt);
 
+/** Write gzip compressed copy of file in to out. @return false on errors. */
+static bool GzipFile(const wxString& in, const wxString& out) {
+  wxFileInputStream input(in);
+  if (!input.IsOk()) return false;
+  bool ok;
+  {
+    wxFileOutputStream output(out);
+    if (!output.IsOk()) return false;
+    wxZlibOutputStream zlib(output, wxZ_DEFAULT_COMPRESSION, wxZLIB_GZIP);
+    zlib.Write(input);
+    ok = input.GetLastError() == wxSTREAM_EOF && zlib.Close() && output.Close();
+  }
+  if (!ok) ::wxRemoveFile(out);
+  return ok;
+}
+
 /**
- * Converts 2 bytes of NMEA 2000 data to an unsigned 16-bit integer
- *
- * @param data Pointer to bytes in the NMEA 2000 message (2 bytes,
- * little-endian)
- * @return Raw unsigned 16-bit integer value
- *
- * Data is stored in little-endian order (LSB first).
- * Example: bytes 0x02 0x02 -> uint16_t 0x0202 = 514
- *
- * Invalid/unavailable values are typically indicated by 0xFFFF.
+ * Write decompressed copy of gzip file in to a new temporary file.
+ * @return Path to the copy, empty on errors.
  */
-static inline uint16_t N2KToInt16(const uint8_t* data) {
-  return data[0] | (data[1] << 8);  // little-endian uint16
+static wxString GunzipFile(const wxString& in) {
+  wxFileInputStream input(in);
+  if (!input.IsOk()) return "";
+  const wxString out = wxFileName::CreateTempFileName("vdr");
+  if (out.IsEmpty()) return "";
+  bool ok;
+  {
+    wxFileOutputStream output(out);
+    wxZlibInputStream zlib(input, wxZLIB_GZIP);
+    ok = output.IsOk() && zlib.IsOk();
+    if (ok) {
+      output.Write(zlib);
+      ok = zlib.GetLastError() == wxSTREAM_EOF && output.Close();
+    }
+  }
+  if (!ok) {
+    ::wxRemoveFile(out);
+    return "";
+  }
+  return out;
+}
+
+/** Convert replay milliseconds since 1/1 1970 to a wxDateTime. */
+static wxDateTime StampToDateTime(uint64_t stamp) {
+  wxDateTime date_time(time_t(stamp / 1000));
+  date_time.SetMillisecond(stamp % 1000);
+  return date_time;
 }
 
 void RecordPlayMgr::Init() {
@@ -71,9 +110,11 @@ void RecordPlayMgr::Init() {
 
   //  Load the configuration items
   LoadConfig();
+  RecoverRecordings();
 
-  //  Set up NMEA 2000 listeners based on preferences
+  //  Set up NMEA 2000 and Signal K listeners based on preferences
   UpdateNMEA2000Listeners();
+  UpdateSignalKListeners();
 
   //  If auto-start is enabled, and we're not playing back and not using speed
   //  threshold, start recording after initialization.
@@ -97,25 +138,24 @@ void RecordPlayMgr::Init() {
 void RecordPlayMgr::DeInit() {
   SaveConfig();
   if (m_timer) {
-    if (m_timer->IsRunning()) {
-      m_timer->Stop();
-      m_istream.Close();
-    }
+    m_timer->Stop();
     delete m_timer;
     m_timer = nullptr;
   }
 
   if (m_recording) {
-    m_ostream.Close();
+    m_writer.Close();
     m_recording = false;
-#ifdef __ANDROID__
-    bool AndroidSecureCopyFile(wxString in, wxString out);
-    AndroidSecureCopyFile(m_temp_outfile, m_final_outfile);
-    ::wxRemoveFile(m_temp_outfile);
-#endif
   }
+  // Finish closing, compressing and recovering files before unloading.
+  m_writer.WaitIdle();
+  m_dm_replay_mgr = std::make_unique<DataMonitorReplayMgr>();
+  CloseReplayEngine();
+  RemoveUnpackedFile();
 
-  // Stop and cleanup all network servers.
+  // Stop and cleanup all sinks and network servers.
+  m_relaying = false;
+  m_fanout.Clear();
   StopNetworkServers();
   m_network_servers.clear();
 
@@ -139,6 +179,23 @@ wxString FormatIsoDateTime(const wxDateTime& ts) {
   return ts.Format("%Y-%m-%dT%H:%M:%S.%lZ");
 }
 
+/**
+ * Set out to s encoded as UTF-8. Plain ASCII, the normal case for NMEA
+ * data, is copied without allocating as long as out has the capacity.
+ */
+static void ToUtf8(const wxString& s, std::string& out) {
+  out.clear();
+  for (auto it = s.begin(); it != s.end(); ++it) {
+    const wxUniChar ch = *it;
+    if (!ch.IsAscii()) {
+      const wxScopedCharBuffer utf8 = s.utf8_str();
+      out.assign(utf8.data(), utf8.length());
+      return;
+    }
+    out += static_cast<char>(ch.GetValue());
+  }
+}
+
 RecordPlayMgr::RecordPlayMgr(opencpn_plugin* parent, VdrControlGui* control_gui)
     : m_dm_replay_mgr(std::make_unique<DataMonitorReplayMgr>()),
       m_parent(parent),
@@ -172,10 +229,24 @@ RecordPlayMgr::RecordPlayMgr(opencpn_plugin* parent, VdrControlGui* control_gui)
   m_recording = false;
   m_recording_paused = false;
   m_playing = false;
-  m_is_csv_file = false;
-  m_last_speed = 0.0;
-  m_sentence_buffer.clear();
-  m_messages_dropped = false;
+  m_raw_decoder = nullptr;
+  m_csv_decoder = nullptr;
+  m_relaying = false;
+  m_dropped_base = 0;
+  m_loopback_batch_rows = ReplayEngine::kDefaultBatchRows;
+  m_loopback_batch_ms =
+      static_cast<int>(ReplayEngine::kDefaultBatchTime.count());
+  m_pre_record_seconds = 0;
+  m_pre_record_megabytes = 0;
+  m_log_rotate = false;
+  m_log_rotate_interval = 24;
+  m_log_rotate_megabytes = 0;
+  m_log_rotate_aligned = false;
+  m_compress_recordings = false;
+  m_sync_seconds = 0;
+  m_raw_tag_blocks = false;
+  m_dedup_ms = 0;
+  m_n2k_repeat_seconds = 0;
 }
 
 void RecordPlayMgr::UpdateSignalKListeners() {
@@ -184,7 +255,11 @@ void RecordPlayMgr::UpdateSignalKListeners() {
   wxLogMessage("Configuring SignalK listeners. SignalK enabled: %d",
                m_protocols.signalK);
   if (m_protocols.signalK) {
-    // TODO: Implement SignalK configuration.
+    // Deltas for our own vessel, updates for other contexts such as AIS
+    // targets are already covered by the NMEA recording.
+    m_signalk_listeners.push_back(
+        GetListener(SignalkId("self"), EVT_SIGNALK, m_event_handler));
+    m_event_handler->Bind(EVT_SIGNALK, &RecordPlayMgr::OnSignalKEvent, this);
   }
 }
 
@@ -193,78 +268,108 @@ void RecordPlayMgr::OnSignalKEvent(wxCommandEvent& event) {
     // SignalK recording is disabled.
     return;
   }
-  // TODO: Implement SignalK recording.
+  if (!IsWritingRecords() && !IsPreRecording()) return;
+
+  auto& ev = dynamic_cast<ObservedEvt&>(event);
+  auto payload = std::static_pointer_cast<const wxJSONValue>(
+      GetSignalkPayload(ev));
+  if (!payload || !payload->HasMember("Data")) return;
+
+  // Serialize once, as compact single line JSON. Playback sends the recorded
+  // text as is.
+  wxString delta;
+  wxJSONWriter writer(wxJSONWRITER_NONE);
+  writer.Write(payload->ItemAt("Data"), delta);
+  delta.Trim(true).Trim(false);
+  if (delta.IsEmpty()) return;
+
+  RecordSignalKDelta(delta);
 }
 
-void RecordPlayMgr::OnN2KEvent(wxCommandEvent& event) {
-  if (!m_protocols.nmea2000) {
-    // NMEA 2000 recording is disabled.
-    return;
+void RecordPlayMgr::RecordSignalKDelta(const wxString& delta) {
+  if (!IsWritingRecords() && !IsPreRecording()) return;
+  const uint64_t received = m_record_clock.Now();
+
+  ToUtf8(delta, m_record_text);
+  if (m_relaying && IsWritingRecords()) {
+    m_relay_msg.type = ReplayMsgType::kSignalK;
+    m_relay_msg.text = m_record_text;
+    m_relay_msg.has_n2k = false;
+    RelayMessage(m_relay_msg);
+  }
+
+  m_record_buffer.clear();
+  switch (m_data_format) {
+    case VdrDataFormat::kCsv:
+      // CSV format: timestamp,type,id,message
+      m_record_formatter.AppendSignalKCsv(received / 1000, m_record_text.data(),
+                                          m_record_text.size(),
+                                          m_record_buffer);
+      break;
+    case VdrDataFormat::kRawNmea:
+      // One JSON delta per line, no tag block since it is not NMEA.
+      RecordFormatter::AppendRawLine(m_record_text.data(),
+                                     m_record_text.size(), m_record_buffer);
+      break;
   }
+  WriteRecord();
+}
 
+void RecordPlayMgr::OnN2KEvent(wxCommandEvent& event) {
   auto& ev = dynamic_cast<ObservedEvt&>(event);
-  // Get payload and source
-  std::vector<uint8_t> payload = GetN2000Payload(0, ev);  // ID does not matter.
-  // Extract PGN from payload (bytes 3-5, little endian)
-  if (payload.size() < 6) {
+  // The plugin API returns a copy of the payload, which is decoded once
+  // into fixed size storage.
+  const std::vector<uint8_t> payload = GetN2000Payload(0, ev);  // Any ID.
+  if (!ParseOcpnN2kPayload(payload.data(), payload.size(), m_n2k_msg)) {
     return;  // Not enough bytes for valid message
   }
-  uint32_t pgn = payload[3] | (payload[4] << 8) | (payload[5] << 16);
-
-  // Check for COG & SOG, Rapid Update PGN (129026)
-  if (pgn == 129026) {
-    // COG & SOG message format:
-    // Byte 0: SID
-    // Byte 1: COG Reference (0=True, 1=Magnetic)
-    // Byte 2-5: COG (float, radians)
-    // Byte 6-9: SOG (float, meters per second)
-    if (payload.size() >= 19) {  // 11 header bytes + 8 data bytes
-      // Extract SOG value (uint16, 2 bytes, little-endian)
-      uint16_t raw_sog = N2KToInt16(&payload[17]);
+  const uint32_t pgn = m_n2k_msg.pgn;
 
-      // Convert to m/s using NMEA 2000 resolution, then to knots.
-      float speed_knots = (raw_sog * 0.01f) * 1.94384f;
-
-      // Update last known speed.
-      m_last_speed = speed_knots;
-
-      // Check if we should start/stop recording based on speed.
-      CheckAutoRecording(speed_knots);
-    }
+  // Speed is tracked from COG & SOG, Rapid Update, whether it is recorded
+  // or not. The protocol setting and allow list only apply to recording.
+  double knots;
+  if (pgn == kN2kSogPgn && IsTrackingSpeed() &&
+      ParseN2kSog(payload.data(), payload.size(), knots)) {
+    UpdateSpeed(SpeedSource::kN2kCogSog, knots);
   }
 
-  if (!m_recording) {
+  if (!m_protocols.nmea2000 || (!IsWritingRecords() && !IsPreRecording()) ||
+      !m_n2k_ingest.IsAllowed(pgn)) {
     return;
   }
+  const uint64_t received = m_record_clock.Now();
 
-  // Convert payload for logging
-  wxString log_payload;
-  for (size_t i = 0; i < payload.size(); i++) {
-    log_payload += wxString::Format("%02X", payload[i]);
+  if (m_relaying && IsWritingRecords()) {
+    m_relay_msg.type = ReplayMsgType::kN2k;
+    m_relay_msg.text.clear();
+    m_relay_msg.n2k = m_n2k_msg;
+    m_relay_msg.has_n2k = true;
+    RelayMessage(m_relay_msg);
+  }
+  if (!m_decimator.KeepPgn(pgn, m_n2k_msg.source, received) ||
+      !m_n2k_ingest.Accept(m_n2k_msg, received)) {
+    return;
   }
 
-  // Format N2K message for recording.
-  wxString formatted_message;
+  // Format N2K message for recording, payload hex encoded.
+  m_record_buffer.clear();
   switch (m_data_format) {
-    case VdrDataFormat::kCsv: {
+    case VdrDataFormat::kCsv:
       // CSV format: timestamp,type,id,payload
       // where "id" is the PGN number.
-      wxString timestamp = FormatIsoDateTime(wxDateTime::UNow());
-      formatted_message =
-          wxString::Format("%s,NMEA2000,%d,%s\n", timestamp, pgn, log_payload);
+      m_record_formatter.AppendN2kCsv(received / 1000, pgn, payload.data(),
+                                      payload.size(), m_record_buffer);
       break;
-    }
     case VdrDataFormat::kRawNmea:
       // PCDIN format: $PCDIN,<pgn>,<payload>
-      formatted_message =
-          wxString::Format("$PCDIN,%d,%s\r\n", pgn, log_payload);
+      if (m_raw_tag_blocks) {
+        RecordFormatter::AppendTagBlock(received / 1000, m_record_buffer);
+      }
+      RecordFormatter::AppendPcdin(pgn, payload.data(), payload.size(),
+                                   m_record_buffer);
       break;
   }
-
-  // Check if we need to rotate the VDR file.
-  CheckLogRotation();
-
-  m_ostream.Write(formatted_message.ToStdString());
+  WriteRecord();
 }
 
 void RecordPlayMgr::UpdateNMEA2000Listeners() {
@@ -272,170 +377,103 @@ void RecordPlayMgr::UpdateNMEA2000Listeners() {
   m_n2k_listeners.clear();
   wxLogMessage("Configuring NMEA 2000 listeners. NMEA 2000 enabled: %d",
                m_protocols.nmea2000);
-  if (m_protocols.nmea2000) {
-    std::map<unsigned int, wxString> parameterGroupNumbers = {
-        // System & ISO messages
-        {59392, "ISO Acknowledgement"},
-        {59904, "ISO Request"},
-        {60160, "ISO Transport Protocol, Data Transfer"},
-        {60416, "ISO Transport Protocol, Connection Management"},
-        {60928, "ISO Address Claim"},
-        {61184, "Manufacturer Proprietary Single Frame"},
-        {65280, "Manufacturer Proprietary Single Frame"},
-
-        // B&G Proprietary
-        {65305, "B&G AC12 Autopilot Status"},
-        {65309, "B&G WS320 Wind Sensor Battery Status"},
-        {65312, "B&G WS320 Wind Sensor Wireless Status"},
-        {65340, "B&G AC12 Autopilot Mode"},
-        {65341, "B&G AC12 Wind Angle"},
-
-        // Time & Navigation
-        {126992, "System Time"},
-        {127233, "MOB (Man Overboard) Data"},
-        {127237, "Heading/Track Control"},
-        {127245, "Rudder Angle"},
-        {127250, "Vessel Heading"},
-        {127251, "Rate of Turn"},
-        {127252, "Heave"},
-        {127257, "Vessel Attitude (Roll/Pitch)"},
-        {127258, "Magnetic Variation"},
-        {128259, "Speed Through Water"},
-        {128267, "Water Depth Below Transducer"},
-        {128275, "Distance Log (Total/Trip)"},
-        {128777, "Anchor Windlass Status"},
-        {129025, "Position Rapid Update (Lat/Lon)"},
-        {129026, "Course/Speed Over Ground (COG/SOG)"},
-        {129029, "GNSS Position Data"},
-        {129283, "Cross Track Error"},
-        {129284, "Navigation Data (WP Info)"},
-        {129285, "Navigation Route/WP Info"},
-        {129540, "GNSS Satellites in View"},
-        {130577, "Direction Data (Set/Drift)"},
-
-        // AIS
-        {129038, "AIS Class A Position Report"},
-        {129039, "AIS Class B Position Report"},
-        {129793, "AIS UTC and Date Report"},
-        {129794, "AIS Class A Static Data"},
-        {129798, "AIS SAR Aircraft Position"},
-        {129802, "AIS Safety Broadcast"},
-
-        // Environmental & Systems
-        {127488, "Engine Parameters, Rapid"},
-        {127489, "Engine Parameters, Dynamic"},
-        {127505, "Fluid Level"},
-        {127508, "Battery Status"},
-        {130306, "Wind Speed/Angle"},
-        {130310, "Environmental Parameters (Air/Water)"},
-        {130311, "Environmental Parameters (Alt Format)"},
-        {130313, "Humidity"},
-        {130314, "Actual Pressure"},
-        {130316, "Temperature Extended Range"}};
-
-    for (const auto& it : parameterGroupNumbers) {
-      m_n2k_listeners.push_back(
-          GetListener(NMEA2000Id(it.first), EVT_N2K, m_event_handler));
-    }
-
+  std::vector<uint32_t> pgns;
+  if (m_protocols.nmea2000) pgns = m_n2k_ingest.GetAllowedPgns();
+  // Speed for auto recording is needed even if the PGN is not recorded.
+  if (IsTrackingSpeed() &&
+      std::find(pgns.begin(), pgns.end(), kN2kSogPgn) == pgns.end()) {
+    pgns.push_back(kN2kSogPgn);
+  }
+  for (uint32_t pgn : pgns) {
+    m_n2k_listeners.push_back(
+        GetListener(NMEA2000Id(pgn), EVT_N2K, m_event_handler));
+  }
+  if (!pgns.empty()) {
     m_event_handler->Bind(EVT_N2K, &RecordPlayMgr::OnN2KEvent, this);
   }
 }
 
-/**
- * Converts 4 bytes of NMEA 2000 data to a 32-bit IEEE 754 floating point number
- *
- * @param data Pointer to bytes in the NMEA 2000 message (4 bytes,
- * little-endian)
- * @return The float value represented by the bytes
- *
- * Data is stored in little-endian IEEE 754 single-precision format.
- * Bytes are combined into a uint32_t and then reinterpreted as a float using
- * memcpy to avoid strict aliasing violations.
- *
- * Example: bytes 0x00 0x00 0x80 0x3F -> float 1.0
- *
- * Note: Some NMEA 2000 fields use scaled integers instead of floats.
- * Verify the PGN specification before using this function.
- */
-inline float N2KToFloat(const uint8_t* data) {
-  float result;
-  uint32_t temp = (static_cast<uint32_t>(data[0])) |
-                  (static_cast<uint32_t>(data[1]) << 8) |
-                  (static_cast<uint32_t>(data[2]) << 16) |
-                  (static_cast<uint32_t>(data[3]) << 24);
-  std::memcpy(&result, &temp, sizeof(float));
-  return result;
-}
-
-wxString RecordPlayMgr::FormatNmea0183AsCsv(const wxString& nmea) {
-  // Get current time with millisecond precision
-  wxString timestamp = FormatIsoDateTime(wxDateTime::UNow());
-
-  wxString type = "NMEA0183";
-  if (nmea.StartsWith("!")) {
-    type = "AIS";
-  }
-
-  // Escape any commas in the NMEA message
-  wxString escaped = nmea.Strip(wxString::both);
-  escaped.Replace("\"", "\"\"");
-  escaped = wxString::Format("\"%s\"", escaped);
-
-  // Format CSV line: timestamp,type,id,message
-  return wxString::Format("%s,%s,,%s\n", timestamp, type, escaped);
-}
-
 void RecordPlayMgr::SetNMEASentence(wxString& sentence) {
   if (!m_protocols.nmea0183) {
     // Recording of NMEA 0183 is disabled.
     return;
   }
-  // Check for RMC sentence to get speed and check for auto-recording.
-  // There can be different talkers on the stream so look at the message type
-  // irrespective of the talker.
-  if (sentence.size() >= 6 && sentence.substr(3, 3) == "RMC") {
-    wxStringTokenizer tkz(sentence, ",");
-    wxString token;
-
-    // Skip to speed field (field 7), which is the speed over ground in knots.
-    for (int i = 0; i < 7 && tkz.HasMoreTokens(); i++) {
-      token = tkz.GetNextToken();
-    }
-
-    if (tkz.HasMoreTokens()) {
-      token = tkz.GetNextToken();
-      if (!token.IsEmpty()) {
-        double speed;
-        if (token.ToDouble(&speed)) {
-          m_last_speed = speed;
-          CheckAutoRecording(speed);
-        }
-      }
+  // Check for RMC and VTG sentences from any talker to get speed for
+  // auto-recording. The type is checked on the wxString, only matching
+  // sentences are converted and parsed.
+  bool converted = false;
+  if (IsTrackingSpeed() && IsNmeaSogSentence(sentence, sentence.length())) {
+    ToUtf8(sentence, m_record_text);
+    converted = true;
+    SpeedSource source;
+    double knots;
+    if (ParseNmeaSog(m_record_text.data(), m_record_text.size(), source,
+                     knots)) {
+      UpdateSpeed(source, knots);
     }
   }
 
-  // Only record if recording is active (whether manual or automatic)
-  if (!m_recording || m_recording_paused) return;
+  // Only record if recording is active (whether manual or automatic), or
+  // buffer while waiting for auto recording.
+  if (!IsWritingRecords() && !IsPreRecording()) return;
+  const uint64_t received = m_record_clock.Now();
 
-  // Check if we need to rotate the VDR file.
-  CheckLogRotation();
+  if (!converted) ToUtf8(sentence, m_record_text);
+  size_t len = m_record_text.size();
+  while (len > 0 && std::isspace(static_cast<unsigned char>(
+                        m_record_text[len - 1]))) {
+    len--;
+  }
+  // Copies from redundant inputs are neither relayed nor written.
+  if (m_dedup.IsDuplicate(m_record_text.data(), len, received)) return;
 
-  wxString normalized_sentence = sentence;
-  normalized_sentence.Trim(true);
+  if (m_relaying && IsWritingRecords()) {
+    ParseReplayLine(m_record_text.data(), len, m_relay_msg);
+    RelayMessage(m_relay_msg);
+  }
+  // Thinned data is still relayed, just not stored.
+  if (!m_decimator.KeepSentence(m_record_text.data(), len, received)) return;
 
+  m_record_buffer.clear();
   switch (m_data_format) {
     case VdrDataFormat::kCsv:
-      m_ostream.Write(FormatNmea0183AsCsv(normalized_sentence));
+      m_record_formatter.AppendNmea0183Csv(received / 1000,
+                                           m_record_text.data(), len,
+                                           m_record_buffer);
       break;
     case VdrDataFormat::kRawNmea:
     default:
-      if (!normalized_sentence.EndsWith("\r\n")) {
-        normalized_sentence += "\r\n";
+      // Sentences already having a tag block are kept as is.
+      if (m_raw_tag_blocks && len > 0 &&
+          (m_record_text[0] == '$' || m_record_text[0] == '!')) {
+        RecordFormatter::AppendTagBlock(received / 1000, m_record_buffer);
       }
-      m_ostream.Write(normalized_sentence);
+      RecordFormatter::AppendRawLine(m_record_text.data(), len,
+                                     m_record_buffer);
       break;
   }
+  WriteRecord();
+}
+
+void RecordPlayMgr::WriteRecord() {
+  if (!IsWritingRecords()) {
+    m_pre_record.Push(m_record_buffer.data(), m_record_buffer.size());
+    return;
+  }
+  const uint64_t rotations = m_writer.GetRotations();
+  m_writer.Write(m_record_buffer.data(), m_record_buffer.size());
+  if (m_writer.GetRotations() != rotations) {
+    wxLogMessage("Rotated VDR file, now recording to: %s",
+                 FromFilePath(m_writer.GetPath()));
+  }
+}
+
+void RecordPlayMgr::FlushPreRecord() {
+  if (m_pre_record.GetCount() == 0) return;
+  wxLogMessage("Writing %zu pre-recorded messages", m_pre_record.GetCount());
+  m_pre_record.Flush([this](const char* data, size_t len) {
+    m_writer.Write(data, len);
+  });
 }
 
 void RecordPlayMgr::SetAISSentence(wxString& sentence) {
@@ -455,6 +493,11 @@ const ConnectionSettings& RecordPlayMgr::GetNetworkSettings(
   return m_protocols.nmea0183Net;
 }
 
+void RecordPlayMgr::UpdateSpeed(SpeedSource source, double knots) {
+  // Check if we should start/stop recording based on speed.
+  if (m_speed_tracker.Update(source, knots)) CheckAutoRecording(knots);
+}
+
 void RecordPlayMgr::CheckAutoRecording(double speed) {
   if (!m_auto_start_recording) {
     // If auto-recording is disabled in settings, do nothing.
@@ -522,55 +565,38 @@ void RecordPlayMgr::CheckAutoRecording(double speed) {
   SetToolbarToolStatus();
 }
 
-bool RecordPlayMgr::IsNmea0183OrAis(const wxString& line) {
-  // NMEA sentences start with $ or !
-  return line.StartsWith("$") || line.StartsWith("!");
+void RecordPlayMgr::OnReplayTimer() {
+  using namespace std::chrono;
+  m_replay_stats.RecordTimerJitter(
+      duration_cast<microseconds>(steady_clock::now() - m_timer_due).count());
+  Notify();
 }
 
-bool RecordPlayMgr::ParseCSVHeader(const wxString& header) {
-  // Reset indices
-  constexpr unsigned kInvalidIndex = std::numeric_limits<unsigned int>::max();
-  m_timestamp_idx = kInvalidIndex;
-  m_message_idx = kInvalidIndex;
-  m_header_fields.Clear();
-
-  // If it looks like NMEA/AIS, it's not a header
-  if (IsNmea0183OrAis(header)) {
-    return false;
-  }
-
-  // Split the header line
-  wxStringTokenizer tokens(header, ",");
-  unsigned int idx = 0;
+void RecordPlayMgr::StartReplayTimer(int delay_ms) {
+  using namespace std::chrono;
+  m_timer_due = steady_clock::now() + milliseconds(delay_ms);
+  m_timer->Start(delay_ms, wxTIMER_ONE_SHOT);
+}
 
-  while (tokens.HasMoreTokens()) {
-    wxString field = tokens.GetNextToken().Trim(true).Trim(false).Lower();
-    m_header_fields.Add(field);
+void RecordPlayMgr::UpdateReplayStats() {
+  m_replay_stats.SetDropped(m_fanout.GetDropped() - m_dropped_base);
+}
 
-    // Look for key fields
-    if (field.Contains("timestamp")) {
-      m_timestamp_idx = idx;
-    } else if (field.Contains("message")) {
-      m_message_idx = idx;
-    }
-    idx++;
-  }
-  return (m_timestamp_idx != kInvalidIndex && m_message_idx != kInvalidIndex);
+wxString RecordPlayMgr::GetReplayStatsSummary() {
+  UpdateReplayStats();
+  return wxString::FromUTF8(m_replay_stats.FormatSummary().c_str());
 }
 
-bool RecordPlayMgr::ParseCSVLineTimestamp(const wxString& line,
-                                          wxString* message,
-                                          wxDateTime* timestamp) {
-  assert(m_is_csv_file);
-  return m_timestamp_parser.ParseCsvLineTimestamp(
-      line, m_timestamp_idx, m_message_idx, message, timestamp);
+std::string RecordPlayMgr::GetReplayStatsJson() {
+  UpdateReplayStats();
+  return m_replay_stats.ToJson(static_cast<int>(GetSpeedMultiplier()));
 }
 
-void RecordPlayMgr::FlushSentenceBuffer() {
-  for (const auto& sentence : m_sentence_buffer) {
-    PushNMEABuffer(sentence + "\r\n");
-  }
-  m_sentence_buffer.clear();
+bool RecordPlayMgr::ExportReplayStats(const wxString& path) {
+  wxFile file;
+  if (!file.Open(path, wxFile::write)) return false;
+  const std::string json = GetReplayStatsJson() + "\n";
+  return file.Write(json.data(), json.size()) == json.size();
 }
 
 double RecordPlayMgr::GetSpeedMultiplier() const {
@@ -581,118 +607,18 @@ void RecordPlayMgr::Notify() {
   if (m_protocols.replay_mode == ReplayMode::kLoopback) {
     if (m_control_gui) m_control_gui->SetProgress(GetProgressFraction());
     int delay = m_dm_replay_mgr->Notify();
-    if (delay >= 0) m_timer->Start(delay, wxTIMER_ONE_SHOT);
+    if (delay >= 0) StartReplayTimer(delay);
     return;
   }
-  if (!m_istream.IsOpened()) return;
-
-  wxDateTime now = wxDateTime::UNow();
-  wxDateTime target_time;
-  bool behind_schedule = true;
-  int precision;
-
-  // For non-timestamped files, base rate of 10 messages/second
-  constexpr int kBaseMessagesPerBatch = 10;
-  constexpr int kBaseIntervalMs = 1000;  // 1 second
-
-  // Keep processing messages until we catch up with scheduled time.
-  while (behind_schedule && !m_istream.Eof()) {
-    wxString line;
-    int pos = static_cast<int>(m_istream.GetCurrentLine());
-
-    if (pos == -1) {
-      // First line - check if it's CSV.
-      line = GetNextNonEmptyLine(true);
-      m_is_csv_file = ParseCSVHeader(line);
-      if (m_is_csv_file) {
-        // Get first data line.
-        line = GetNextNonEmptyLine();
-      } else {
-        // For non-CSV, process the first line as NMEA.
-        // Reset to start of file.
-        line = GetNextNonEmptyLine(true /* fromStart */);
-      }
-    } else {
-      line = GetNextNonEmptyLine();
-    }
-
-    if (m_istream.Eof() && line.IsEmpty()) {
-      m_at_file_end = true;
-      PausePlayback();
-      if (m_control_gui) {
-        m_control_gui->UpdateControls();
-      }
-      return;
-    }
-
-    // Parse the line according to detected format (CSV or raw NMEA/AIS).
-    wxDateTime timestamp;
-    wxString nmea;
-    bool msg_has_timestamp = false;
-
-    if (m_is_csv_file) {
-      bool success = ParseCSVLineTimestamp(line, &nmea, &timestamp);
-      if (success) {
-        nmea += "\r\n";
-        msg_has_timestamp = true;
-      }
-    } else {
-      nmea = line + "\r\n";
-      msg_has_timestamp =
-          m_timestamp_parser.ParseTimestamp(line, timestamp, precision);
-    }
+  if (!m_engine) return;
 
-    if (!nmea.IsEmpty()) {
-      if (m_protocols.replay_mode == ReplayMode::kInternalApi) {
-        // Add sentence to buffer, maintaining max size.
-        m_sentence_buffer.push_back(nmea);
-      }
-
-      // Send through network if enabled.
-      HandleNetworkPlayback(nmea);
-
-      if (msg_has_timestamp) {
-        // The current sentence has a timestamp from the primary time source.
-        m_current_timestamp = timestamp;
-        target_time = GetNextPlaybackTime();
-        // Check if we've caught up to schedule.
-        if (target_time.IsValid() && target_time > now) {
-          behind_schedule = false;  // This will break the loop.
-          // Before scheduling next update, flush our sentence buffer.
-          FlushSentenceBuffer();
-          // Schedule next notification.
-          wxTimeSpan wait_time = target_time - now;
-          m_timer->Start(
-              static_cast<int>(wait_time.GetMilliseconds().ToDouble()),
-              wxTIMER_ONE_SHOT);
-        }
-      } else if (!HasValidTimestamps() &&
-                 m_sentence_buffer.size() >= kBaseMessagesPerBatch) {
-        // For files that do not have timestamped records (or timestamps are not
-        // in chronological order), use batch processing.
-        behind_schedule = false;  // This will break the loop.
-        FlushSentenceBuffer();
-
-        // Calculate interval based on speed multiplier
-        int interval = static_cast<int>(kBaseIntervalMs / GetSpeedMultiplier());
-
-        // Schedule next batch.
-        m_timer->Start(interval, wxTIMER_ONE_SHOT);
-      }
-
-      if (m_sentence_buffer.size() > kMaxBufferSize) {
-        if (!m_messages_dropped) {
-          wxLogMessage(
-              "Playback dropping messages to maintain timing at %.0fx speed",
-              GetSpeedMultiplier());
-          m_messages_dropped = true;
-        }
-        m_sentence_buffer.pop_front();
-      }
-    }
+  const int delay = m_engine->Notify();
+  if (delay >= 0) {
+    StartReplayTimer(delay);
+  } else if (m_engine->IsAtEnd()) {
+    m_at_file_end = true;
+    PausePlayback();
   }
-
-  // Update progress regardless of file type.
   if (m_control_gui) {
     m_control_gui->SetProgress(GetProgressFraction());
   }
@@ -712,20 +638,6 @@ void RecordPlayMgr::OnVdrMsg(VdrMsgType type, const std::string msg) {
   }
 }
 
-wxDateTime RecordPlayMgr::GetNextPlaybackTime() const {
-  if (!m_current_timestamp.IsValid() || !m_first_timestamp.IsValid() ||
-      !m_playback_base_time.IsValid()) {
-    return {};  // Return invalid time if we don't have valid timestamps
-  }
-  // Calculate when this message should be played relative to playback start.
-  wxTimeSpan elapsed_time = m_current_timestamp - m_first_timestamp;
-  wxLongLong ms = elapsed_time.GetMilliseconds();
-  double scaled_ms = ms.ToDouble() / GetSpeedMultiplier();
-  wxTimeSpan scaled_elapsed =
-      wxTimeSpan::Milliseconds(static_cast<long>(scaled_ms));
-  return m_playback_base_time + scaled_elapsed;
-}
-
 void RecordPlayMgr::OnToolbarToolCallback(int id) {
   auto& control_pane = GetFrameAuiManager()->GetPane(kControlWinName);
 
@@ -740,10 +652,10 @@ void RecordPlayMgr::OnToolbarToolCallback(int id) {
     // Check if the toolbar button is being toggled off
     // if (m_callbacks.get_control()) {
     if (control_pane.IsShown()) {
-      // Stop any active playback
+      // Stop any active playback, restarting from the beginning.
       if (m_timer->IsRunning()) {
         m_timer->Stop();
-        m_istream.Close();
+        if (m_engine) m_engine->Open();
       }
 
       // Hide control window
@@ -809,13 +721,12 @@ bool RecordPlayMgr::IsAtFileEnd() const {
 }
 
 wxDateTime RecordPlayMgr::GetCurrentTimestamp() const {
-  if (m_protocols.replay_mode != ReplayMode::kLoopback)
-    return m_current_timestamp;
+  if (m_protocols.replay_mode == ReplayMode::kLoopback)
+    return StampToDateTime(m_dm_replay_mgr->GetCurrentTimestamp());
 
-  uint64_t stamp = m_dm_replay_mgr->GetCurrentTimestamp();
-  wxDateTime date_time(time_t(stamp / 1000));
-  date_time.SetMillisecond(stamp % 1000);
-  return date_time;
+  if (m_engine && m_engine->GetCurrentTimestamp() != 0)
+    return StampToDateTime(m_engine->GetCurrentTimestamp());
+  return m_current_timestamp;
 }
 
 void RecordPlayMgr::SetColorScheme(PI_ColorScheme cs) {
@@ -824,9 +735,8 @@ void RecordPlayMgr::SetColorScheme(PI_ColorScheme cs) {
   }
 }
 
-wxString RecordPlayMgr::GenerateFilename() const {
-  wxDateTime now = wxDateTime::Now().ToUTC();
-  wxString timestamp = now.Format("%Y%m%dT%H%M%SZ");
+wxString RecordPlayMgr::GenerateFilename(const wxDateTime& start) const {
+  wxString timestamp = start.ToUTC().Format("%Y%m%dT%H%M%SZ");
   wxString extension = (m_data_format == VdrDataFormat::kCsv) ? ".csv" : ".txt";
   return "vdr_" + timestamp + extension;
 }
@@ -853,6 +763,33 @@ bool RecordPlayMgr::LoadConfig() {
   config->Read("Interval", &m_interval, 1000);
   config->Read("LogRotate", &m_log_rotate, false);
   config->Read("LogRotateInterval", &m_log_rotate_interval, 24);
+  // Size limit and rotation on the hour etc., no UI.
+  config->Read("LogRotateMegabytes", &m_log_rotate_megabytes, 0);
+  config->Read("LogRotateAligned", &m_log_rotate_aligned, false);
+  config->Read("CompressRecordings", &m_compress_recordings, false);
+  // Max seconds of data lost on power failure, no UI.
+  config->Read("RecordingSyncSeconds", &m_sync_seconds, 10);
+  // Prefix raw NMEA sentences with receive time tag blocks, no UI.
+  config->Read("RawTagBlocks", &m_raw_tag_blocks, false);
+  // Drop sentences identical to one received this recently, no UI.
+  config->Read("DedupMilliseconds", &m_dedup_ms, 0);
+  m_dedup.SetWindow(std::chrono::milliseconds(std::max(0, m_dedup_ms)));
+  // Min seconds between recorded messages per sentence type or PGN, like
+  // "GSV=60,GPGSA=10,127257=1", no UI.
+  config->Read("RecordingPolicy", &m_recording_policy, "");
+  std::string config_error;
+  if (!m_decimator.SetPolicy(m_recording_policy.ToStdString(), config_error)) {
+    wxLogWarning("%s", config_error);
+  }
+  // Recorded PGNs like "default,130312,!127257" and how long unchanged
+  // NMEA 2000 data is not recorded again, no UI.
+  config->Read("RecordPgns", &m_record_pgns, N2kIngest::kDefaultList);
+  if (!m_n2k_ingest.SetAllowList(m_record_pgns.ToStdString(), config_error)) {
+    wxLogWarning("%s", config_error);
+  }
+  config->Read("N2kRepeatSeconds", &m_n2k_repeat_seconds, 0);
+  m_n2k_ingest.SetRepeatInterval(
+      std::chrono::seconds(std::max(0, m_n2k_repeat_seconds)));
   config->Read("AutoStartRecording", &m_auto_start_recording, false);
   config->Read("UseSpeedThreshold", &m_use_speed_threshold, false);
   config->Read("SpeedThreshold", &m_speed_threshold, 0.5);
@@ -882,13 +819,39 @@ bool RecordPlayMgr::LoadConfig() {
   config->Read("NMEA2000_UseTCP", &m_protocols.n2kNet.use_tcp, false);
   config->Read("NMEA2000_Port", &m_protocols.n2kNet.port, 10112);
   config->Read("NMEA2000_Enabled", &m_protocols.n2kNet.enabled, false);
+  int n2k_format;
+  config->Read("NMEA2000_Format", &n2k_format,
+               static_cast<int>(N2kNetFormat::kText));
+  // Values from a newer or edited config fall back to the default.
+  if (n2k_format < static_cast<int>(N2kNetFormat::kText) ||
+      n2k_format > static_cast<int>(N2kNetFormat::kSocketCan)) {
+    n2k_format = static_cast<int>(N2kNetFormat::kText);
+  }
+  m_protocols.n2k_format = static_cast<N2kNetFormat>(n2k_format);
+
+  config->Read("RelayWhileRecording", &m_protocols.relay_while_recording,
+               false);
+
+  // Optional copy of everything replayed, no UI.
+  config->Read("ReplayExportFile", &m_replay_export_file, "");
+
+  // Loopback replay work per timer tick, no UI.
+  config->Read("LoopbackBatchRows", &m_loopback_batch_rows,
+               static_cast<int>(ReplayEngine::kDefaultBatchRows));
+  config->Read("LoopbackBatchMs", &m_loopback_batch_ms,
+               static_cast<int>(ReplayEngine::kDefaultBatchTime.count()));
+
+  // Messages kept while waiting for auto recording to start, no UI.
+  config->Read("PreRecordSeconds", &m_pre_record_seconds, 30);
+  config->Read("PreRecordMegabytes", &m_pre_record_megabytes, 2);
+  m_pre_record_megabytes = std::max(0, m_pre_record_megabytes);
+  m_pre_record.SetLimits(std::chrono::seconds(m_pre_record_seconds),
+                         static_cast<size_t>(m_pre_record_megabytes) << 20);
 
-#if 0
   // Signal K network settings
   config->Read("SignalK_UseTCP", &m_protocols.signalkNet.use_tcp, true);
   config->Read("SignalK_Port", &m_protocols.signalkNet.port, 8375);
   config->Read("SignalK_Enabled", &m_protocols.signalkNet.enabled, false);
-#endif
 
   return true;
 }
@@ -907,6 +870,15 @@ bool RecordPlayMgr::SaveConfig() {
   config->Write("Interval", m_interval);
   config->Write("LogRotate", m_log_rotate);
   config->Write("LogRotateInterval", m_log_rotate_interval);
+  config->Write("LogRotateMegabytes", m_log_rotate_megabytes);
+  config->Write("LogRotateAligned", m_log_rotate_aligned);
+  config->Write("CompressRecordings", m_compress_recordings);
+  config->Write("RecordingSyncSeconds", m_sync_seconds);
+  config->Write("RawTagBlocks", m_raw_tag_blocks);
+  config->Write("DedupMilliseconds", m_dedup_ms);
+  config->Write("RecordingPolicy", m_recording_policy);
+  config->Write("RecordPgns", m_record_pgns);
+  config->Write("N2kRepeatSeconds", m_n2k_repeat_seconds);
   config->Write("AutoStartRecording", m_auto_start_recording);
   config->Write("UseSpeedThreshold", m_use_speed_threshold);
   config->Write("SpeedThreshold", m_speed_threshold);
@@ -930,13 +902,20 @@ bool RecordPlayMgr::SaveConfig() {
   config->Write("NMEA2000_UseTCP", m_protocols.n2kNet.use_tcp);
   config->Write("NMEA2000_Port", m_protocols.n2kNet.port);
   config->Write("NMEA2000_Enabled", m_protocols.n2kNet.enabled);
+  config->Write("NMEA2000_Format", static_cast<int>(m_protocols.n2k_format));
+  config->Write("RelayWhileRecording", m_protocols.relay_while_recording);
+
+  // Settings without UI, written to keep them visible and editable.
+  config->Write("ReplayExportFile", m_replay_export_file);
+  config->Write("LoopbackBatchRows", m_loopback_batch_rows);
+  config->Write("LoopbackBatchMs", m_loopback_batch_ms);
+  config->Write("PreRecordSeconds", m_pre_record_seconds);
+  config->Write("PreRecordMegabytes", m_pre_record_megabytes);
 
-#if 0
   // Signal K network settings
   config->Write("SignalK_UseTCP", m_protocols.signalkNet.use_tcp);
   config->Write("SignalK_Port", m_protocols.signalkNet.port);
   config->Write("SignalK_Enabled", m_protocols.signalkNet.enabled);
-#endif
 
   return true;
 }
@@ -955,22 +934,11 @@ void RecordPlayMgr::StartRecording() {
     wxLogMessage("Resume paused recording");
     m_recording_paused = false;
     m_recording = true;
+    FlushPreRecord();
     return;
   }
 
-  // Generate filename based on current date/time
-  wxString filename = GenerateFilename();
-  wxString fullpath = wxFileName(m_recording_dir, filename).GetFullPath();
-
-#ifdef __ANDROID__
-  // For Android, we need to use the temp file for writing, but keep track of
-  // the final location
-  m_temp_outfile = *GetpPrivateApplicationDataLocation();
-  m_temp_outfile += wxString("/vdr_temp") +
-                    (m_data_format == VdrDataFormat::kCsv ? ".csv" : ".txt");
-  m_final_outfile = "/storage/emulated/0/Android/Documents/" + filename;
-  fullpath = m_temp_outfile;
-#endif
+  const wxString dir = GetOutputDir();
 
   // Ensure directory exists
   if (!wxDirExists(m_recording_dir)) {
@@ -980,21 +948,35 @@ void RecordPlayMgr::StartRecording() {
     }
   }
 
-  if (!m_ostream.Open(fullpath, wxFile::write)) {
-    wxLogError("Failed to create recording file: %s", fullpath);
+  // Files are named after the time they are expected to start, which for a
+  // file opened ahead of rotation is in the near future.
+  m_writer.SetPathFunc([this, dir](RecordWriter::Clock::time_point start) {
+    wxDateTime time(RecordWriter::Clock::to_time_t(start));
+    wxString path = wxFileName(dir, GenerateFilename(time)).GetFullPath();
+    return ToFilePath(path);
+  });
+  m_writer.SetHeader(m_data_format == VdrDataFormat::kCsv
+                         ? "timestamp,type,id,message\n"
+                         : "");
+  m_writer.SetClosedFunc([compress = m_compress_recordings](
+                             const std::string& path, bool ok) {
+    OnFileClosed(path, ok, compress);
+  });
+  ApplyRotationPolicy();
+  m_writer.SetSyncInterval(std::chrono::seconds(std::max(0, m_sync_seconds)));
+  if (!m_writer.Open()) {
+    wxLogError("Failed to create recording file in: %s", dir);
     return;
   }
-  wxLogMessage("Start recording to file: %s", fullpath);
-
-  // Write CSV header if needed
-  if (m_data_format == VdrDataFormat::kCsv) {
-    m_ostream.Write("timestamp,type,id,message\n");
-  }
+  wxLogMessage("Start recording to file: %s",
+               FromFilePath(m_writer.GetPath()));
 
   m_recording = true;
   m_recording_paused = false;
   m_recording_start = wxDateTime::Now().ToUTC();
   m_current_recording_start = m_recording_start;
+  FlushPreRecord();
+  StartRelay();
 }
 
 void RecordPlayMgr::PauseRecording(const wxString& reason) {
@@ -1008,45 +990,104 @@ void RecordPlayMgr::PauseRecording(const wxString& reason) {
 void RecordPlayMgr::ResumeRecording() {
   if (!m_recording_paused) return;
   m_recording_paused = false;
+  FlushPreRecord();
 }
 
 void RecordPlayMgr::StopRecording(const wxString& reason) {
   if (!m_recording) return;
   wxLogMessage("Stop recording. Reason: %s", reason);
-  m_ostream.Close();
+  if (m_dedup.GetDropped() > 0) {
+    wxLogMessage("Dropped %llu of %llu sentences as duplicates",
+                 static_cast<unsigned long long>(m_dedup.GetDropped()),
+                 static_cast<unsigned long long>(m_dedup.GetChecked()));
+  }
+  m_dedup.ResetCounts();
+  if (m_decimator.GetDropped() > 0) {
+    wxLogMessage("Thinned %llu of %llu messages by recording policy",
+                 static_cast<unsigned long long>(m_decimator.GetDropped()),
+                 static_cast<unsigned long long>(m_decimator.GetChecked()));
+  }
+  m_decimator.ResetCounts();
+  if (m_n2k_ingest.GetRepeats() > 0) {
+    wxLogMessage("Dropped %llu of %llu NMEA 2000 messages as unchanged",
+                 static_cast<unsigned long long>(m_n2k_ingest.GetRepeats()),
+                 static_cast<unsigned long long>(m_n2k_ingest.GetChecked()));
+  }
+  m_n2k_ingest.ResetCounts();
+  // The file is synced, compressed and copied in the background.
+  m_writer.Close();
   m_recording = false;
+  StopRelay();
+}
+
+wxString RecordPlayMgr::GetOutputDir() const {
+#ifdef __ANDROID__
+  // For Android, files are written to the private directory and copied to
+  // the final location when closed, see OnFileClosed().
+  return *GetpPrivateApplicationDataLocation();
+#else
+  return m_recording_dir;
+#endif
+}
+
+void RecordPlayMgr::RecoverRecordings() {
+  const wxString dir = GetOutputDir();
+  if (!wxDirExists(dir)) return;
+  // Posted before any recording is started, so no new checkpoint exists.
+  m_writer.Run([dir = ToFilePath(dir),
+                compress = m_compress_recordings] {
+    for (const auto& file : RecordWriter::Recover(dir)) {
+      wxLogMessage(
+          "Recovered unfinished recording file: %s, %llu bytes, removed %llu "
+          "bytes of incomplete data",
+          FromFilePath(file.path),
+          static_cast<unsigned long long>(file.size),
+          static_cast<unsigned long long>(file.removed));
+      OnFileClosed(file.path, true, compress);
+    }
+  });
+}
+
+void RecordPlayMgr::OnFileClosed(const std::string& path, bool ok,
+                                 bool compress) {
+  wxString closed = FromFilePath(path);
+  if (!ok) wxLogWarning("Error writing recording file: %s", closed);
+  wxLogMessage("Closed recording file: %s", closed);
+  if (compress) {
+    if (GzipFile(closed, closed + ".gz")) {
+      ::wxRemoveFile(closed);
+      closed += ".gz";
+    } else {
+      wxLogWarning("Failed to compress recording file: %s", closed);
+    }
+  }
 
 #ifdef __ANDROID__
-    bool AndroidSecureCopyFile(wxString in, wxString out);
+  bool AndroidSecureCopyFile(wxString in, wxString out);
 
   // copy to "...files/VDR" directory, for local access
-  wxFileName fn = wxFileName(m_final_outfile);
-  wxString filename = fn.GetFullName();
+  wxString filename = wxFileName(closed).GetFullName();
   wxString VDR_outfile = *GetpPrivateApplicationDataLocation();
   VDR_outfile += wxString("/VDR/") + filename;
-  AndroidSecureCopyFile(m_temp_outfile, VDR_outfile);
+  AndroidSecureCopyFile(closed, VDR_outfile);
 
   // Copy to system area, e.g. ".../Documents"
-  AndroidSecureCopyFile(m_temp_outfile, m_final_outfile);
-  ::wxRemoveFile(m_temp_outfile);
+  AndroidSecureCopyFile(closed,
+                        "/storage/emulated/0/Android/Documents/" + filename);
+  ::wxRemoveFile(closed);
 #endif
 }
 
 void RecordPlayMgr::AdjustPlaybackBaseTime() {
-  if (!m_first_timestamp.IsValid() || !m_current_timestamp.IsValid()) {
+  if (m_protocols.replay_mode == ReplayMode::kLoopback) {
+    m_dm_replay_mgr->SetSpeed(GetSpeedMultiplier());
+    // Pending timer might be way off using new speed.
+    if (m_dm_replay_mgr->IsPlaying()) StartReplayTimer(0);
     return;
   }
-
-  // Calculate how much time has "elapsed" in the recording up to our current
-  // position.
-  wxTimeSpan elapsed = m_current_timestamp - m_first_timestamp;
-
-  // Set base time so that current playback position corresponds to current wall
-  // clock.
-  m_playback_base_time =
-      wxDateTime::UNow() -
-      wxTimeSpan::Milliseconds(static_cast<long>(
-          (elapsed.GetMilliseconds().ToDouble() / GetSpeedMultiplier())));
+  if (!m_engine) return;
+  m_engine->SetSpeed(GetSpeedMultiplier());
+  if (m_engine->IsPlaying()) StartReplayTimer(0);
 }
 
 void RecordPlayMgr::StartPlayback(wxString& file_status) {
@@ -1061,7 +1102,11 @@ void RecordPlayMgr::StartPlayback(wxString& file_status) {
     return;
   }
   if (m_protocols.replay_mode == ReplayMode::kLoopback) {
-    if (!m_dm_replay_mgr->IsPaused()) m_dm_replay_mgr = DmReplayMgrFactory();
+    if (!m_dm_replay_mgr->IsPaused()) {
+      m_dm_replay_mgr = DmReplayMgrFactory();
+      m_replay_stats.Reset();
+    }
+    m_dm_replay_mgr->SetSpeed(GetSpeedMultiplier());
     m_dm_replay_mgr->Start();
     if (m_dm_replay_mgr->IsPlaying())
       file_status = _("File successfully loaded");
@@ -1073,17 +1118,18 @@ void RecordPlayMgr::StartPlayback(wxString& file_status) {
   // Reset end-of-file state when starting playback
   m_at_file_end = false;
 
-  // Always adjust base time when starting playback, whether from pause or seek
-  AdjustPlaybackBaseTime();
-
-  if (!m_istream.IsOpened()) {
-    if (!m_istream.Open(m_input_file)) {
-      file_status = _("Failed to open file.");
-      // m_control_gui->UpdateFileStatus(_("Failed to open file."));
-      return;
-    }
+  // Play again from the beginning once the end is reached.
+  if (!m_engine || (m_engine->IsAtEnd() && !m_engine->Open())) {
+    file_status = _("Failed to open file.");
+    return;
   }
-  m_messages_dropped = false;
+  if (m_engine->IsIdle()) {
+    // New playback, timing statistics are kept across pause and resume.
+    m_replay_stats.Reset();
+    m_dropped_base = m_fanout.GetDropped();
+  }
+  m_engine->SetSpeed(GetSpeedMultiplier());
+  m_engine->Start();
   m_playing = true;
 
   // Initialize network servers if needed
@@ -1092,6 +1138,7 @@ void RecordPlayMgr::StartPlayback(wxString& file_status) {
     // The user has been notified via error messages in InitializeNetworkServers
     wxLogWarning("Continuing playback with failed network servers");
   }
+  ConfigureReplaySinks();
 
   if (m_control_gui) {
     m_control_gui->SetProgress(GetProgressFraction());
@@ -1101,9 +1148,7 @@ void RecordPlayMgr::StartPlayback(wxString& file_status) {
   wxLogMessage(
       "Start playback from file: %s. Progress: %.2f. Has timestamps: %d",
       m_input_file, GetProgressFraction(), m_has_timestamps);
-  // Process first line immediately.
-  m_istream.GoToLine(-1);
-
+  // Process first records immediately.
   Notify();
 }
 
@@ -1117,6 +1162,7 @@ void RecordPlayMgr::PausePlayback() {
   if (!m_playing) return;
 
   m_timer->Stop();
+  if (m_engine) m_engine->Pause();
   m_playing = false;
   if (m_control_gui) m_control_gui->UpdateControls();
 }
@@ -1126,7 +1172,11 @@ void RecordPlayMgr::StopPlayback() {
 
   m_timer->Stop();
   m_playing = false;
-  m_istream.Close();
+  // Next playback starts from the beginning.
+  if (m_engine) m_engine->Open();
+
+  // Drain sinks before their servers go away.
+  StopReplaySinks();
 
   // Stop all network servers
   StopNetworkServers();
@@ -1205,6 +1255,32 @@ bool RecordPlayMgr::InitializeNetworkServers() {
     }
   }
 
+  // Initialize Signal K network server if needed
+  if (m_protocols.signalkNet.enabled) {
+    VdrNetworkServer* server = GetServer("SignalK");
+    if (!server->IsRunning() ||
+        server->IsTCP() != m_protocols.signalkNet.use_tcp ||
+        server->GetPort() != m_protocols.signalkNet.port) {
+      server->Stop();  // Stop existing server if running
+      wxString error;
+      if (!server->Start(m_protocols.signalkNet.use_tcp,
+                         m_protocols.signalkNet.port, error)) {
+        success = false;
+        errors += error;
+      } else {
+        wxLogMessage("Started Signal K server: %s on port %d",
+                     m_protocols.signalkNet.use_tcp ? "TCP" : "UDP",
+                     m_protocols.signalkNet.port);
+      }
+    }
+  } else {
+    VdrNetworkServer* server = GetServer("SignalK");
+    if (server->IsRunning()) {
+      server->Stop();
+      wxLogMessage("Stopped Signal K network server (disabled in preferences)");
+    }
+  }
+
   if (m_control_gui) {
     if (!success) {
       m_control_gui->UpdateNetworkStatus(errors);
@@ -1232,28 +1308,88 @@ void RecordPlayMgr::StopNetworkServers() {
       wxLogMessage("Stopped NMEA2000 network server");
     }
   }
-}
 
-void RecordPlayMgr::HandleNetworkPlayback(const wxString& data) {
-  // For NMEA 0183 data
-  if (m_protocols.nmea0183Net.enabled &&
-      (data.StartsWith("$") || data.StartsWith("!"))) {
-    VdrNetworkServer* server = GetServer("NMEA0183");
-    if (server && server->IsRunning()) {
-      server->SendText(data);  // Use SendText() for NMEA messages
+  // Stop Signal K server if running
+  if (VdrNetworkServer* server = GetServer("SignalK")) {
+    if (server->IsRunning()) {
+      server->Stop();
+      wxLogMessage("Stopped Signal K network server");
     }
   }
-  // For NMEA 2000 data in various text formats
-  else if (m_protocols.n2kNet.enabled &&
-           (data.StartsWith("$PCDIN") ||   // SeaSmart
-            data.StartsWith("!AIVDM") ||   // Actisense ASCII
-            data.StartsWith("$MXPGN") ||   // MiniPlex
-            data.StartsWith("$YDRAW"))) {  // YD RAW
-    VdrNetworkServer* server = GetServer("N2K");
-    if (server && server->IsRunning()) {
-      server->SendText(data);  // Use SendText() for text-based formats
-    }
+}
+
+void RecordPlayMgr::ConfigureReplaySinks(bool for_relay) {
+  m_fanout.Clear();
+  m_fanout.SetMaxLatency(for_relay ? kRelayMaxLatency
+                                   : std::chrono::milliseconds(0));
+  m_relaying = false;
+  if (!for_relay && m_protocols.replay_mode == ReplayMode::kLoopback) return;
+
+  // Relayed data comes from OpenCPN, never push it back.
+  if (!for_relay && m_protocols.replay_mode == ReplayMode::kInternalApi) {
+    m_fanout.AddSink(std::make_shared<InternalApiSink>(kMaxBufferSize));
+  }
+  const bool nmea0183_net = m_protocols.nmea0183Net.enabled;
+  if (nmea0183_net) {
+    m_fanout.AddSink(std::make_shared<NetworkSink>(
+        "NMEA0183", GetServer("NMEA0183"), ReplayMsgType::kNmea0183));
+  }
+  if (m_protocols.n2kNet.enabled) {
+    m_fanout.AddSink(std::make_shared<N2kNetworkSink>(
+        GetServer("N2K"), m_protocols.n2k_format, !nmea0183_net));
   }
+  if (m_protocols.signalkNet.enabled) {
+    m_fanout.AddSink(std::make_shared<NetworkSink>(
+        "SignalK", GetServer("SignalK"), ReplayMsgType::kSignalK));
+  }
+  if (!for_relay && !m_replay_export_file.IsEmpty()) {
+    auto sink = std::make_shared<FileExportSink>(m_replay_export_file);
+    if (sink->IsOk()) m_fanout.AddSink(sink);
+  }
+  m_stats_sink = std::make_shared<StatsSink>();
+  m_fanout.AddSink(m_stats_sink);
+}
+
+void RecordPlayMgr::StopReplaySinks() {
+  m_fanout.Stop();
+  if (m_replay_stats.GetBatchSize().GetCount() > 0) {
+    wxLogMessage("Replay timing: %s", GetReplayStatsSummary());
+  }
+  if (m_stats_sink) {
+    wxLogMessage(
+        "Replayed messages: NMEA 0183: %llu, NMEA 2000: %llu, Signal K: %llu",
+        static_cast<unsigned long long>(
+            m_stats_sink->GetMessages(ReplayMsgType::kNmea0183)),
+        static_cast<unsigned long long>(
+            m_stats_sink->GetMessages(ReplayMsgType::kN2k)),
+        static_cast<unsigned long long>(
+            m_stats_sink->GetMessages(ReplayMsgType::kSignalK)));
+    m_stats_sink.reset();
+  }
+}
+
+void RecordPlayMgr::StartRelay() {
+  if (!m_protocols.relay_while_recording || m_relaying || IsPlaying()) return;
+  if (!InitializeNetworkServers()) {
+    wxLogWarning("Relaying with failed network servers");
+  }
+  ConfigureReplaySinks(true /* for_relay */);
+  m_relaying = true;
+  wxLogMessage("Start relaying recorded data to network servers");
+}
+
+void RecordPlayMgr::StopRelay() {
+  if (!m_relaying) return;
+  m_relaying = false;
+  StopReplaySinks();
+  StopNetworkServers();
+  wxLogMessage("Stop relaying recorded data");
+}
+
+void RecordPlayMgr::RelayMessage(const ReplayMessage& msg) {
+  // Publish() only copies the message into the ring, network I/O is done on
+  // the sink threads.
+  if (m_relaying) m_fanout.Publish(msg);
 }
 
 void RecordPlayMgr::SetDataFormat(VdrDataFormat format) {
@@ -1277,6 +1413,8 @@ void RecordPlayMgr::SetDataFormat(VdrDataFormat format) {
     // Simply update the format if not recording.
     m_data_format = format;
   }
+  // Buffered messages are formatted for the old format.
+  m_pre_record.Clear();
 }
 
 void RecordPlayMgr::ShowPreferencesDialog(wxWindow* parent) {
@@ -1299,6 +1437,7 @@ void RecordPlayMgr::ShowPreferencesDialog(wxWindow* parent) {
   if (dlg.ShowModal() == wxID_OK) {
     bool previous_nmea2000_state = m_protocols.nmea2000;
     bool previous_signal_k_state = m_protocols.signalK;
+    bool previous_tracking_speed = IsTrackingSpeed();
     SetDataFormat(dlg.GetDataFormat());
     SetRecordingDir(dlg.GetRecordingDir());
     SetLogRotate(dlg.GetLogRotate());
@@ -1310,13 +1449,17 @@ void RecordPlayMgr::ShowPreferencesDialog(wxWindow* parent) {
     m_protocols = dlg.GetProtocolSettings();
     SaveConfig();
 
-    // Update NMEA 2000 listeners if the setting changed
-    if (previous_nmea2000_state != m_protocols.nmea2000) {
+    // Update NMEA 2000 listeners if the settings changed
+    if (previous_nmea2000_state != m_protocols.nmea2000 ||
+        previous_tracking_speed != IsTrackingSpeed()) {
       UpdateNMEA2000Listeners();
     }
     if (previous_signal_k_state != m_protocols.signalK) {
       UpdateSignalKListeners();
     }
+    // Apply relay and network settings to an ongoing recording.
+    StopRelay();
+    if (m_recording) StartRelay();
 
     // Update UI if needed
     if (m_control_gui) {
@@ -1334,6 +1477,7 @@ void RecordPlayMgr::ShowPreferencesDialogNative(wxWindow* parent) {
   if (dlg.ShowModal() == wxID_OK) {
     bool previous_nmea2000_state = m_protocols.nmea2000;
     bool previous_signal_k_state = m_protocols.signalK;
+    bool previous_tracking_speed = IsTrackingSpeed();
     SetDataFormat(dlg.GetDataFormat());
     SetRecordingDir(dlg.GetRecordingDir());
     SetLogRotate(dlg.GetLogRotate());
@@ -1345,13 +1489,17 @@ void RecordPlayMgr::ShowPreferencesDialogNative(wxWindow* parent) {
     m_protocols = dlg.GetProtocolSettings();
     SaveConfig();
 
-    // Update NMEA 2000 listeners if the setting changed
-    if (previous_nmea2000_state != m_protocols.nmea2000) {
+    // Update NMEA 2000 listeners if the settings changed
+    if (previous_nmea2000_state != m_protocols.nmea2000 ||
+        previous_tracking_speed != IsTrackingSpeed()) {
       UpdateNMEA2000Listeners();
     }
     if (previous_signal_k_state != m_protocols.signalK) {
       UpdateSignalKListeners();
     }
+    // Apply relay and network settings to an ongoing recording.
+    StopRelay();
+    if (m_recording) StartRelay();
 
     // Update UI if needed
     if (m_control_gui) {
@@ -1360,149 +1508,30 @@ void RecordPlayMgr::ShowPreferencesDialogNative(wxWindow* parent) {
   }
 }
 
-void RecordPlayMgr::CheckLogRotation() {
-  if (!m_recording || !m_log_rotate) return;
-
-  wxDateTime now = wxDateTime::Now().ToUTC();
-  wxTimeSpan elapsed = now - m_recording_start;
-
-  if (elapsed.GetHours() >= m_log_rotate_interval) {
-    wxLogMessage("Rotating VDR file. Elapsed %d hours. Config: %d hours",
-                 elapsed.GetHours(), m_log_rotate_interval);
-    // Stop current recording.
-    StopRecording("Log rotation");
-    // Start new recording.
-    StartRecording();
-  }
-}
-
-bool RecordPlayMgr::ParseNmeaComponents(wxString nmea, wxString& talker_id,
-                                        wxString& sentence_id,
-                                        bool& has_timestamp) {
-  // Basic length check - minimum NMEA sentence should be at least 10 chars
-  // $GPGGA,*hh
-  if (nmea.IsEmpty() || (nmea[0] != '$' && nmea[0] != '!')) {
-    return false;
-  }
-
-  // Split the sentence into fields
-  wxStringTokenizer tok(nmea, ",*");
-  if (!tok.HasMoreTokens()) return false;
-
-  wxString header = tok.GetNextToken();
-  // Need exactly $GPXXX or !AIVDM format
-  if (header.length() != 6) return false;
-
-  // Extract talker ID (GP, GN, etc.) and sentence ID (RMC, ZDA, etc.)
-  talker_id = header.Mid(1, 2);
-  sentence_id = header.Mid(3);
-
-  // Special handling for AIS messages starting with !
-  bool is_ais = (nmea[0] == '!');
-
-  // Validate talker ID:
-  // - Must be exactly 2 chars
-  // - Must be ASCII
-  // - Must be alphabetic
-  // - Must be uppercase
-  if (talker_id.length() != 2 || !talker_id.IsAscii() || !talker_id.IsWord()) {
-    return false;
-  }
-
-  if (is_ais) {
-    // For AIS messages, only accept specific talker IDs.
-    if (talker_id != "AI" && talker_id != "AB" && talker_id != "BS") {
-      return false;
-    }
-  } else {
-    // Standard NMEA.
-    if (!talker_id.IsWord() || talker_id != talker_id.Upper()) {
-      return false;
-    }
-  }
-
-  // Validate sentence ID:
-  // - Must be exactly 3 chars
-  // - Must be ASCII
-  // - Must be alphabetic
-  // - Must be uppercase
-  if (sentence_id.length() != 3 || !sentence_id.IsAscii() ||
-      !sentence_id.IsWord()) {
-    return false;
-  }
-
-  // Check if sentence_id is uppercase by comparing with its uppercase version
-  if (sentence_id != sentence_id.Upper()) {
-    return false;
-  }
-
-  // Additional validation: must contain comma after header and checksum after
-  // data
-  size_t last_comma = nmea.Find(',');
-  size_t checksum_pos = nmea.Find('*');
-
-  if (last_comma == wxString::npos || checksum_pos == wxString::npos ||
-      checksum_pos < last_comma) {
-    return false;
-  }
-
-  // Check for known sentence types containing timestamps.
-  if (sentence_id == "RMC" || sentence_id == "ZDA" || sentence_id == "GGA" ||
-      sentence_id == "GBS" || sentence_id == "GLL") {
-    has_timestamp = true;
-    return true;
-  }
-  // Unknown sentence type but valid NMEA format.
-  has_timestamp = false;
-  return true;
-}
-
-void RecordPlayMgr::SelectPrimaryTimeSource() {
-  m_has_primary_time_source = false;
-  if (m_time_sources.empty()) return;
-
-  // Scoring criteria for each source
-  struct SourceScore {
-    TimeSource source;
-    int score;
-  };
-
-  std::vector<SourceScore> scores;
-
-  for (const auto& source : m_time_sources) {
-    if (!source.second.is_chronological) {
-      // Skip sources with non-chronological timestamps
-      continue;
-    }
-    SourceScore score = {source.first, 0};
-    // Prefer sources with complete date+time
-    if (source.first.sentence_id.Contains("RMC") ||
-        source.first.sentence_id.Contains("ZDA")) {
-      score.score += 10;
-    }
-
-    // Prefer higher precision
-    score.score += source.first.precision * 2;
-    scores.push_back(score);
-  }
-
-  // Sort by score
-  std::sort(scores.begin(), scores.end(),
-            [](const SourceScore& a, const SourceScore& b) {
-              return a.score > b.score;
-            });
-
-  // Select highest scoring source as primary
-  if (!scores.empty()) {
-    m_primary_time_source = scores[0].source;
-    m_has_primary_time_source = true;
+void RecordPlayMgr::ApplyRotationPolicy() {
+  RotationPolicy policy;
+  policy.max_bytes = static_cast<uint64_t>(std::max(0, m_log_rotate_megabytes))
+                     << 20;
+  if (m_log_rotate && m_log_rotate_interval > 0) {
+    policy.interval = std::chrono::hours(m_log_rotate_interval);
   }
+  policy.aligned = m_log_rotate_aligned;
+  m_writer.SetPolicy(policy);
 }
 
 bool RecordPlayMgr::ScanFileTimestamps(bool& has_valid_timestamps,
                                        wxString& error) {
-  if (m_protocols.replay_mode == ReplayMode::kLoopback) return true;
-  if (!m_istream.IsOpened()) {
+  if (m_protocols.replay_mode == ReplayMode::kLoopback) {
+    // Also builds the index used when seeking.
+    m_dm_replay_mgr->BuildIndex();
+    uint64_t first = m_dm_replay_mgr->GetFirstTimestamp();
+    uint64_t last = m_dm_replay_mgr->GetLastTimestamp();
+    m_first_timestamp = first ? StampToDateTime(first) : wxDateTime();
+    m_last_timestamp = last ? StampToDateTime(last) : wxDateTime();
+    has_valid_timestamps = first != 0;
+    return true;
+  }
+  if (!m_engine) {
     error = _("File not open");
     has_valid_timestamps = false;
     wxLogMessage("File not open");
@@ -1515,330 +1544,125 @@ bool RecordPlayMgr::ScanFileTimestamps(bool& has_valid_timestamps,
   m_last_timestamp = wxDateTime();
   m_current_timestamp = wxDateTime();
   m_time_sources.clear();
-  m_has_primary_time_source = false;
-  bool found_first = false;
-  wxDateTime previous_timestamp;
+  has_valid_timestamps = false;
+  error = "";
 
-  // Read first line to check format
-  wxString line = GetNextNonEmptyLine(true);
-  if (m_istream.Eof() && line.IsEmpty()) {
-    wxLogMessage("File is empty or contains only empty lines");
-    has_valid_timestamps = false;
-    // Empty file is not an error.
-    error = "";
-    return true;
-  }
-  m_timestamp_parser.Reset();
-
-  // Try to parse as CSV file
-  m_is_csv_file = ParseCSVHeader(line);
-
-  if (m_is_csv_file) {
-    // CSV file - expect timestamp column and strict chronological order
-    line = GetNextNonEmptyLine();
-    while (!m_istream.Eof()) {
-      if (!line.IsEmpty()) {
-        wxDateTime timestamp;
-        wxString nmea;
-        bool success = ParseCSVLineTimestamp(line, &nmea, &timestamp);
-        if (success && timestamp.IsValid()) {
-          // For CSV files, we require chronological order
-          if (previous_timestamp.IsValid() && timestamp < previous_timestamp) {
-            m_has_timestamps = false;
-            m_first_timestamp = wxDateTime();
-            m_last_timestamp = wxDateTime();
-            m_current_timestamp = wxDateTime();
-            m_istream.GoToLine(0);
-            has_valid_timestamps = false;
-            error = _("Timestamps not in chronological order");
-            wxLogMessage(
-                "CSV file contains non-chronological timestamps. "
-                "Previous: %s, Current: %s",
-                FormatIsoDateTime(previous_timestamp),
-                FormatIsoDateTime(timestamp));
-            return false;
-          }
-          previous_timestamp = timestamp;
-          m_last_timestamp = timestamp;
-
-          if (!found_first) {
-            m_first_timestamp = timestamp;
-            m_current_timestamp = timestamp;
-            found_first = true;
-          }
-          m_has_timestamps = true;  // Found at least one valid timestamp.
-        }
-      }
-      line = GetNextNonEmptyLine();
+  if (m_csv_decoder) {
+    // CSV file - expect timestamp column and strict chronological order.
+    // Converted recordings come with an index, others are scanned.
+    if (!m_engine->LoadIndex(ReplayIndex::GetPath(m_file_sniff.path))) {
+      m_engine->BuildIndex();
     }
-  } else {
-    // Raw NMEA/AIS - scan for time sources and assess quality
-    int precision = 0;
-    int validSentences = 0;
-    int invalidSentences = 0;
-    while (!m_istream.Eof()) {
-      if (!line.IsEmpty()) {
-        wxString talkerId, sentenceId;
-        bool hasTimestamp;
-        if (!ParseNmeaComponents(line, talkerId, sentenceId, hasTimestamp)) {
-          invalidSentences++;
-          line = GetNextNonEmptyLine();
-          continue;
-        }
-        // Valid sentence found
-        validSentences++;
-
-        if (hasTimestamp) {
-          // Create time source entry
-          TimeSource source;
-          source.talker_id = talkerId;
-          source.sentence_id = sentenceId;
-
-          wxDateTime timestamp;
-          if (m_timestamp_parser.ParseTimestamp(line, timestamp, precision)) {
-            source.precision = precision;
-            if (m_time_sources.find(source) == m_time_sources.end()) {
-              TimeSourceDetails details;
-              details.start_time = timestamp;
-              details.current_time = timestamp;
-              details.end_time = timestamp;
-              details.is_chronological = true;
-              m_time_sources[source] = details;
-            } else {
-              // Update existing source
-              TimeSourceDetails& details = m_time_sources[source];
-              // Check if timestamps are still chronological
-              if (timestamp < details.current_time) {
-                details.is_chronological = false;
-              }
-              details.current_time = timestamp;
-              details.end_time = timestamp;
-            }
-            m_has_timestamps = true;
-          }
-        }
-      }
-      line = GetNextNonEmptyLine();
-    }
-
-    // Log statistics about file quality
-    wxLogMessage("Found %d valid and %d invalid sentences in %s",
-                 validSentences, invalidSentences, m_input_file);
-
-    // Only fail if we found no valid sentences at all
-    if (validSentences == 0) {
-      has_valid_timestamps = false;
-      error = _("Invalid file");
+    if (!m_engine->IsChronological()) {
+      error = _("Timestamps not in chronological order");
+      wxLogMessage("CSV file %s contains non-chronological timestamps",
+                   m_input_file);
       return false;
     }
+    if (m_engine->GetFirstTimestamp() != 0) {
+      m_first_timestamp = StampToDateTime(m_engine->GetFirstTimestamp());
+      m_last_timestamp = StampToDateTime(m_engine->GetLastTimestamp());
+      m_current_timestamp = m_first_timestamp;
+      m_has_timestamps = true;
+    }
+    has_valid_timestamps = m_has_timestamps;
+    return true;
+  }
 
-    // Analyze time sources and select primary.
-    SelectPrimaryTimeSource();
-
-    if (m_has_timestamps) {
-      for (const auto& source : m_time_sources) {
-        wxLogMessage(
-            "  %s%s: precision=%d. is_chronological=%d. Start=%s. End=%s",
-            source.first.talker_id, source.first.sentence_id,
-            source.first.precision, source.second.is_chronological,
-            FormatIsoDateTime(source.second.start_time),
-            FormatIsoDateTime(source.second.end_time));
-      }
-      if (m_has_primary_time_source) {
-        m_first_timestamp = m_time_sources[m_primary_time_source].start_time;
-        m_current_timestamp = m_first_timestamp;
-        m_last_timestamp = m_time_sources[m_primary_time_source].end_time;
-        m_timestamp_parser.SetPrimaryTimeSource(
-            m_primary_time_source.talker_id, m_primary_time_source.sentence_id,
-            m_primary_time_source.precision);
+  // Raw NMEA/AIS - scan for time sources and assess quality
+  m_raw_decoder->ScanTimeSources();
+  const int valid_sentences = m_raw_decoder->GetValidSentences();
+  const int invalid_sentences = m_raw_decoder->GetInvalidSentences();
+  if (valid_sentences == 0 && invalid_sentences == 0) {
+    // Empty file is not an error.
+    wxLogMessage("File is empty or contains only empty lines");
+    return true;
+  }
+  wxLogMessage("Found %d valid and %d invalid sentences in %s",
+               valid_sentences, invalid_sentences, m_input_file);
 
-        wxLogMessage(
-            "Using %s%s (precision=%d) as primary time source. Start=%s. "
-            "End=%s",
-            m_primary_time_source.talker_id, m_primary_time_source.sentence_id,
-            m_primary_time_source.precision,
-            FormatIsoDateTime(m_first_timestamp),
-            FormatIsoDateTime(m_last_timestamp));
-      }
-    } else {
-      wxLogMessage("No timestamps found in NMEA file %s", m_input_file);
+  // Only fail if we found no valid sentences at all
+  if (valid_sentences == 0) {
+    error = _("Invalid file");
+    return false;
+  }
+  m_time_sources = m_raw_decoder->GetTimeSources();
+  m_has_timestamps = !m_time_sources.empty();
+  if (m_has_timestamps) {
+    for (const auto& source : m_time_sources) {
+      wxLogMessage(
+          "  %s%s: precision=%d. is_chronological=%d. Start=%s. End=%s",
+          source.first.talker_id, source.first.sentence_id,
+          source.first.precision, source.second.is_chronological,
+          FormatIsoDateTime(source.second.start_time),
+          FormatIsoDateTime(source.second.end_time));
+    }
+    if (m_raw_decoder->HasPrimaryTimeSource()) {
+      const TimeSource& primary = m_raw_decoder->GetPrimaryTimeSource();
+      m_first_timestamp = m_time_sources[primary].start_time;
+      m_current_timestamp = m_first_timestamp;
+      m_last_timestamp = m_time_sources[primary].end_time;
+      wxLogMessage(
+          "Using %s%s (precision=%d) as primary time source. Start=%s. "
+          "End=%s",
+          primary.talker_id, primary.sentence_id, primary.precision,
+          FormatIsoDateTime(m_first_timestamp),
+          FormatIsoDateTime(m_last_timestamp));
     }
+  } else {
+    wxLogMessage("No timestamps found in NMEA file %s", m_input_file);
+  }
+  // Restart, now timed by the primary time source.
+  if (!m_engine->Open()) {
+    error = _("Failed to open file: ") + m_input_file;
+    return false;
   }
 
-  // Reset file position to start
-  m_istream.GoToLine(-1);
-
-  // For CSV files, timestamps must be present and valid.
-  // For NMEA files, we can still do line-based playback without timestamps
   // There is a possibility that the file contains non-monotonically
   // increasing timestamps, in which case we cannot use timestamps for
-  // playback. In this case, we will still allow playback based on line
-  // number.
+  // playback. In this case, we will still allow untimed playback.
   has_valid_timestamps = m_has_timestamps;
-  error = "";
   return true;
 }
 
-wxString RecordPlayMgr::GetNextNonEmptyLine(bool from_start) {
-  if (!m_istream.IsOpened()) return "";
-
-  wxString line;
-  if (from_start) {
-    m_istream.GoToLine(-1);
-    line = m_istream.GetFirstLine();
-  } else {
-    line = m_istream.GetNextLine();
-  }
-  line.Trim(true).Trim(false);
-
-  // Keep reading until we find a non-empty line or reach EOF
-  while ((line.IsEmpty() || line.StartsWith("#")) && !m_istream.Eof()) {
-    line = m_istream.GetNextLine();
-    line.Trim(true).Trim(false);
-  }
-
-  return line;
-}
-
 bool RecordPlayMgr::SeekToFraction(double fraction) {
   // Validate input
   if (fraction < 0.0 || fraction > 1.0) {
     wxLogWarning("Invalid seek fraction: %f", fraction);
     return false;
   }
-  if (!m_istream.IsOpened()) {
-    wxLogWarning("Cannot seek, no file open");
-    return false;
-  }
-
-  // For files without timestamps, use line-based position.
-  if (!HasValidTimestamps()) {
-    int total_lines = m_istream.GetLineCount();
-    if (total_lines > 0) {
-      int target_line = static_cast<int>(fraction * total_lines);
-      m_istream.GoToLine(target_line);
-      return true;
-    }
-    return false;
+  if (m_protocols.replay_mode == ReplayMode::kLoopback) {
+    return m_dm_replay_mgr->SeekToFraction(fraction);
   }
-
-  // Handle seeking in CSV files
-  if (m_is_csv_file) {
-    if (!HasValidTimestamps()) {
-      return false;
-    }
-
-    // Calculate target timestamp
-    wxTimeSpan total_span = m_last_timestamp - m_first_timestamp;
-    wxTimeSpan target_span =
-        wxTimeSpan::Seconds((total_span.GetSeconds().ToDouble() * fraction));
-    wxDateTime target_time = m_first_timestamp + target_span;
-
-    // Scan file until we find first message after target time
-    wxString line = GetNextNonEmptyLine(true);  // Skip header
-    line = GetNextNonEmptyLine();               // Get first data line
-
-    while (!m_istream.Eof()) {
-      wxDateTime timestamp;
-      wxString nmea;
-      bool success = ParseCSVLineTimestamp(line, &nmea, &timestamp);
-      if (success && timestamp.IsValid() && timestamp >= target_time) {
-        // Found our position, prepare to play from here
-        m_current_timestamp = timestamp;
-        if (m_playing) {
-          AdjustPlaybackBaseTime();
-        }
-        return true;
-      }
-      line = GetNextNonEmptyLine();
-    }
+  if (!m_engine) {
+    wxLogWarning("Cannot seek, no file open");
     return false;
   }
-
-  // Handle seeking in NMEA files
-  else {
-    // If we have valid timestamps in the NMEA file, use them.
-    if (!HasValidTimestamps()) {
-      return false;
-    }
-    wxTimeSpan totalSpan = m_last_timestamp - m_first_timestamp;
-    wxTimeSpan targetSpan =
-        wxTimeSpan::Seconds((totalSpan.GetSeconds().ToDouble() * fraction));
-    wxDateTime targetTime = m_first_timestamp + targetSpan;
-
-    // Scan file for closest timestamp
-    m_istream.GoToLine(0);
-    wxString line;
-    wxDateTime lastTimestamp;
-    bool foundPosition = false;
-    int precision;
-
-    while (!m_istream.Eof()) {
-      line = GetNextNonEmptyLine();
-      wxDateTime timestamp;
-      if (m_timestamp_parser.ParseTimestamp(line, timestamp, precision)) {
-        if (timestamp >= targetTime) {
-          m_current_timestamp = timestamp;
-          foundPosition = true;
-          break;
-        }
-        // lastTimestamp = timestamp;
-      }
-    }
-
-    if (foundPosition) {
-      if (m_playing) {
-        AdjustPlaybackBaseTime();
-      }
-      return true;
-    }
-  }
-
-  return false;
+  return m_engine->SeekToFraction(fraction);
 }
 
 bool RecordPlayMgr::HasValidTimestamps() const {
   return m_has_timestamps && m_first_timestamp.IsValid() &&
-         m_last_timestamp.IsValid() && m_current_timestamp.IsValid();
+         m_last_timestamp.IsValid();
 }
 
 double RecordPlayMgr::GetProgressFraction() const {
   if (m_protocols.replay_mode == ReplayMode::kLoopback)
     return m_dm_replay_mgr->GetProgressFraction();
 
-  // For files with timestamps
-  if (HasValidTimestamps()) {
-    wxTimeSpan total_span = m_last_timestamp - m_first_timestamp;
-    wxTimeSpan current_span = m_current_timestamp - m_first_timestamp;
-
-    if (total_span.GetSeconds().ToLong() == 0) {
-      return 0.0;
-    }
-
-    return current_span.GetSeconds().ToDouble() /
-           total_span.GetSeconds().ToDouble();
-  }
-
-  // For files without timestamps, use line position.
-  if (m_istream.IsOpened()) {
-    int total_lines = m_istream.GetLineCount();
-    int current_line = m_istream.GetCurrentLine();
-    if (total_lines > 0) {
-      // Clamp current line to total lines to ensure fraction doesn't
-      // exceed 1.0.
-      current_line = std::max(0, std::min(current_line, total_lines));
-      return static_cast<double>(current_line) / total_lines;
-    }
-  }
-
-  return 0.0;
+  return m_engine ? m_engine->GetProgressFraction() : 0.0;
 }
 
 void RecordPlayMgr::ClearInputFile() {
   m_input_file.Clear();
-  if (m_istream.IsOpened()) {
-    m_istream.Close();
-  }
+  CloseReplayEngine();
+  RemoveUnpackedFile();
+}
+
+void RecordPlayMgr::RemoveUnpackedFile() {
+  if (m_unpacked_file.IsEmpty()) return;
+  ::wxRemoveFile(m_unpacked_file);
+  m_unpacked_file.Clear();
 }
 
 wxString RecordPlayMgr::GetInputFile() const {
@@ -1855,32 +1679,95 @@ std::unique_ptr<DataMonitorReplayMgr> RecordPlayMgr::DmReplayMgrFactory() {
   auto user_message = [&](VdrMsgType t, const std::string& s) {
     OnVdrMsg(t, s);
   };
-  return std::make_unique<DataMonitorReplayMgr>(m_input_file.ToStdString(),
-                                                update_controls, user_message);
+  auto dm_replay_mgr = std::make_unique<DataMonitorReplayMgr>(
+      m_file_sniff, update_controls, user_message);
+  dm_replay_mgr->SetBatchBudget(
+      static_cast<unsigned>(std::max(m_loopback_batch_rows, 1)),
+      std::chrono::milliseconds(std::max(m_loopback_batch_ms, 1)));
+  dm_replay_mgr->SetStats(&m_replay_stats);
+  return dm_replay_mgr;
 }
 
-bool RecordPlayMgr::LoadFile(const wxString& filename, wxString* error) {
+bool RecordPlayMgr::OpenReplayEngine() {
+  CloseReplayEngine();
+  std::unique_ptr<ReplayDecoder> decoder;
+  if (m_file_sniff.format == VdrFileFormat::kVdrCsv) {
+    auto csv_decoder = std::make_unique<VdrCsvDecoder>(m_file_sniff);
+    m_csv_decoder = csv_decoder.get();
+    decoder = std::move(csv_decoder);
+  } else {
+    // Anything else is tried as raw NMEA, see ScanFileTimestamps().
+    auto raw_decoder = std::make_unique<RawNmeaDecoder>(m_file_sniff);
+    m_raw_decoder = raw_decoder.get();
+    decoder = std::move(raw_decoder);
+  }
+  m_engine = std::make_unique<ReplayEngine>(std::move(decoder), m_fanout);
+  m_engine->SetStats(&m_replay_stats);
+  if (!m_engine->Open()) {
+    CloseReplayEngine();
+    return false;
+  }
+  return true;
+}
+
+void RecordPlayMgr::CloseReplayEngine() {
+  m_engine.reset();
+  m_raw_decoder = nullptr;
+  m_csv_decoder = nullptr;
+}
+
+bool RecordPlayMgr::LoadFile(const wxString& filename, wxString* error,
+                             const FileSniff* sniff) {
   if (IsPlaying()) {
     StopPlayback();
   }
+  CloseReplayEngine();
 
   m_input_file = filename;
-  if (m_protocols.replay_mode == ReplayMode::kLoopback) {
-    m_dm_replay_mgr = DmReplayMgrFactory();
+  if (sniff) {
+    m_file_sniff = *sniff;
+  } else if (!SniffFile(ToFilePath(filename), m_file_sniff)) {
+    m_file_sniff = FileSniff();
+    if (error) {
+      *error = _("Failed to open file: ") + filename;
+    }
+    return false;
   }
 
   // Reset all file-related state
-  m_is_csv_file = false;
-  m_timestamp_idx = static_cast<unsigned int>(-1);
-  m_message_idx = static_cast<unsigned int>(-1);
-  m_header_fields.Clear();
   m_at_file_end = false;
-
-  // Close existing file if open
-  if (m_istream.IsOpened()) {
-    m_istream.Close();
+  m_dm_replay_mgr = std::make_unique<DataMonitorReplayMgr>();
+  RemoveUnpackedFile();
+
+  // Compressed recordings are played from a temporary unpacked copy.
+  if (m_file_sniff.format == VdrFileFormat::kGzip) {
+    m_unpacked_file = GunzipFile(filename);
+    if (m_unpacked_file.IsEmpty() ||
+        !SniffFile(ToFilePath(m_unpacked_file), m_file_sniff)) {
+      RemoveUnpackedFile();
+      m_file_sniff = FileSniff();
+      if (error) {
+        *error = _("Failed to decompress file: ") + filename;
+      }
+      return false;
+    }
+  }
+  if (m_protocols.replay_mode == ReplayMode::kLoopback) {
+    // Data Monitor logs are played by their own replay manager.
+    m_dm_replay_mgr = DmReplayMgrFactory();
+    return true;
+  }
+  if (m_file_sniff.format == VdrFileFormat::kCompressed ||
+      m_file_sniff.format == VdrFileFormat::kGzip ||
+      m_file_sniff.format == VdrFileFormat::kBinary) {
+    if (error) {
+      *error = m_file_sniff.format != VdrFileFormat::kBinary
+                   ? _("Compressed files are not supported: ") + filename
+                   : _("Not a text file: ") + filename;
+    }
+    return false;
   }
-  if (!m_istream.Open(m_input_file)) {
+  if (!OpenReplayEngine()) {
     if (error) {
       *error = _("Failed to open file: ") + filename;
     }
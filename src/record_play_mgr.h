@@ -18,6 +18,7 @@
 #ifndef RECORD_PLAY_MGR_H_
 #define RECORD_PLAY_MGR_H_
 
+#include <chrono>
 #include <cstdint>
 #include <deque>
 #include <map>
@@ -47,7 +48,22 @@
 #include "config.h"
 #include "control_gui.h"
 #include "dm_replay_mgr.h"
+#include "file_sniffer.h"
+#include "n2k_encoder.h"
+#include "n2k_ingest.h"
 #include "ocpn_plugin.h"
+#include "pre_record_buffer.h"
+#include "record_clock.h"
+#include "record_decimator.h"
+#include "record_dedup.h"
+#include "record_formatter.h"
+#include "record_writer.h"
+#include "replay_engine.h"
+#include "replay_fanout.h"
+#include "replay_sinks.h"
+#include "replay_stats.h"
+#include "speed_tracker.h"
+#include "vdr_decoders.h"
 #include "vdr_network.h"
 #include "vdr_pi_time.h"
 
@@ -87,8 +103,15 @@ public:
 
   void SetControlGui(VdrControlGui* gui) { m_control_gui = gui; }
 
-  /** Load a VDR file containing NMEA data, either in raw NMEA format or CSV. */
-  bool LoadFile(const wxString& filename, wxString* error = nullptr);
+  /**
+   * Load a VDR file containing NMEA data, either in raw NMEA format or CSV.
+   * @param filename File to load.
+   * @param error If not null, set to a user message on errors.
+   * @param sniff Result of SniffFile() on filename if available, avoids
+   *     reading the file header again.
+   */
+  bool LoadFile(const wxString& filename, wxString* error = nullptr,
+                const FileSniff* sniff = nullptr);
 
   /** Start playback of VDR data. */
   void StartPlayback(wxString& file_status);
@@ -140,20 +163,15 @@ public:
   bool ScanFileTimestamps(bool& has_valid_timestamps, wxString& error);
 
   /**
-   * Seek playback position to specified fraction of file.
-   *
-   * For files with timestamps, seeks to matching timestamp.
-   * For files without timestamps, seeks to line number.
+   * Seek playback position to the first record at specified fraction of
+   * the file size or later.
    * @param fraction Position as fraction between 0-1
    * @return True if seek successful
    */
   bool SeekToFraction(double fraction);
 
   /**
-   * Get current playback position as fraction of total.
-   *
-   * For files with timestamps, based on timestamp position.
-   * For files without timestamps, based online position.
+   * Get current playback position as fraction of the file size.
    * @return Position as fraction between 0-1
    */
   double GetProgressFraction() const;
@@ -164,11 +182,15 @@ public:
   /** Get timestamp of last message in file. */
   wxDateTime GetLastTimestamp() const { return m_last_timestamp; }
 
-  /** Get timestamp at current playback position. */
+  /**
+   * Get timestamp at current playback position. Before any timestamp is
+   * played, this is the value set by SetCurrentTimestamp().
+   */
   wxDateTime GetCurrentTimestamp() const;
 
   /**
-   * Set timestamp for current playback position.
+   * Set timestamp for current playback position, as displayed until a
+   * timestamp is played.
    * @param timestamp New current timestamp
    */
   void SetCurrentTimestamp(const wxDateTime& timestamp) {
@@ -187,11 +209,23 @@ public:
   /**
    * Adjust playback timing based on speed multiplier setting.
    *
-   * Update base time to maintain proper message timing when
-   * playback speed is changed.
+   * Timing is rebased at the current position, playing continues smoothly
+   * at the new speed.
    */
   void AdjustPlaybackBaseTime();
 
+  /** Return replay timing statistics as a human readable summary. */
+  wxString GetReplayStatsSummary();
+
+  /** Return replay timing statistics as JSON. */
+  std::string GetReplayStatsJson();
+
+  /**
+   * Write replay timing statistics as JSON to file.
+   * @return True on success.
+   */
+  bool ExportReplayStats(const wxString& path);
+
   bool IsUsingLoopback() const {
     return m_protocols.replay_mode == ReplayMode::kLoopback;
   }
@@ -212,27 +246,16 @@ protected:
    * Get details for all available time sources
    * @return Map of time sources and their details
    */
-  const std::unordered_map<TimeSource, TimeSourceDetails, TimeSourceHash>&
-  GetTimeSources() const {
+  const TimeSourceMap& GetTimeSources() const {
     return m_time_sources;
   }
 
   /**
-   * Get the next non-empty line from the input stream. Empty lines are skipped.
-   * A line is considered empty if it contains only whitespace.
-   *
-   * Lines starting with '#' are considered comments and are also skipped.
-   *
-   * @param from_start If true, starts reading from the beginning of the file.
-   *                 If false, continues from current position.
-   * @return The next non-empty line with leading/trailing whitespace removed,
-   *         or empty string if no more non-empty lines exist or file isn't
-   * open.
+   * Write a Signal K delta to the recording. The delta is expected to be
+   * compact JSON on a single line, it is written as is and replayed
+   * without being parsed again.
    */
-  wxString GetNextNonEmptyLine(bool from_start = false);
-
-  /** Helper to flush the sentence buffer to NMEA stream. */
-  void FlushSentenceBuffer();
+  void RecordSignalKDelta(const wxString& delta);
 
   /**
    * Set directory for storing VDR recordings.
@@ -253,19 +276,28 @@ protected:
    * Enable or disable automatic log rotation.
    * @param enable True to enable rotation
    */
-  void SetLogRotate(bool enable) { m_log_rotate = enable; }
+  void SetLogRotate(bool enable) {
+    m_log_rotate = enable;
+    ApplyRotationPolicy();
+  }
 
   /** Start recording VDR data. */
   void StartRecording();
 
-  /** Stop recording VDR data and close the VDR file. */
+  /**
+   * Stop recording VDR data. The VDR file is closed in the background, see
+   * WaitRecordingsClosed().
+   */
   void StopRecording(const wxString& reason = "");
 
+  /** Wait until closed and recovered recording files are handled. */
+  void WaitRecordingsClosed() { m_writer.WaitIdle(); }
+
 private:
   class VdrTimer : public wxTimer {
   public:
     explicit VdrTimer(RecordPlayMgr* plugin) : m_plugin(plugin) {}
-    void Notify() override { m_plugin->Notify(); }
+    void Notify() override { m_plugin->OnReplayTimer(); }
 
   private:
     RecordPlayMgr* m_plugin;
@@ -281,6 +313,15 @@ private:
    */
   void Notify();
 
+  /** Replay timer expired: record timer jitter and Notify(). */
+  void OnReplayTimer();
+
+  /** Start one-shot replay timer, remembering when it is due. */
+  void StartReplayTimer(int delay_ms);
+
+  /** Update drop count in m_replay_stats from the sinks. */
+  void UpdateReplayStats();
+
   /** Resume recording using the same VDR file. */
   void ResumeRecording();
 
@@ -294,15 +335,31 @@ private:
   wxString GetRecordingDir() const { return m_recording_dir; }
 
   /**
-   * Generate filename for new recording based on current UTC time.
+   * Generate filename for new recording starting at given time.
    *
    * Creates filename in format: vdr_YYYYMMDDTHHMMSSz with appropriate
-   * extension.
+   * extension, using UTC time.
    */
-  wxString GenerateFilename() const;
+  wxString GenerateFilename(const wxDateTime& start) const;
+
+  /** Set rotation policy of m_writer from the log rotation preferences. */
+  void ApplyRotationPolicy();
 
-  /** Check if current recording file needs rotation based on elapsed time. */
-  void CheckLogRotation();
+  /**
+   * Handle a recording file closed by m_writer, invoked in its background
+   * thread. Compresses the file if configured, and on Android copies it to
+   * the user accessible directories.
+   */
+  static void OnFileClosed(const std::string& path, bool ok, bool compress);
+
+  /**
+   * Repair and finish recording files left behind by a crash, in the
+   * background thread of m_writer.
+   */
+  void RecoverRecordings();
+
+  /** Return directory where recording files are written. */
+  wxString GetOutputDir() const;
 
   /** Get configured interval between log rotations in hours. */
   int GetLogRotateInterval() const { return m_log_rotate_interval; }
@@ -311,7 +368,10 @@ private:
    * Set interval for automatic log rotation.
    * @param hours Hours between rotations
    */
-  void SetLogRotateInterval(int hours) { m_log_rotate_interval = hours; }
+  void SetLogRotateInterval(int hours) {
+    m_log_rotate_interval = hours;
+    ApplyRotationPolicy();
+  }
 
   /**
    * Enable or disable automatic recording start.
@@ -353,9 +413,31 @@ private:
    */
   void CheckAutoRecording(double speed);
 
-  /** Helper function to extract NMEA sentence components. */
-  static bool ParseNmeaComponents(wxString nmea, wxString& talker_id,
-                                  wxString& sentence_id, bool& has_timestamp);
+  /** Return true if speed over ground is needed by CheckAutoRecording(). */
+  bool IsTrackingSpeed() const {
+    return m_auto_start_recording && m_use_speed_threshold;
+  }
+
+  /** Feed speed from source to m_speed_tracker and auto recording. */
+  void UpdateSpeed(SpeedSource source, double knots);
+
+  /** Return true if received messages are written to the VDR file. */
+  bool IsWritingRecords() const { return m_recording && !m_recording_paused; }
+
+  /**
+   * Return true if received messages are kept in m_pre_record while
+   * waiting for auto recording to start or resume.
+   */
+  bool IsPreRecording() const {
+    return m_pre_record.IsEnabled() && IsTrackingSpeed() && !IsPlaying() &&
+           !IsWritingRecords();
+  }
+
+  /** Write m_record_buffer to VDR file if recording, else to m_pre_record. */
+  void WriteRecord();
+
+  /** Write messages in m_pre_record to VDR file and clear it. */
+  void FlushPreRecord();
 
   /**
    * Get the ConnectionSettings structure for a specific protocol.
@@ -365,39 +447,6 @@ private:
    */
   const ConnectionSettings& GetNetworkSettings(const wxString& protocol) const;
 
-  /**
-   * Calculate when the current NMEA/SignalK message should be played during
-   * replay.
-   *
-   * This function determines the exact time when the current message should be
-   * displayed, accounting for the playback speed multiplier. The time returned
-   * is in terms of the computer's clock, not the original message timestamps.
-   *
-   * The calculation works by:
-   * 1. Finding how much time elapsed between the first message and current
-   * message
-   * 2. Scaling this elapsed time based on the playback speed (e.g. half-time at
-   * 2x speed)
-   * 3. Adding the scaled time to when playback started
-   *
-   * @return wxDateTime When to play the current message, relative to system
-   * time. Returns invalid wxDateTime if any required timestamps are invalid.
-   *
-   * @see GetSpeedMultiplier() - Controls how fast messages are replayed
-   */
-  wxDateTime GetNextPlaybackTime() const;
-
-  static wxString FormatNmea0183AsCsv(const wxString& nmea);
-
-  bool ParseCSVHeader(const wxString& header);
-
-  /** Parse timestamp from a CSV line or raw NMEA sentence. */
-  bool ParseCSVLineTimestamp(const wxString& line, wxString* messages,
-                             wxDateTime* timestamp);
-
-  /** Return true if the message is a NMEA0183 or AIS message */
-  static bool IsNmea0183OrAis(const wxString& message);
-
   /** Update SignalK event listeners when preferences are changed. */
   void UpdateSignalKListeners();
 
@@ -410,9 +459,6 @@ private:
   /** Process incoming SignalK message from OpenCPN. */
   void OnSignalKEvent(wxCommandEvent& ev);
 
-  /** Helper to select the best primary time source. */
-  void SelectPrimaryTimeSource();
-
   double GetSpeedMultiplier() const;
 
   /**
@@ -483,34 +529,49 @@ private:
   void StopNetworkServers();
 
   /**
-   * Process and send data through appropriate network servers during playback.
-   *
-   * This function handles the routing of NMEA messages to the appropriate
-   * network server based on message type and protocol settings. It supports:
-   *
-   * NMEA0183:
-   * - Messages starting with '$' or '!'
-   * - Only sends if NMEA0183 networking is enabled
-   *
-   * NMEA2000:
-   * - SeaSmart format ($PCDIN)
-   * - Actisense ASCII format (!AIVDM)
-   * - MiniPlex format ($MXPGN)
-   * - YD RAW format ($YDRAW)
-   * - Only sends if NMEA2000 networking is enabled
-   *
-   * @param data The NMEA message to send
-   *        Each message should be a complete NMEA sentence including any line
-   * endings
-   *
+   * Set up replay sinks for the current replay mode and network settings:
+   * internal API, one network sink per enabled server, optional file
+   * re-export and message statistics.
    */
-  void HandleNetworkPlayback(const wxString& data);
+  void ConfigureReplaySinks(bool for_relay = false);
+
+  /** Stop replay sink threads and log statistics. */
+  void StopReplaySinks();
+
+  /**
+   * Start relaying recorded data to the enabled network servers, if
+   * enabled in preferences. Does nothing if already relaying.
+   */
+  void StartRelay();
+
+  /** Stop relaying and stop the network servers. */
+  void StopRelay();
+
+  /** Publish a live message to the relay sinks, if relaying. */
+  void RelayMessage(const ReplayMessage& msg);
 
   /** Handle message callback from dm_replay_mgr et al. */
   static void OnVdrMsg(VdrMsgType type, std::string msg);
 
   std::unique_ptr<DataMonitorReplayMgr> DmReplayMgrFactory();
 
+  /**
+   * Create m_engine with a decoder for the format in m_file_sniff.
+   * @return false if the file cannot be opened.
+   */
+  bool OpenReplayEngine();
+
+  /** Delete m_engine and its decoder. */
+  void CloseReplayEngine();
+
+  /** Return the file actually read when playing m_input_file. */
+  [[nodiscard]] wxString GetPlayFile() const {
+    return m_unpacked_file.IsEmpty() ? m_input_file : m_unpacked_file;
+  }
+
+  /** Delete m_unpacked_file, if any. */
+  void RemoveUnpackedFile();
+
   int m_tb_item_id_record;
   int m_tb_item_id_play;
 
@@ -522,6 +583,15 @@ private:
   /** Input filename for playback. */
   wxString m_input_file;
 
+  /** Temporary decompressed copy of gzip m_input_file, else empty. */
+  wxString m_unpacked_file;
+
+  /**
+   * Head and format of the played file, read once by LoadFile(). Describes
+   * m_unpacked_file if set.
+   */
+  FileSniff m_file_sniff;
+
   /** Output filename for recording. */
   wxString m_ofilename;
 
@@ -562,11 +632,56 @@ private:
   /** Network servers for each protocol */
   std::map<wxString, std::unique_ptr<VdrNetworkServer>> m_network_servers;
 
-  /** Input file stream for playback. */
-  wxTextFile m_istream;
+  /** Plays m_input_file unless using loopback, else null. */
+  std::unique_ptr<ReplayEngine> m_engine;
+
+  /** Decoder of m_engine for raw NMEA files, else null. */
+  RawNmeaDecoder* m_raw_decoder;
+
+  /** Decoder of m_engine for VDR CSV files, else null. */
+  VdrCsvDecoder* m_csv_decoder;
+
+  /** Recording output, handles rotation of files. */
+  RecordWriter m_writer;
+
+  /** Receive time of all recorded messages, whatever protocol. */
+  RecordClock m_record_clock;
+
+  /** Formats recorded messages into m_record_buffer. */
+  RecordFormatter m_record_formatter;
+
+  /** Prefix sentences in raw recordings with a receive time tag block. */
+  bool m_raw_tag_blocks;
 
-  /** Output file stream for recording. */
-  wxFile m_ostream;
+  /** Drops duplicate NMEA 0183 sentences before recording. */
+  RecordDedup m_dedup;
+
+  /** Time window of m_dedup in milliseconds, 0 disables it. */
+  int m_dedup_ms;
+
+  /** Thins high rate messages before recording. */
+  RecordDecimator m_decimator;
+
+  /** Policy of m_decimator as configured, empty disables it. */
+  wxString m_recording_policy;
+
+  /** Filters NMEA 2000 messages before recording. */
+  N2kIngest m_n2k_ingest;
+
+  /** PGN allow list of m_n2k_ingest as configured. */
+  wxString m_record_pgns;
+
+  /** Repeat interval of m_n2k_ingest, 0 records all repeats. */
+  int m_n2k_repeat_seconds;
+
+  /** Last received NMEA 2000 message, reused between messages. */
+  N2kMessage m_n2k_msg;
+
+  /** Formatted message written to m_writer, reused between messages. */
+  std::string m_record_buffer;
+
+  /** UTF-8 copy of the message being recorded, reused between messages. */
+  std::string m_record_text;
 
   /** Plugin toolbar icon. */
   wxBitmap m_panelBitmap;
@@ -585,43 +700,27 @@ private:
    */
   std::vector<std::shared_ptr<ObservableListener>> m_signalk_listeners;
 
-  /** Flag indicating if current file is CSV format. */
-  bool m_is_csv_file;
-
-  /** Column headers when reading CSV format files. */
-  wxArrayString m_header_fields;
-
-  /**
-   * Index of timestamp column in CSV format.
-   *
-   * Set to -1 if timestamp column not found.
-   */
-  unsigned int m_timestamp_idx;
-
-  /**
-   * Index of NMEA message column in CSV format.
-   *
-   * Set to -1 if message column not found.
-   */
-  unsigned int m_message_idx;
-
   /** Whether to automatically rotate log files. */
   bool m_log_rotate;
 
   /** Log rotation interval in hours. */
   int m_log_rotate_interval;
 
+  /** Rotate log when file exceeds this size, 0 means no limit. */
+  int m_log_rotate_megabytes;
+
+  /** Rotate log on multiples of the interval in UTC, e.g. on the hour. */
+  bool m_log_rotate_aligned;
+
+  /** Compress closed recording files using gzip. */
+  bool m_compress_recordings;
+
+  /** Seconds between syncs of the recording file to disk, 0 disables. */
+  int m_sync_seconds;
+
   /** When current recording started. */
   wxDateTime m_recording_start;
 
-  /**
-   * System time when VDR playback was started.
-   *
-   * Used as the reference point for calculating when each message should be
-   * played. All playback times are calculated as an offset from this timestamp.
-   */
-  wxDateTime m_playback_base_time;
-
   /**
    * The first (earliest) timestamp from the primary time source in the VDR
    * file.
@@ -631,7 +730,7 @@ private:
   /** The last timestamp from the primary time source in the VDR file. */
   wxDateTime m_last_timestamp;
 
-  /** The current timestamp during VDR playback. */
+  /** Current timestamp as set by SetCurrentTimestamp(). */
   wxDateTime m_current_timestamp;
 
   /** Track whether file has valid timestamps. */
@@ -655,14 +754,14 @@ private:
   double m_speed_threshold;
 
   /**
-   * Last known speed over ground, in knots.
+   * Last known speed over ground.
    *
    * The speed is used to determine when to start and stop recording based on
    * the configured speed threshold. The speed is received from:
-   * 1. The RMC sentence for NMEA 0183 recordings.
+   * 1. The RMC and VTG sentences for NMEA 0183 recordings.
    * 2. The SOG field in NMEA 2000 PGN 129026 messages.
    */
-  double m_last_speed;
+  SpeedTracker m_speed_tracker;
 
   /**
    * Indicate user has manually disabled recording while auto-recording was in
@@ -687,41 +786,60 @@ private:
    */
   static constexpr int kMaxBufferSize = 1000;
 
-  /**
-   * Circular buffer for sentences.
-   * Used to store incoming NMEA sentences for playback, especially
-   * at high speeds where sentences may arrive faster than they can be played.
-   * At high replay speeds, some sentences may be skipped to maintain timing.
-   */
-  std::deque<wxString> m_sentence_buffer;
+  /** Distributes replayed messages to the sinks. */
+  ReplayFanout m_fanout;
+
+  /** Message counters, part of the sinks during network/internal replay. */
+  std::shared_ptr<StatsSink> m_stats_sink;
 
-  /** Flag indicating if messages have been dropped from the buffer. */
-  bool m_messages_dropped;
+  /** Replay timing statistics of current playback. */
+  ReplayStats m_replay_stats;
+
+  /** Fan-out drop count when m_replay_stats was reset. */
+  uint64_t m_dropped_base;
+
+  /** When the replay timer should fire. */
+  std::chrono::steady_clock::time_point m_timer_due;
+
+  /** If not empty, replayed messages are also written to this file. */
+  wxString m_replay_export_file;
+
+  /** Max rows sent per loopback replay timer tick. */
+  int m_loopback_batch_rows;
+
+  /** Max milliseconds spent per loopback replay timer tick. */
+  int m_loopback_batch_ms;
+
+  /** Messages received before auto recording starts or resumes. */
+  PreRecordBuffer m_pre_record;
+
+  /** Max age of messages in m_pre_record, 0 disables it. */
+  int m_pre_record_seconds;
+
+  /** Max memory used by m_pre_record. */
+  int m_pre_record_megabytes;
+
+  /** True while recorded data is relayed to network servers. */
+  bool m_relaying;
+
+  /** Scratch message for relayed data. */
+  ReplayMessage m_relay_msg;
+
+  /** Max time a relayed sentence waits before being sent. */
+  static constexpr std::chrono::milliseconds kRelayMaxLatency{20};
 
   wxEvtHandler* m_event_handler;
   VdrTimer* m_timer;
-  TimestampParser m_timestamp_parser;  //!< Helper for timestamp parsing
 
   /**
    * The set of time sources in the VDR recording.
    * Each time source is identified by its NMEA sentence type, talker ID and
    * precision.
    */
-  std::unordered_map<TimeSource, TimeSourceDetails, TimeSourceHash>
-      m_time_sources;
-
-  /** The primary time source in the VDR recording. */
-  TimeSource m_primary_time_source;
-
-  bool m_has_primary_time_source;
+  TimeSourceMap m_time_sources;
 
   opencpn_plugin* m_parent;
   VdrControlGui* m_control_gui;
-
-#ifdef __ANDROID__
-  wxString m_temp_outfile;
-  wxString m_final_outfile;
-#endif
 };
 
 #endif
@@ -0,0 +1,355 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement record_writer.h
+ */
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <climits>
+#include <cstring>
+
+#include "file_path.h"
+#include "record_writer.h"
+#include "std_filesystem.h"
+
+/** Return true if a file exists on path. */
+static bool FileExists(const std::string& path) {
+  std::FILE* f = OpenStdioFile(path, "rb");
+  if (f) std::fclose(f);
+  return f != nullptr;
+}
+
+/**
+ * Return path, or path with a -1, -2, ... suffix before the extension if
+ * it exists. Size based rotation may create several files per second.
+ */
+static std::string UniquePath(const std::string& path) {
+  if (!FileExists(path)) return path;
+  size_t dot = path.rfind('.');
+  const size_t slash = path.find_last_of("/\\");
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    dot = path.size();
+  for (int i = 1;; i++) {
+    std::string unique =
+        path.substr(0, dot) + "-" + std::to_string(i) + path.substr(dot);
+    if (!FileExists(unique)) return unique;
+  }
+}
+
+/** Sync data of a flushed file to disk. @return false on errors. */
+static bool SyncData(std::FILE* file) {
+#if defined(_WIN32)
+  return _commit(_fileno(file)) == 0;
+#elif defined(__APPLE__)
+  return fsync(fileno(file)) == 0;
+#else
+  // Metadata such as modification time is not needed to read the data.
+  return fdatasync(fileno(file)) == 0;
+#endif
+}
+
+/**
+ * Flush, sync to disk and close file.
+ * @return false on errors, including earlier write errors.
+ */
+static bool SyncAndClose(std::FILE* file) {
+  bool ok = std::fflush(file) == 0 && !std::ferror(file);
+  ok = SyncData(file) && ok;
+  return std::fclose(file) == 0 && ok;
+}
+
+/** Write size of synced data to checkpoint file. @return false on errors. */
+static bool WriteCheckpoint(const std::string& path, uint64_t size) {
+  std::FILE* file = OpenStdioFile(path, "wb");
+  if (!file) return false;
+  const std::string data = std::to_string(size) + "\n";
+  bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+  return SyncAndClose(file) && ok;
+}
+
+/** Return size in checkpoint file, 0 if unreadable. */
+static uint64_t ReadCheckpoint(const std::string& path) {
+  std::FILE* file = OpenStdioFile(path, "rb");
+  if (!file) return 0;
+  unsigned long long size = 0;
+  if (std::fscanf(file, "%llu", &size) != 1) size = 0;
+  std::fclose(file);
+  return size;
+}
+
+/**
+ * Return size of file with incomplete data after the last complete line
+ * removed. Data up to checkpoint is known to be synced and kept. After a
+ * power loss, blocks not yet synced may be filled with zeros, so the tail
+ * ends at the first NUL byte. Returns file_size if the file cannot be read.
+ */
+static uint64_t GetRepairedSize(std::FILE* file, uint64_t checkpoint,
+                                uint64_t file_size) {
+  char buffer[64 * 1024];
+  uint64_t offset = checkpoint;
+  uint64_t size = checkpoint;
+  if (checkpoint > static_cast<uint64_t>(LONG_MAX) ||
+      std::fseek(file, static_cast<long>(checkpoint), SEEK_SET) != 0) {
+    return file_size;
+  }
+  for (;;) {
+    const size_t count = std::fread(buffer, 1, sizeof(buffer), file);
+    if (count == 0) return size;
+    const void* nul = std::memchr(buffer, '\0', count);
+    const size_t valid = nul ? static_cast<const char*>(nul) - buffer : count;
+    for (size_t i = valid; i > 0; i--) {
+      if (buffer[i - 1] == '\n') {
+        size = offset + i;
+        break;
+      }
+    }
+    if (nul) return size;
+    offset += count;
+  }
+}
+
+RecordWriter::RecordWriter()
+    : m_has_deadline(false),
+      m_prepared(false),
+      m_rotations(0),
+      m_sync_interval(0),
+      m_busy(false),
+      m_exit(false) {}
+
+RecordWriter::~RecordWriter() {
+  Close();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_exit = true;
+  }
+  m_cv.notify_all();
+  if (m_thread.joinable()) m_thread.join();
+}
+
+void RecordWriter::SetClosedFunc(ClosedFunc closed_func) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_closed_func = std::move(closed_func);
+}
+
+std::vector<RecoveredFile> RecordWriter::Recover(const std::string& dir) {
+  std::vector<RecoveredFile> recovered;
+  const std::string suffix(kCheckpointSuffix);
+  std::error_code ec;
+  std::vector<std::string> checkpoints;
+  for (const auto& entry : fs::directory_iterator(ToFsPath(dir), ec)) {
+    const std::string path = FromFsPath(entry.path());
+    if (path.size() > suffix.size() &&
+        path.compare(path.size() - suffix.size(), suffix.size(), suffix) ==
+            0) {
+      checkpoints.push_back(path);
+    }
+  }
+  for (const auto& checkpoint_path : checkpoints) {
+    const std::string path =
+        checkpoint_path.substr(0, checkpoint_path.size() - suffix.size());
+    uint64_t checkpoint = ReadCheckpoint(checkpoint_path);
+    const uint64_t size = fs::file_size(ToFsPath(path), ec);
+    std::FILE* file = ec ? nullptr : OpenStdioFile(path, "rb");
+    if (file) {
+      if (checkpoint > size) checkpoint = 0;
+      RecoveredFile repaired{path, GetRepairedSize(file, checkpoint, size), 0};
+      std::fclose(file);
+      if (repaired.size < size) {
+        fs::resize_file(ToFsPath(path), repaired.size, ec);
+        repaired.removed = size - repaired.size;
+      }
+      if (!ec) recovered.push_back(repaired);
+    }
+    fs::remove(ToFsPath(checkpoint_path), ec);
+  }
+  return recovered;
+}
+
+void RecordWriter::SetSyncInterval(std::chrono::seconds interval) {
+  m_sync_interval = interval;
+  m_next_sync = Clock::time_point();
+}
+
+void RecordWriter::SetPolicy(const RotationPolicy& policy) {
+  m_policy = policy;
+  if (IsOpen()) SetDeadline(m_start);
+}
+
+void RecordWriter::SetDeadline(Clock::time_point start) {
+  using std::chrono::duration_cast;
+  using std::chrono::seconds;
+  m_start = start;
+  m_has_deadline = m_policy.interval.count() > 0;
+  if (!m_has_deadline) return;
+  if (m_policy.aligned) {
+    // Next multiple of interval, the system clock epoch is 1/1 1970 UTC.
+    const auto now = duration_cast<seconds>(start.time_since_epoch());
+    const auto periods = now / m_policy.interval + 1;
+    m_deadline = Clock::time_point(periods * m_policy.interval);
+  } else {
+    m_deadline = start + m_policy.interval;
+  }
+}
+
+RecordWriter::File RecordWriter::OpenFile(Clock::time_point start) {
+  File file;
+  file.path = UniquePath(m_path_func(start));
+  file.file = OpenStdioFile(file.path, "wb");
+  if (!file.file) return file;
+  std::setvbuf(file.file, nullptr, _IOFBF, kBufferSize);
+  if (std::fwrite(m_header.data(), 1, m_header.size(), file.file) !=
+      m_header.size()) {
+    std::fclose(file.file);
+    std::error_code ec;
+    fs::remove(ToFsPath(file.path), ec);
+    file.file = nullptr;
+    return file;
+  }
+  file.size = m_header.size();
+  return file;
+}
+
+bool RecordWriter::Open(Clock::time_point now) {
+  if (IsOpen()) return true;
+  m_current = OpenFile(now);
+  if (!IsOpen()) return false;
+  m_prepared = false;
+  SetDeadline(now);
+  m_next_sync = Clock::time_point();
+  return true;
+}
+
+void RecordWriter::Rotate(Clock::time_point now) {
+  File next = m_next;
+  m_next = File();
+  if (!next.file) next = OpenFile(now);
+  if (!next.file) return;  // Keep writing to current file.
+  Post(m_current, JobType::kClose);
+  m_current = next;
+  m_prepared = false;
+  SetDeadline(now);
+  m_next_sync = Clock::time_point();
+  m_rotations += 1;
+}
+
+bool RecordWriter::Write(const char* data, size_t len, Clock::time_point now) {
+  if (!IsOpen()) return false;
+  const uint64_t max_bytes = m_policy.max_bytes;
+  // A single write larger than max_bytes still ends up in one file.
+  const bool has_data = m_current.size > m_header.size();
+  if ((has_data && max_bytes > 0 && m_current.size + len > max_bytes) ||
+      (m_has_deadline && now >= m_deadline)) {
+    Rotate(now);
+  } else if (!m_prepared &&
+             ((max_bytes > 0 && m_current.size + max_bytes / 16 >= max_bytes) ||
+              (m_has_deadline && now >= m_deadline - kPrepareLead))) {
+    // Open next file ahead of time, named after when it is expected to be
+    // used.
+    m_next = OpenFile(m_has_deadline && now < m_deadline ? m_deadline : now);
+    m_prepared = true;
+  }
+  m_current.size += len;
+  const bool ok = std::fwrite(data, 1, len, m_current.file) == len;
+  if (m_sync_interval.count() > 0 && now >= m_next_sync) {
+    // Flushing protects against a crash of the application, the sync in
+    // the background also against power loss.
+    if (std::fflush(m_current.file) == 0) Post(m_current, JobType::kSync);
+    m_next_sync = now + m_sync_interval;
+  }
+  return ok;
+}
+
+void RecordWriter::Close() {
+  Post(m_next, JobType::kDiscard);
+  Post(m_current, JobType::kClose);
+  m_has_deadline = false;
+}
+
+void RecordWriter::Post(File& file, JobType type) {
+  if (!file.file) return;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back({file, type, nullptr});
+    if (!m_thread.joinable()) m_thread = std::thread([this] { Work(); });
+  }
+  m_cv.notify_all();
+  if (type != JobType::kSync) file = File();
+}
+
+void RecordWriter::Run(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back({File(), JobType::kTask, std::move(task)});
+    if (!m_thread.joinable()) m_thread = std::thread([this] { Work(); });
+  }
+  m_cv.notify_all();
+}
+
+void RecordWriter::WaitIdle() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cv.wait(lock, [&] { return m_jobs.empty() && !m_busy; });
+}
+
+void RecordWriter::Work() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;) {
+    m_cv.wait(lock, [&] { return !m_jobs.empty() || m_exit; });
+    if (m_jobs.empty()) return;
+    Job job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    m_busy = true;
+    ClosedFunc closed_func = m_closed_func;
+    lock.unlock();
+
+    const std::string checkpoint = job.file.path + kCheckpointSuffix;
+    std::error_code ec;
+    switch (job.type) {
+      case JobType::kDiscard:
+        std::fclose(job.file.file);
+        fs::remove(ToFsPath(job.file.path), ec);
+        break;
+      case JobType::kSync:
+        // The file is written concurrently, but all data up to the size
+        // was flushed before the job was posted.
+        if (SyncData(job.file.file)) {
+          WriteCheckpoint(checkpoint, job.file.size);
+        }
+        break;
+      case JobType::kClose: {
+        const bool ok = SyncAndClose(job.file.file);
+        fs::remove(ToFsPath(checkpoint), ec);
+        if (closed_func) closed_func(job.file.path, ok);
+        break;
+      }
+      case JobType::kTask:
+        job.task();
+        break;
+    }
+
+    lock.lock();
+    m_busy = false;
+    m_cv.notify_all();
+  }
+}
@@ -0,0 +1,223 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Recording file output with size and time based rotation. The next file
+ * is opened before it is needed so that rotation is just a handoff
+ * between two writes, closing the old file is done by a background
+ * thread.
+ *
+ * Optionally, open files are periodically synced to disk together with a
+ * small checkpoint file. A checkpoint left behind after a crash or power
+ * loss is used by RecordWriter::Recover() to repair the file tail.
+ */
+
+#ifndef RECORD_WRITER_H_
+#define RECORD_WRITER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** When RecordWriter starts a new file. */
+struct RotationPolicy {
+  uint64_t max_bytes;             //!< Max file size, 0 means no limit
+  std::chrono::seconds interval;  //!< Max file duration, 0 means no limit
+
+  /**
+   * If true, files are rotated when the UTC time is a multiple of
+   * interval, e.g. on the hour. If false, interval is counted from start
+   * of each file.
+   */
+  bool aligned;
+
+  RotationPolicy() : max_bytes(0), interval(0), aligned(false) {}
+};
+
+/** A recording file repaired by RecordWriter::Recover(). */
+struct RecoveredFile {
+  std::string path;
+  uint64_t size;     //!< Size after repair
+  uint64_t removed;  //!< Bytes of incomplete data removed from the tail
+};
+
+/**
+ * Writes recorded data to a sequence of files according to a
+ * RotationPolicy. Not thread safe, all functions but the callbacks are
+ * invoked in the thread writing data.
+ */
+class RecordWriter {
+public:
+  using Clock = std::chrono::system_clock;
+
+  /** Return path for a new file expected to start at given time. */
+  using PathFunc = std::function<std::string(Clock::time_point start)>;
+
+  /**
+   * Invoked in background thread after a file has been flushed, synced to
+   * disk and closed. ok is false on errors.
+   */
+  using ClosedFunc = std::function<void(const std::string& path, bool ok)>;
+
+  /** Work done by the background thread, see Run(). */
+  using Task = std::function<void()>;
+
+  /** How long before a time based rotation the next file is opened. */
+  static constexpr std::chrono::seconds kPrepareLead{10};
+
+  /** Size of stdio buffer for each file. */
+  static constexpr size_t kBufferSize = 64 * 1024;
+
+  /** Appended to file path to form the path of its checkpoint file. */
+  static constexpr const char* kCheckpointSuffix = ".checkpoint";
+
+  /**
+   * Repair files in dir left unfinished by a crash, as indicated by their
+   * checkpoint files. The tail of each file is truncated to the last
+   * complete line not containing garbage, and the checkpoint is removed.
+   */
+  static std::vector<RecoveredFile> Recover(const std::string& dir);
+
+  RecordWriter();
+
+  /** Close open file and wait for background work to complete. */
+  ~RecordWriter();
+
+  RecordWriter(const RecordWriter&) = delete;
+  RecordWriter& operator=(const RecordWriter&) = delete;
+
+  /** Set rotation policy, also applied to an open file. */
+  void SetPolicy(const RotationPolicy& policy);
+
+  /**
+   * Flush and sync open file to disk at given interval and update its
+   * checkpoint file, 0 disables. Flushing is done by Write(), syncing in
+   * the background thread.
+   */
+  void SetSyncInterval(std::chrono::seconds interval);
+
+  /** Set data written first in each file. Use before Open(). */
+  void SetHeader(const std::string& header) { m_header = header; }
+
+  /** Set function naming new files. Use before Open(). */
+  void SetPathFunc(PathFunc path_func) { m_path_func = std::move(path_func); }
+
+  /** Set handler for closed files. Use before Open(). */
+  void SetClosedFunc(ClosedFunc closed_func);
+
+  /** Open first file. @return false if it cannot be created. */
+  bool Open(Clock::time_point now = Clock::now());
+
+  /** Return true if a file is open. */
+  [[nodiscard]] bool IsOpen() const { return m_current.file != nullptr; }
+
+  /**
+   * Write data to current file, rotating it before the write if due.
+   * @return false on errors.
+   */
+  bool Write(const char* data, size_t len,
+             Clock::time_point now = Clock::now());
+
+  /** Close current file in the background. */
+  void Close();
+
+  /**
+   * Invoke task in the background thread after all work handed to it so
+   * far, e.g. Recover() before any checkpoint of a new file is written.
+   */
+  void Run(Task task);
+
+  /** Wait until all work handed to the background thread is done. */
+  void WaitIdle();
+
+  /** Return path of current file, empty if none. */
+  [[nodiscard]] const std::string& GetPath() const { return m_current.path; }
+
+  /** Return number of rotations since construction. */
+  [[nodiscard]] uint64_t GetRotations() const { return m_rotations; }
+
+private:
+  /** An open output file. */
+  struct File {
+    std::FILE* file;
+    std::string path;
+    uint64_t size;  //!< Bytes written, including header
+
+    File() : file(nullptr), size(0) {}
+  };
+
+  /** Create file for given start time, write header. */
+  File OpenFile(Clock::time_point start);
+
+  /** Make m_next the current file, opening it if needed. */
+  void Rotate(Clock::time_point now);
+
+  /** Compute m_deadline for a file starting at start. */
+  void SetDeadline(Clock::time_point start);
+
+  /** What the background thread does with a file. */
+  enum class JobType {
+    kClose,    //!< Sync and close, invoke ClosedFunc
+    kDiscard,  //!< Close and remove unused file
+    kSync,     //!< Sync and update checkpoint, file stays open
+    kTask      //!< Invoke task, no file
+  };
+
+  /** Hand file to background thread, cleared unless type is kSync. */
+  void Post(File& file, JobType type);
+
+  /** Background thread main loop. */
+  void Work();
+
+  RotationPolicy m_policy;
+  std::string m_header;
+  PathFunc m_path_func;
+  File m_current;
+  File m_next;  //!< Opened ahead of rotation, or not open
+  Clock::time_point m_start;     //!< When m_current was started
+  Clock::time_point m_deadline;  //!< Time based rotation, if m_has_deadline
+  bool m_has_deadline;
+  bool m_prepared;  //!< Opening m_next has been tried
+  uint64_t m_rotations;
+  std::chrono::seconds m_sync_interval;
+  Clock::time_point m_next_sync;
+
+  /** Jobs for m_thread, protected by m_mutex. */
+  struct Job {
+    File file;
+    JobType type;
+    Task task;
+  };
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<Job> m_jobs;
+  bool m_busy;  //!< m_thread is handling a job
+  bool m_exit;
+  ClosedFunc m_closed_func;
+  std::thread m_thread;
+};
+
+#endif  // RECORD_WRITER_H_
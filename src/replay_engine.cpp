@@ -0,0 +1,355 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement replay_engine.h
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <limits>
+
+#include "file_path.h"
+#include "replay_engine.h"
+
+using Clock = ReplayScheduler::Clock;
+
+/** Convert a duration in milliseconds, possibly fractional, to Clock. */
+static Clock::duration FromMillis(double ms) {
+  using namespace std::chrono;
+  return duration_cast<Clock::duration>(duration<double, std::milli>(ms));
+}
+
+static int64_t ToMicros(Clock::time_point time_point) {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(time_point.time_since_epoch()).count();
+}
+
+ReplayScheduler::ReplayScheduler()
+    : m_speed(1.0),
+      m_anchored(false),
+      m_anchor_stamp(0),
+      m_paused(false),
+      m_has_last_due(false),
+      m_untimed(0) {}
+
+void ReplayScheduler::Reset() {
+  m_anchored = false;
+  m_has_last_due = false;
+}
+
+void ReplayScheduler::SetSpeed(double speed, Clock::time_point now) {
+  if (m_anchored) {
+    // Rebase: the timestamp played right now stays the same.
+    const Clock::time_point ref = m_paused ? m_paused_at : now;
+    std::chrono::duration<double, std::milli> played = ref - m_anchor_time;
+    m_anchor_stamp += played.count() * m_speed;
+    m_anchor_time = ref;
+  }
+  m_speed = speed;
+}
+
+void ReplayScheduler::Pause(Clock::time_point now) {
+  if (m_paused) return;
+  m_paused = true;
+  m_paused_at = now;
+}
+
+void ReplayScheduler::Resume(Clock::time_point now) {
+  if (!m_paused) return;
+  m_paused = false;
+  const Clock::duration pause = now - m_paused_at;
+  m_anchor_time += pause;
+  m_last_due += pause;
+}
+
+Clock::time_point ReplayScheduler::GetDueTime(uint64_t stamp,
+                                              Clock::time_point now) {
+  Clock::time_point due;
+  if (stamp == 0) {
+    // The first batch is due right away, or with the last timestamp.
+    if (!m_has_last_due) {
+      due = now;
+      m_untimed = 0;
+    } else if (m_untimed >= kUntimedBatch) {
+      due = m_last_due + FromMillis(kUntimedInterval.count() / m_speed);
+      m_untimed = 0;
+    } else {
+      due = m_last_due;
+    }
+    m_untimed += 1;
+  } else {
+    m_untimed = 0;
+    if (!m_anchored) {
+      m_anchored = true;
+      m_anchor_time = now;
+      m_anchor_stamp = static_cast<double>(stamp);
+    }
+    due = m_anchor_time +
+          FromMillis((static_cast<double>(stamp) - m_anchor_stamp) / m_speed);
+  }
+  m_has_last_due = true;
+  m_last_due = due;
+  return due;
+}
+
+ReplayIndex::ReplayIndex() { Clear(); }
+
+void ReplayIndex::Clear() {
+  m_entries.clear();
+  m_next_offset = 0;
+  m_first_stamp = 0;
+  m_last_stamp = 0;
+  m_chronological = true;
+}
+
+void ReplayIndex::Add(uint64_t stamp, uint64_t offset) {
+  if (m_first_stamp == 0) m_first_stamp = stamp;
+  if (stamp < m_last_stamp) m_chronological = false;
+  m_last_stamp = stamp;
+  if (offset < m_next_offset) return;
+  m_entries.push_back({stamp, offset});
+  m_next_offset = offset + kInterval;
+}
+
+void ReplayIndex::Append(const ReplayIndex& other, uint64_t base) {
+  if (other.m_first_stamp == 0) return;
+  if (m_first_stamp == 0) m_first_stamp = other.m_first_stamp;
+  if (!other.m_chronological || other.m_first_stamp < m_last_stamp) {
+    m_chronological = false;
+  }
+  m_last_stamp = other.m_last_stamp;
+  for (const Entry& entry : other.m_entries) {
+    if (entry.offset + base < m_next_offset) continue;
+    m_entries.push_back({entry.stamp, entry.offset + base});
+    m_next_offset = entry.offset + base + kInterval;
+  }
+}
+
+/** First line of index files, bumped on format changes. */
+static const char* const kIndexMagic = "vdr_pi replay index 1\n";
+
+bool ReplayIndex::Save(const std::string& path, uint64_t size) const {
+  std::FILE* file = OpenStdioFile(path, "w");
+  if (!file) return false;
+  bool ok = std::fputs(kIndexMagic, file) >= 0;
+  ok = ok && std::fprintf(file,
+                          "%" PRIu64 " %" PRIu64 " %" PRIu64 " %d %zu\n",
+                          size, m_first_stamp, m_last_stamp,
+                          m_chronological ? 1 : 0, m_entries.size()) > 0;
+  for (const Entry& entry : m_entries) {
+    if (!ok) break;
+    ok = std::fprintf(file, "%" PRIu64 " %" PRIu64 "\n", entry.stamp,
+                      entry.offset) > 0;
+  }
+  if (std::fclose(file) != 0) ok = false;
+  return ok;
+}
+
+bool ReplayIndex::Load(const std::string& path, uint64_t size) {
+  std::FILE* file = OpenStdioFile(path, "r");
+  if (!file) return false;
+  char magic[64];
+  ReplayIndex index;
+  uint64_t indexed_size;
+  int chronological;
+  size_t entries;
+  bool ok = std::fgets(magic, sizeof(magic), file) &&
+            std::string(magic) == kIndexMagic &&
+            std::fscanf(file,
+                        "%" SCNu64 " %" SCNu64 " %" SCNu64 " %d %zu",
+                        &indexed_size, &index.m_first_stamp,
+                        &index.m_last_stamp, &chronological,
+                        &entries) == 5 &&
+            indexed_size == size;
+  index.m_chronological = chronological != 0;
+  for (size_t i = 0; ok && i < entries; ++i) {
+    Entry entry;
+    ok = std::fscanf(file, "%" SCNu64 " %" SCNu64, &entry.stamp,
+                     &entry.offset) == 2 &&
+         entry.offset >= index.m_next_offset && entry.offset < size;
+    index.m_entries.push_back(entry);
+    index.m_next_offset = entry.offset + kInterval;
+  }
+  std::fclose(file);
+  if (ok) *this = std::move(index);
+  return ok;
+}
+
+uint64_t ReplayIndex::Lookup(uint64_t stamp) const {
+  auto it = std::lower_bound(
+      m_entries.begin(), m_entries.end(), stamp,
+      [](const Entry& entry, uint64_t s) { return entry.stamp < s; });
+  return it == m_entries.begin() ? 0 : (it - 1)->offset;
+}
+
+ReplayEngine::ReplayEngine(std::unique_ptr<ReplayDecoder> decoder,
+                           ReplayFanout& fanout)
+    : m_decoder(std::move(decoder)),
+      m_fanout(fanout),
+      m_index_built(false),
+      m_stats(nullptr),
+      m_state(State::kIdle),
+      m_pending(false),
+      m_due_valid(false),
+      m_position(0),
+      m_current(0),
+      m_max_batch_rows(kDefaultBatchRows),
+      m_max_batch_time(kDefaultBatchTime) {}
+
+bool ReplayEngine::Open() {
+  m_pending = false;
+  m_position = 0;
+  m_scheduler.Reset();
+  if (!m_decoder->Open(0)) {
+    m_state = State::kError;
+    return false;
+  }
+  m_state = State::kIdle;
+  return true;
+}
+
+void ReplayEngine::Start() {
+  if (m_state == State::kPaused) {
+    m_scheduler.Resume(Clock::now());
+    m_due_valid = false;
+  }
+  if (m_state == State::kPaused || m_state == State::kIdle) {
+    m_state = State::kPlaying;
+  }
+}
+
+void ReplayEngine::Pause() {
+  if (m_state != State::kPlaying) return;
+  m_state = State::kPaused;
+  m_scheduler.Pause(Clock::now());
+}
+
+void ReplayEngine::SetSpeed(double speed) {
+  speed = std::min(kMaxSpeed, std::max(kMinSpeed, speed));
+  if (speed == m_scheduler.GetSpeed()) return;
+  m_scheduler.SetSpeed(speed, Clock::now());
+  m_due_valid = false;
+}
+
+void ReplayEngine::SetBatchBudget(unsigned max_rows,
+                                  std::chrono::milliseconds max_time) {
+  m_max_batch_rows = std::max(max_rows, 1u);
+  m_max_batch_time = max_time;
+}
+
+bool ReplayEngine::ReadRecord() {
+  if (!m_decoder->Read(m_record)) {
+    m_position = m_decoder->GetSize();
+    return false;
+  }
+  m_position = m_record.offset;
+  if (m_record.stamp != 0) m_current = m_record.stamp;
+  m_pending = true;
+  m_due_valid = false;
+  return true;
+}
+
+int ReplayEngine::Notify() {
+  using namespace std::chrono;
+  // Clock is only checked against the deadline every few records.
+  constexpr unsigned kTimeCheckInterval = 64;
+
+  if (m_state != State::kPlaying) return -1;
+  const Clock::time_point deadline = Clock::now() + m_max_batch_time;
+  int delay = 0;  // Budget exhausted, still catching up.
+  unsigned sent = 0;
+  while (sent < m_max_batch_rows) {
+    if (!m_pending && !ReadRecord()) {
+      m_state = State::kEof;
+      delay = -1;
+      break;
+    }
+    const Clock::time_point now = Clock::now();
+    if (!m_due_valid) {
+      m_due = m_scheduler.GetDueTime(m_record.stamp, now);
+      m_due_valid = true;
+    }
+    if (m_due > now) {
+      // Round up, waking up early just means another timer round trip.
+      const auto wait = ceil<milliseconds>(m_due - now).count();
+      delay = static_cast<int>(
+          std::min<int64_t>(wait, std::numeric_limits<int>::max()));
+      break;
+    }
+    m_fanout.Publish(m_record.msg);
+    if (m_stats) m_stats->RecordEmission(ToMicros(m_due), ToMicros(now));
+    m_pending = false;
+    sent += 1;
+    if (sent % kTimeCheckInterval == 0 && Clock::now() >= deadline) break;
+  }
+  if (sent > 0) {
+    m_fanout.EndBatch();
+    if (m_stats) m_stats->RecordBatch(sent);
+  }
+  return delay;
+}
+
+bool ReplayEngine::SeekTo(uint64_t offset, uint64_t stamp) {
+  m_pending = false;
+  m_scheduler.Reset();
+  if (!m_decoder->Open(offset)) {
+    m_state = State::kError;
+    return false;
+  }
+  m_position = offset;
+  // Keep position when started, restart timing from here when playing.
+  if (m_state != State::kPlaying) m_state = State::kPaused;
+  while (ReadRecord()) {
+    if (m_record.stamp >= stamp) return true;
+  }
+  m_state = State::kEof;
+  return true;
+}
+
+bool ReplayEngine::SeekToFraction(double fraction) {
+  fraction = std::min(1.0, std::max(0.0, fraction));
+  return SeekTo(static_cast<uint64_t>(fraction * m_decoder->GetSize()), 0);
+}
+
+bool ReplayEngine::SeekToTimestamp(uint64_t stamp) {
+  BuildIndex();
+  return SeekTo(m_index.Lookup(stamp), stamp);
+}
+
+void ReplayEngine::BuildIndex() {
+  if (m_index_built) return;
+  m_index_built = true;
+  m_index.Clear();
+  m_decoder->Scan(
+      [this](uint64_t stamp, uint64_t offset) { m_index.Add(stamp, offset); });
+}
+
+bool ReplayEngine::LoadIndex(const std::string& path) {
+  if (!m_index.Load(path, m_decoder->GetSize())) return false;
+  m_index_built = true;
+  return true;
+}
+
+double ReplayEngine::GetProgressFraction() const {
+  const uint64_t size = m_decoder->GetSize();
+  if (size == 0) return 0;
+  return std::min(1.0, static_cast<double>(m_position) / size);
+}
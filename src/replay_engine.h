@@ -0,0 +1,349 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Format agnostic replay core. A ReplayDecoder turns a recording into
+ * timestamped records, the ReplayEngine schedules them using a
+ * ReplayScheduler and publishes them to a ReplayFanout, whose sinks are
+ * the output modes: internal API, loopback driver, network etc. Seeking
+ * and progress are handled by the engine using a sparse ReplayIndex.
+ */
+
+#ifndef REPLAY_ENGINE_H_
+#define REPLAY_ENGINE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "replay_fanout.h"
+#include "replay_stats.h"
+
+/** A decoded record, as produced by a ReplayDecoder. */
+struct ReplayRecord {
+  uint64_t stamp;     //!< Recorded time, ms since 1/1 1970, 0 if unknown
+  uint64_t offset;    //!< Position in source, see ReplayDecoder::GetSize()
+  ReplayMessage msg;  //!< Message to replay
+
+  ReplayRecord() : stamp(0), offset(0) {}
+};
+
+/**
+ * Recording format decoder. Implementations exist for each supported
+ * format, they are all driven by the same ReplayEngine.
+ */
+class ReplayDecoder {
+public:
+  /** Invoked by Scan() for each record with a timestamp. */
+  using ScanVisitor = std::function<void(uint64_t stamp, uint64_t offset)>;
+
+  virtual ~ReplayDecoder() = default;
+
+  /**
+   * Prepare to read from the first record at offset or later.
+   * @return false on errors, which are reported by the decoder.
+   */
+  virtual bool Open(uint64_t offset) = 0;
+
+  /**
+   * Read next record, reusing the storage in record. Records which cannot
+   * be decoded are reported and skipped.
+   * @return false at end of data.
+   */
+  virtual bool Read(ReplayRecord& record) = 0;
+
+  /** Return size of source, upper limit for ReplayRecord::offset. */
+  [[nodiscard]] virtual uint64_t GetSize() const = 0;
+
+  /**
+   * Invoke visitor for all timestamped records in offset order. Should be
+   * fast, messages do not need to be decoded. Does not affect Read().
+   */
+  virtual void Scan(const ScanVisitor& visitor) = 0;
+};
+
+/**
+ * Map recorded timestamps to wall clock time given a speed multiplier.
+ * Timing is anchored at the first timestamp played and rebased on speed
+ * changes and pauses, so neither causes jumps or catch-up bursts. Records
+ * without timestamp are played in batches at a fixed rate.
+ */
+class ReplayScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /** Number of records without timestamp played at once. */
+  static constexpr unsigned kUntimedBatch = 10;
+
+  /** Interval between batches without timestamp, at speed 1.0. */
+  static constexpr std::chrono::milliseconds kUntimedInterval{1000};
+
+  ReplayScheduler();
+
+  /** Drop timing, next timestamp is played immediately. */
+  void Reset();
+
+  /** Set speed multiplier, keeping the timestamp played at now. */
+  void SetSpeed(double speed, Clock::time_point now);
+
+  [[nodiscard]] double GetSpeed() const { return m_speed; }
+
+  /** Stop the clock. */
+  void Pause(Clock::time_point now);
+
+  /** Restart the clock where Pause() stopped it. */
+  void Resume(Clock::time_point now);
+
+  /**
+   * Return when record with given timestamp should be played, anchoring
+   * the timing if required.
+   * @param stamp Recorded time, ms since 1/1 1970 or 0 if unknown.
+   * @param now Current time.
+   */
+  Clock::time_point GetDueTime(uint64_t stamp, Clock::time_point now);
+
+private:
+  double m_speed;
+  bool m_anchored;               //!< m_anchor_* is valid
+  Clock::time_point m_anchor_time;
+  double m_anchor_stamp;         //!< ms timestamp played at m_anchor_time
+  bool m_paused;
+  Clock::time_point m_paused_at;
+  bool m_has_last_due;
+  Clock::time_point m_last_due;  //!< Last computed due time
+  unsigned m_untimed;            //!< Untimed records due at m_last_due
+};
+
+/**
+ * Sparse timestamp to offset index, one entry per kInterval units of
+ * offset. Timestamps are expected to be mostly increasing.
+ *
+ * An index can be saved as a sidecar file next to the recording, see
+ * GetPath(). Recordings converted offline come with one, so they are
+ * played and seeked without scanning them first.
+ */
+class ReplayIndex {
+public:
+  static constexpr uint64_t kInterval = 64 * 1024;
+
+  /** Return path to sidecar index file for recording. */
+  static std::string GetPath(const std::string& recording) {
+    return recording + ".idx";
+  }
+
+  ReplayIndex();
+
+  void Clear();
+
+  /** Add a record, entries are added in offset order. */
+  void Add(uint64_t stamp, uint64_t offset);
+
+  /**
+   * Add all records in other, which are located after the ones already
+   * added. Offsets in other are relative to base.
+   */
+  void Append(const ReplayIndex& other, uint64_t base);
+
+  /**
+   * Write index to path.
+   * @param size Size of indexed source, checked by Load().
+   * @return false on errors.
+   */
+  bool Save(const std::string& path, uint64_t size) const;
+
+  /**
+   * Read index written by Save(), index is unchanged on errors.
+   * @param size Size of indexed source.
+   * @return false if the index cannot be read or describes another source.
+   */
+  bool Load(const std::string& path, uint64_t size);
+
+  /**
+   * Return offset of an indexed record with timestamp before stamp, or 0.
+   * Reading from there finds the first record with timestamp >= stamp.
+   */
+  [[nodiscard]] uint64_t Lookup(uint64_t stamp) const;
+
+  /** Return first timestamp added, 0 if none. */
+  [[nodiscard]] uint64_t GetFirstStamp() const { return m_first_stamp; }
+
+  /** Return last timestamp added, 0 if none. */
+  [[nodiscard]] uint64_t GetLastStamp() const { return m_last_stamp; }
+
+  /** Return false if any timestamp added is before the previous one. */
+  [[nodiscard]] bool IsChronological() const { return m_chronological; }
+
+  [[nodiscard]] size_t GetSize() const { return m_entries.size(); }
+
+private:
+  struct Entry {
+    uint64_t stamp;
+    uint64_t offset;
+  };
+  std::vector<Entry> m_entries;
+  uint64_t m_next_offset;  //!< Add next entry at this offset or later
+  uint64_t m_first_stamp;
+  uint64_t m_last_stamp;
+  bool m_chronological;
+};
+
+/**
+ * Replay a recording decoded by a ReplayDecoder. Driven by a one-shot timer
+ * which is restarted using the value returned by Notify().
+ */
+class ReplayEngine {
+public:
+  /** Default max number of records sent by Notify(). */
+  static constexpr unsigned kDefaultBatchRows = 1000;
+
+  /** Default max time spent in Notify(). */
+  static constexpr std::chrono::milliseconds kDefaultBatchTime{20};
+
+  /** Speed range accepted by SetSpeed(), as the GUI speed slider. */
+  static constexpr double kMinSpeed = 1.0;
+  static constexpr double kMaxSpeed = 1000.0;
+
+  /**
+   * @param decoder Recording decoder, not yet opened.
+   * @param fanout Destination for replayed messages, must outlive engine.
+   */
+  ReplayEngine(std::unique_ptr<ReplayDecoder> decoder, ReplayFanout& fanout);
+
+  ReplayEngine(const ReplayEngine&) = delete;
+  ReplayEngine& operator=(const ReplayEngine&) = delete;
+
+  /** Open decoder at start, return false on errors. */
+  bool Open();
+
+  /** Start or resume playing. */
+  void Start();
+
+  /** Pause playing, timing is rebased by Start(). */
+  void Pause();
+
+  /** Set speed multiplier, limited to kMinSpeed..kMaxSpeed. */
+  void SetSpeed(double speed);
+
+  /**
+   * Limit the work done in a single Notify() call, keeping the GUI
+   * responsive while catching up.
+   * @param max_rows Max number of records sent.
+   * @param max_time Max time spent, checked every few records.
+   */
+  void SetBatchBudget(unsigned max_rows, std::chrono::milliseconds max_time);
+
+  /** Record timing statistics in stats, which must outlive engine. */
+  void SetStats(ReplayStats* stats) { m_stats = stats; }
+
+  /**
+   * Send all records which are due within the limits set by
+   * SetBatchBudget().
+   * @return Milliseconds to next record. Value < 0 means there is nothing
+   *    more to send. Value == 0 indicates that we are catching up, the
+   *    budget was exhausted before all due records were sent.
+   */
+  int Notify();
+
+  /**
+   * Move play position to the first record at given fraction of the
+   * source size or later.
+   * @return false on errors.
+   */
+  bool SeekToFraction(double fraction);
+
+  /**
+   * Move play position to the first record with timestamp >= stamp.
+   * @param stamp Milliseconds since 1/1 1970.
+   * @return false on errors.
+   */
+  bool SeekToTimestamp(uint64_t stamp);
+
+  /** Scan decoder and build the seek index unless already done. */
+  void BuildIndex();
+
+  /**
+   * Use sidecar index at path instead of BuildIndex().
+   * @return false if path is not a valid index for the source.
+   */
+  bool LoadIndex(const std::string& path);
+
+  [[nodiscard]] bool IsPlaying() const { return m_state == State::kPlaying; }
+
+  [[nodiscard]] bool IsPaused() const { return m_state == State::kPaused; }
+
+  [[nodiscard]] bool IsAtEnd() const { return m_state == State::kEof; }
+
+  [[nodiscard]] bool IsError() const { return m_state == State::kError; }
+
+  [[nodiscard]] bool IsIdle() const { return m_state == State::kIdle; }
+
+  /** Return how much of current source is played, between 0 and 1. */
+  [[nodiscard]] double GetProgressFraction() const;
+
+  /** Return last timestamp read, ms since 1/1 1970, 0 if none. */
+  [[nodiscard]] uint64_t GetCurrentTimestamp() const { return m_current; }
+
+  /** Return first timestamp in source from BuildIndex(), 0 if unknown. */
+  [[nodiscard]] uint64_t GetFirstTimestamp() const {
+    return m_index.GetFirstStamp();
+  }
+
+  /** Return last timestamp in source from BuildIndex(), 0 if unknown. */
+  [[nodiscard]] uint64_t GetLastTimestamp() const {
+    return m_index.GetLastStamp();
+  }
+
+  /** Return false if source timestamps from BuildIndex() are unordered. */
+  [[nodiscard]] bool IsChronological() const {
+    return m_index.IsChronological();
+  }
+
+private:
+  enum class State { kIdle, kPlaying, kPaused, kEof, kError };
+
+  /**
+   * Open decoder at offset and make first record with timestamp >= stamp
+   * the next one to play.
+   */
+  bool SeekTo(uint64_t offset, uint64_t stamp);
+
+  /** Read next record into m_record, update position and timestamp. */
+  bool ReadRecord();
+
+  std::unique_ptr<ReplayDecoder> m_decoder;
+  ReplayFanout& m_fanout;
+  ReplayScheduler m_scheduler;
+  ReplayIndex m_index;
+  bool m_index_built;
+  ReplayStats* m_stats;
+  State m_state;
+  ReplayRecord m_record;    //!< Next record to play if m_pending
+  bool m_pending;           //!< m_record is read but not sent
+  bool m_due_valid;         //!< m_due is computed
+  ReplayScheduler::Clock::time_point m_due;  //!< When to send m_record
+  uint64_t m_position;      //!< Offset of current record
+  uint64_t m_current;       //!< Current timestamp
+  unsigned m_max_batch_rows;
+  std::chrono::milliseconds m_max_batch_time;
+};
+
+#endif  // REPLAY_ENGINE_H_
@@ -0,0 +1,169 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement replay_fanout.h
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "replay_fanout.h"
+
+static bool StartsWith(const char* line, size_t length, const char* prefix) {
+  const size_t prefix_len = std::strlen(prefix);
+  return length >= prefix_len && std::strncmp(line, prefix, prefix_len) == 0;
+}
+
+void ParseReplayLine(const char* line, size_t length, ReplayMessage& msg) {
+  msg.text.assign(line, length);
+  msg.has_n2k = false;
+  msg.source.clear();
+  msg.msg_type.clear();
+  if (length > 0 && line[0] == '{') {
+    msg.type = ReplayMsgType::kSignalK;
+  } else if (StartsWith(line, length, "$PCDIN")) {
+    msg.type = ReplayMsgType::kN2k;
+    msg.has_n2k = ParsePcdin(line, length, msg.n2k);
+  } else if (StartsWith(line, length, "$MXPGN") ||
+             StartsWith(line, length, "$YDRAW")) {
+    msg.type = ReplayMsgType::kN2k;
+  } else {
+    msg.type = ReplayMsgType::kNmea0183;
+  }
+}
+
+ReplayFanout::ReplayFanout(size_t capacity)
+    : m_capacity(std::max(capacity, kMinCapacity)),
+      m_ring(m_capacity),
+      m_head(0),
+      m_stopping(false),
+      m_max_latency(0),
+      m_stopped_dropped(0) {}
+
+ReplayFanout::~ReplayFanout() { Clear(); }
+
+void ReplayFanout::AddSink(const std::shared_ptr<ReplaySink>& sink) {
+  if (!sink->IsThreaded()) {
+    m_inline_sinks.push_back(sink);
+    return;
+  }
+  auto consumer = std::make_unique<Consumer>();
+  consumer->sink = sink;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = false;
+    consumer->cursor = m_head;
+  }
+  Consumer* c = consumer.get();
+  consumer->thread = std::thread([this, c] { Consume(c); });
+  m_consumers.push_back(std::move(consumer));
+}
+
+void ReplayFanout::SetMaxLatency(std::chrono::milliseconds latency) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_latency = latency;
+  }
+  m_cv.notify_all();
+}
+
+void ReplayFanout::Publish(const ReplayMessage& msg) {
+  for (auto& sink : m_inline_sinks) sink->Deliver(msg);
+  if (m_consumers.empty()) return;
+
+  bool wake = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ring[m_head % m_capacity] = msg;
+    m_head += 1;
+    // Long batches: let consumers start before the ring wraps.
+    wake = m_head % (m_capacity / 4) == 0;
+  }
+  if (wake) m_cv.notify_all();
+}
+
+void ReplayFanout::EndBatch() {
+  for (auto& sink : m_inline_sinks) sink->Flush();
+  if (!m_consumers.empty()) m_cv.notify_all();
+}
+
+void ReplayFanout::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_cv.notify_all();
+  for (auto& consumer : m_consumers) {
+    if (consumer->thread.joinable()) consumer->thread.join();
+    m_stopped_dropped += consumer->sink->GetDropped();
+  }
+  m_consumers.clear();
+}
+
+void ReplayFanout::Clear() {
+  Stop();
+  for (const auto& sink : m_inline_sinks) {
+    m_stopped_dropped += sink->GetDropped();
+  }
+  m_inline_sinks.clear();
+}
+
+uint64_t ReplayFanout::GetDropped() const {
+  uint64_t dropped = m_stopped_dropped;
+  for (const auto& sink : m_inline_sinks) dropped += sink->GetDropped();
+  for (const auto& consumer : m_consumers) {
+    dropped += consumer->sink->GetDropped();
+  }
+  return dropped;
+}
+
+void ReplayFanout::Consume(Consumer* consumer) {
+  std::vector<ReplayMessage> batch(kConsumerBatch);
+  while (true) {
+    size_t count = 0;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      auto ready = [&] { return m_stopping || consumer->cursor != m_head; };
+      if (m_max_latency.count() > 0) {
+        // Poll: collects messages published during the interval into one
+        // batch without a wake-up per message.
+        m_cv.wait_for(lock, m_max_latency, [&] { return m_stopping; });
+        if (!ready()) continue;
+      } else {
+        m_cv.wait(lock, ready);
+      }
+      if (consumer->cursor == m_head) break;  // Stopping and drained
+      if (m_head - consumer->cursor > m_capacity) {
+        const uint64_t oldest = m_head - m_capacity;
+        consumer->sink->AddDropped(oldest - consumer->cursor);
+        consumer->cursor = oldest;
+      }
+      count = static_cast<size_t>(
+          std::min<uint64_t>(m_head - consumer->cursor, kConsumerBatch));
+      for (size_t i = 0; i < count; i++) {
+        batch[i] = m_ring[(consumer->cursor + i) % m_capacity];
+      }
+      consumer->cursor += count;
+    }
+    // Deliver outside the lock, the producer is never blocked by a sink.
+    for (size_t i = 0; i < count; i++) consumer->sink->Deliver(batch[i]);
+    consumer->sink->Flush();
+  }
+}
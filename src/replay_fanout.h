@@ -0,0 +1,186 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Distribution of replayed messages to a set of output sinks. Messages are
+ * parsed once by the producer and written to a broadcast ring buffer. Each
+ * threaded sink reads the ring on its own consumer thread, so a slow sink
+ * cannot delay the scheduler or the other sinks.
+ */
+
+#ifndef REPLAY_FANOUT_H_
+#define REPLAY_FANOUT_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "n2k_encoder.h"
+
+/** Kind of replayed message, decided once when the line is read. */
+enum class ReplayMsgType {
+  kNmea0183,  //!< NMEA 0183 or AIS sentence, or other text
+  kN2k,       //!< NMEA 2000, text ($PCDIN etc.) and/or decoded message
+  kSignalK    //!< Signal K delta, compact JSON
+};
+
+/** A replayed message, as delivered to all sinks. */
+struct ReplayMessage {
+  ReplayMsgType type;
+  std::string text;      //!< Recorded text without line ending, may be empty
+  bool has_n2k;          //!< True if n2k holds a decoded message
+  N2kMessage n2k;        //!< Decoded NMEA 2000 message
+  std::string source;    //!< Data Monitor source column, else empty
+  std::string msg_type;  //!< Data Monitor msg_type column, else empty
+
+  ReplayMessage() : type(ReplayMsgType::kNmea0183), has_n2k(false) {}
+};
+
+/**
+ * Classify and decode a recorded line into msg. Reuses the storage in msg.
+ * @param line Recorded line, UTF-8, without line ending.
+ * @param length Length of line.
+ * @param msg Updated message.
+ */
+void ParseReplayLine(const char* line, size_t length, ReplayMessage& msg);
+
+/** Output destination for replayed messages. */
+class ReplaySink {
+public:
+  virtual ~ReplaySink() = default;
+
+  /** Short name used in logs. */
+  [[nodiscard]] virtual const char* GetName() const = 0;
+
+  /**
+   * Return true if the sink runs on a consumer thread of its own, false if
+   * Deliver() and Flush() are invoked directly on the producer thread.
+   */
+  [[nodiscard]] virtual bool IsThreaded() const { return true; }
+
+  /** Handle a single message. */
+  virtual void Deliver(const ReplayMessage& msg) = 0;
+
+  /** End of a batch of messages, a good time to write buffered output. */
+  virtual void Flush() {}
+
+  /** Number of messages overwritten in the ring before this sink read them. */
+  [[nodiscard]] uint64_t GetDropped() const { return m_dropped; }
+
+  void AddDropped(uint64_t count) { m_dropped += count; }
+
+private:
+  std::atomic<uint64_t> m_dropped{0};
+};
+
+/**
+ * Single producer, multiple consumer broadcast of replayed messages.
+ *
+ * Publish() copies the message into a fixed size ring; slots and the
+ * strings within are reused so steady state operation does not allocate.
+ * The producer never waits for consumers. A consumer which falls more than
+ * the ring capacity behind skips the overwritten messages, which are
+ * counted as dropped for that sink.
+ */
+class ReplayFanout {
+public:
+  static constexpr size_t kDefaultCapacity = 4096;
+
+  /** Smaller capacities are rounded up to this. */
+  static constexpr size_t kMinCapacity = 4;
+
+  explicit ReplayFanout(size_t capacity = kDefaultCapacity);
+
+  ~ReplayFanout();
+
+  ReplayFanout(const ReplayFanout&) = delete;
+  ReplayFanout& operator=(const ReplayFanout&) = delete;
+
+  /**
+   * Add a sink. Threaded sinks start consuming on a new thread with the
+   * next published message.
+   */
+  void AddSink(const std::shared_ptr<ReplaySink>& sink);
+
+  /**
+   * Set max time a published message may wait in the ring before consumer
+   * threads pick it up without an EndBatch(). Used for live data which has
+   * no batches. Zero, the default, waits for EndBatch().
+   */
+  void SetMaxLatency(std::chrono::milliseconds latency);
+
+  /** Deliver message to all sinks. Never blocks on a sink. */
+  void Publish(const ReplayMessage& msg);
+
+  /** End current batch: flush inline sinks and wake up consumer threads. */
+  void EndBatch();
+
+  /**
+   * Let consumer threads drain the ring, join them and remove threaded
+   * sinks. Inline sinks are kept, so pending output can still be flushed.
+   */
+  void Stop();
+
+  /** Stop() and remove all sinks. */
+  void Clear();
+
+  /**
+   * Return number of messages dropped by all sinks, including removed
+   * sinks, since construction.
+   */
+  [[nodiscard]] uint64_t GetDropped() const;
+
+  /** Return true if there is at least one sink. */
+  [[nodiscard]] bool HasSinks() const {
+    return !m_inline_sinks.empty() || !m_consumers.empty();
+  }
+
+private:
+  struct Consumer {
+    std::shared_ptr<ReplaySink> sink;
+    uint64_t cursor;  //!< Next sequence number to read, guarded by m_mutex
+    std::thread thread;
+  };
+
+  /** Consumer thread body. */
+  void Consume(Consumer* consumer);
+
+  /** Max messages copied out of the ring per consumer wake-up. */
+  static constexpr size_t kConsumerBatch = 256;
+
+  const size_t m_capacity;
+  std::vector<ReplayMessage> m_ring;
+  uint64_t m_head;  //!< Sequence number of next message, guarded by m_mutex
+  bool m_stopping;  //!< Guarded by m_mutex
+  std::chrono::milliseconds m_max_latency;  //!< Guarded by m_mutex
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<std::shared_ptr<ReplaySink>> m_inline_sinks;
+  std::vector<std::unique_ptr<Consumer>> m_consumers;
+  uint64_t m_stopped_dropped;  //!< Dropped by removed sinks
+};
+
+#endif  // REPLAY_FANOUT_H_
@@ -0,0 +1,179 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement replay_sinks.h
+ */
+
+#include <chrono>
+
+#include <wx/log.h>
+
+#include "ocpn_plugin.h"
+#include "replay_sinks.h"
+
+/** Buffered network output is written when exceeding this size. */
+static constexpr size_t kMaxPendingBytes = 64 * 1024;
+
+/**
+ * Max UDP batch size, the payload of an unfragmented datagram on Ethernet.
+ * Larger single messages are still sent, one per datagram.
+ */
+static constexpr size_t kMaxDatagramBytes = 1472;
+
+/** Milliseconds since midnight UTC, used as YD RAW timestamp. */
+static uint32_t MsOfDayUtc() {
+  using namespace std::chrono;
+  auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+  return static_cast<uint32_t>(ms.count() % (24 * 3600 * 1000));
+}
+
+InternalApiSink::InternalApiSink(size_t max_buffered)
+    : m_max_buffered(max_buffered), m_dropping(false) {}
+
+void InternalApiSink::Deliver(const ReplayMessage& msg) {
+  // Signal K and binary only NMEA 2000 data cannot be pushed as NMEA.
+  if (msg.type == ReplayMsgType::kSignalK || msg.text.empty()) return;
+  m_buffer.push_back(wxString::FromUTF8(msg.text.data(), msg.text.size()));
+  if (m_buffer.size() > m_max_buffered) {
+    if (!m_dropping) {
+      wxLogMessage("Playback dropping messages to maintain timing");
+      m_dropping = true;
+    }
+    m_buffer.pop_front();
+    AddDropped(1);
+  }
+}
+
+void InternalApiSink::Flush() {
+  for (const auto& sentence : m_buffer) {
+    PushNMEABuffer(sentence + "\r\n");
+  }
+  m_buffer.clear();
+}
+
+NetworkSink::NetworkSink(const char* name, VdrNetworkServer* server,
+                         ReplayMsgType type)
+    : m_name(name), m_server(server), m_type(type) {
+  m_out.reserve(kMaxPendingBytes);
+}
+
+void NetworkSink::Deliver(const ReplayMessage& msg) {
+  if (msg.type != m_type || msg.text.empty()) return;
+  if (m_type == ReplayMsgType::kNmea0183 && msg.text[0] != '$' &&
+      msg.text[0] != '!') {
+    return;
+  }
+  const size_t begin = m_out.size();
+  AppendLine(msg.text);
+  EndMessage(begin);
+}
+
+void NetworkSink::Flush() {
+  if (m_out.empty()) return;
+  if (m_server->IsRunning()) m_server->SendBinary(m_out.data(), m_out.size());
+  m_out.clear();
+}
+
+void NetworkSink::AppendLine(const std::string& text) {
+  m_out.append(text);
+  m_out.append("\r\n");
+}
+
+void NetworkSink::EndMessage(size_t begin) {
+  if (m_server->IsTCP()) {
+    if (m_out.size() >= kMaxPendingBytes) Flush();
+    return;
+  }
+  if (m_out.size() <= kMaxDatagramBytes) return;
+  if (begin > 0) {
+    // Send what fits in a datagram, keep the message for the next one.
+    if (m_server->IsRunning()) m_server->SendBinary(m_out.data(), begin);
+    m_out.erase(0, begin);
+  }
+  if (m_out.size() > kMaxDatagramBytes) Flush();
+}
+
+N2kNetworkSink::N2kNetworkSink(VdrNetworkServer* server, N2kNetFormat format,
+                               bool forward_ais)
+    : NetworkSink("N2K", server, ReplayMsgType::kN2k),
+      m_format(format),
+      m_forward_ais(forward_ais),
+      m_encoder(format) {}
+
+void N2kNetworkSink::Deliver(const ReplayMessage& msg) {
+  const size_t begin = m_out.size();
+  if (msg.type == ReplayMsgType::kNmea0183) {
+    // Actisense ASCII. Dropped by other formats, text would corrupt them.
+    if (m_forward_ais && m_format == N2kNetFormat::kText &&
+        msg.text.rfind("!AIVDM", 0) == 0) {
+      AppendLine(msg.text);
+    }
+  } else if (msg.type == ReplayMsgType::kN2k) {
+    if (m_format != N2kNetFormat::kText && msg.has_n2k) {
+      const std::vector<uint8_t>& bytes =
+          m_encoder.Encode(msg.n2k, MsOfDayUtc());
+      m_out.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    } else if (!msg.text.empty()) {
+      // Formats which cannot be decoded are forwarded as is.
+      AppendLine(msg.text);
+    } else if (msg.has_n2k) {
+      AppendPcdin(msg.n2k, m_out);
+      m_out.append("\r\n");
+    }
+  }
+  EndMessage(begin);
+}
+
+FileExportSink::FileExportSink(const wxString& path) {
+  if (!m_file.Open(path, wxFile::write)) {
+    wxLogWarning("Cannot open replay export file %s", path);
+  }
+  m_out.reserve(kMaxPendingBytes);
+}
+
+void FileExportSink::Deliver(const ReplayMessage& msg) {
+  if (!m_file.IsOpened()) return;
+  if (!msg.text.empty()) {
+    m_out.append(msg.text);
+  } else if (msg.has_n2k) {
+    AppendPcdin(msg.n2k, m_out);
+  } else {
+    return;
+  }
+  m_out.append("\r\n");
+  if (m_out.size() >= kMaxPendingBytes) Flush();
+}
+
+void FileExportSink::Flush() {
+  if (m_out.empty()) return;
+  m_file.Write(m_out.data(), m_out.size());
+  m_out.clear();
+}
+
+StatsSink::StatsSink() {
+  for (auto& count : m_messages) count = 0;
+  for (auto& count : m_bytes) count = 0;
+}
+
+void StatsSink::Deliver(const ReplayMessage& msg) {
+  const auto idx = static_cast<size_t>(msg.type);
+  m_messages[idx].fetch_add(1, std::memory_order_relaxed);
+  m_bytes[idx].fetch_add(msg.text.size(), std::memory_order_relaxed);
+}
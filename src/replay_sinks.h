@@ -0,0 +1,166 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * ReplaySink implementations: OpenCPN internal API, network servers, file
+ * re-export and message statistics.
+ */
+
+#ifndef REPLAY_SINKS_H_
+#define REPLAY_SINKS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include <wx/file.h>
+#include <wx/string.h>
+
+#include "commons.h"
+#include "n2k_encoder.h"
+#include "replay_fanout.h"
+#include "vdr_network.h"
+
+/**
+ * Push NMEA text to OpenCPN using PushNMEABuffer(). The plugin API must be
+ * used from the main thread, so this sink is not threaded: messages are
+ * buffered by Deliver() and pushed by Flush() when the batch ends.
+ */
+class InternalApiSink : public ReplaySink {
+public:
+  /**
+   * @param max_buffered Max sentences kept until Flush(), older sentences
+   *     are dropped to maintain playback timing.
+   */
+  explicit InternalApiSink(size_t max_buffered);
+
+  [[nodiscard]] const char* GetName() const override { return "internal"; }
+
+  [[nodiscard]] bool IsThreaded() const override { return false; }
+
+  void Deliver(const ReplayMessage& msg) override;
+
+  void Flush() override;
+
+private:
+  const size_t m_max_buffered;
+  std::deque<wxString> m_buffer;
+  bool m_dropping;  //!< Drop message logged
+};
+
+/**
+ * Write messages of one type to a VdrNetworkServer. Output is collected in
+ * a reusable buffer and handed to the server once per batch, the server
+ * writes it to the sockets on the main thread. A UDP server sends each
+ * batch as a single datagram, so UDP batches are kept within the MTU.
+ */
+class NetworkSink : public ReplaySink {
+public:
+  NetworkSink(const char* name, VdrNetworkServer* server, ReplayMsgType type);
+
+  [[nodiscard]] const char* GetName() const override { return m_name; }
+
+  void Deliver(const ReplayMessage& msg) override;
+
+  void Flush() override;
+
+protected:
+  /** Append text and line ending to output buffer. */
+  void AppendLine(const std::string& text);
+
+  /**
+   * Write buffered output if it grows beyond a limit, invoked after each
+   * message. Messages are never split between writes.
+   * @param begin Output buffer size before the message was appended.
+   */
+  void EndMessage(size_t begin);
+
+  const char* const m_name;
+  VdrNetworkServer* const m_server;
+  const ReplayMsgType m_type;
+  std::string m_out;  //!< Pending output, capacity is reused
+};
+
+/**
+ * NMEA 2000 network output. Messages are sent as recorded or encoded into a
+ * binary gateway framing, see N2kNetFormat.
+ */
+class N2kNetworkSink : public NetworkSink {
+public:
+  /**
+   * @param format Output framing.
+   * @param forward_ais Also forward !AIVDM sentences, used when the NMEA
+   *     0183 server is disabled. Only done by the kText format, text lines
+   *     would break the framing of the binary and YD RAW formats.
+   */
+  N2kNetworkSink(VdrNetworkServer* server, N2kNetFormat format,
+                 bool forward_ais);
+
+  void Deliver(const ReplayMessage& msg) override;
+
+private:
+  const N2kNetFormat m_format;
+  const bool m_forward_ais;
+  N2kEncoder m_encoder;
+};
+
+/** Write replayed messages as text lines to a file. */
+class FileExportSink : public ReplaySink {
+public:
+  explicit FileExportSink(const wxString& path);
+
+  [[nodiscard]] const char* GetName() const override { return "export"; }
+
+  [[nodiscard]] bool IsOk() const { return m_file.IsOpened(); }
+
+  void Deliver(const ReplayMessage& msg) override;
+
+  void Flush() override;
+
+private:
+  wxFile m_file;
+  std::string m_out;
+};
+
+/** Count replayed messages and bytes per message type. */
+class StatsSink : public ReplaySink {
+public:
+  StatsSink();
+
+  [[nodiscard]] const char* GetName() const override { return "stats"; }
+
+  void Deliver(const ReplayMessage& msg) override;
+
+  [[nodiscard]] uint64_t GetMessages(ReplayMsgType type) const {
+    return m_messages[static_cast<size_t>(type)];
+  }
+
+  [[nodiscard]] uint64_t GetBytes(ReplayMsgType type) const {
+    return m_bytes[static_cast<size_t>(type)];
+  }
+
+private:
+  static constexpr size_t kTypeCount = 3;
+  std::array<std::atomic<uint64_t>, kTypeCount> m_messages;
+  std::array<std::atomic<uint64_t>, kTypeCount> m_bytes;
+};
+
+#endif  // REPLAY_SINKS_H_
@@ -0,0 +1,179 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement replay_stats.h
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#include "replay_stats.h"
+
+/** Return index of most significant bit set, value must be non-zero. */
+static unsigned MostSignificantBit(uint64_t value) {
+  unsigned msb = 0;
+  for (unsigned shift = 32; shift > 0; shift /= 2) {
+    if (value >> shift) {
+      value >>= shift;
+      msb += shift;
+    }
+  }
+  return msb;
+}
+
+/** Append printf style formatted text. */
+template <typename... Args>
+static void Append(std::string& out, const char* format, Args... args) {
+  char buf[128];
+  int len = std::snprintf(buf, sizeof(buf), format, args...);
+  if (len > 0) out.append(buf, std::min<size_t>(len, sizeof(buf) - 1));
+}
+
+LatencyHistogram::LatencyHistogram() { Reset(); }
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < kSubBuckets) return static_cast<size_t>(value);
+  const unsigned exponent = MostSignificantBit(value) - kSubBucketBits + 1;
+  return exponent * (kSubBuckets / 2) + static_cast<size_t>(value >> exponent);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+  if (index < kSubBuckets) return index;
+  const auto exponent = static_cast<unsigned>(index / (kSubBuckets / 2)) - 1;
+  const uint64_t sub = index % (kSubBuckets / 2) + kSubBuckets / 2;
+  return (sub << exponent) | ((uint64_t(1) << exponent) - 1);
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+  m_buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_sum.fetch_add(value, std::memory_order_relaxed);
+  uint64_t max = m_max.load(std::memory_order_relaxed);
+  while (value > max &&
+         !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& bucket : m_buckets) bucket = 0;
+  m_count = 0;
+  m_sum = 0;
+  m_max = 0;
+}
+
+uint64_t LatencyHistogram::GetMean() const {
+  const uint64_t count = m_count;
+  return count > 0 ? m_sum / count : 0;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const {
+  const uint64_t count = m_count;
+  if (count == 0) return 0;
+  percentile = std::min(100.0, std::max(0.0, percentile));
+  auto rank = static_cast<uint64_t>(percentile / 100.0 * count + 0.5);
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBucketCount; i++) {
+    seen += m_buckets[i].load(std::memory_order_relaxed);
+    if (seen >= rank) return std::min<uint64_t>(BucketUpperBound(i), m_max);
+  }
+  return m_max;
+}
+
+void LatencyHistogram::AppendJson(std::string& out) const {
+  Append(out,
+         "{\"count\":%" PRIu64 ",\"mean\":%" PRIu64 ",\"max\":%" PRIu64
+         ",\"p50\":%" PRIu64 ",\"p90\":%" PRIu64 ",\"p99\":%" PRIu64
+         ",\"p999\":%" PRIu64 ",\"buckets\":[",
+         GetCount(), GetMean(), GetMax(), GetPercentile(50),
+         GetPercentile(90), GetPercentile(99), GetPercentile(99.9));
+  bool first = true;
+  for (size_t i = 0; i < kBucketCount; i++) {
+    const uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+    if (count == 0) continue;
+    Append(out, "%s[%" PRIu64 ",%" PRIu64 "]", first ? "" : ",",
+           BucketUpperBound(i), count);
+    first = false;
+  }
+  out.append("]}");
+}
+
+ReplayStats::ReplayStats() : m_early(0), m_dropped(0) {}
+
+void ReplayStats::RecordEmission(int64_t scheduled_us, int64_t emit_us) {
+  if (emit_us < scheduled_us) {
+    m_early.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    m_lateness_us.Record(static_cast<uint64_t>(emit_us - scheduled_us));
+  }
+}
+
+void ReplayStats::RecordTimerJitter(int64_t late_us) {
+  m_timer_jitter_us.Record(
+      static_cast<uint64_t>(std::max<int64_t>(late_us, 0)));
+}
+
+void ReplayStats::Reset() {
+  m_lateness_us.Reset();
+  m_batch_size.Reset();
+  m_timer_jitter_us.Reset();
+  m_early = 0;
+  m_dropped = 0;
+}
+
+std::string ReplayStats::ToJson(int speed) const {
+  // Integers only, the output does not depend on the locale.
+  std::string out;
+  Append(out, "{\"speed\":%d,\"lateness_us\":", speed);
+  m_lateness_us.AppendJson(out);
+  out.append(",\"batch_size\":");
+  m_batch_size.AppendJson(out);
+  out.append(",\"timer_jitter_us\":");
+  m_timer_jitter_us.AppendJson(out);
+  Append(out, ",\"early\":%" PRIu64 ",\"dropped\":%" PRIu64 "}",
+         GetEarly(), GetDropped());
+  return out;
+}
+
+std::string ReplayStats::FormatSummary() const {
+  std::string out;
+  const auto& late = m_lateness_us;
+  Append(out,
+         "Lateness (ms): p50 %.1f, p99 %.1f, p99.9 %.1f, max %.1f (%" PRIu64
+         " messages, %" PRIu64 " early)\n",
+         late.GetPercentile(50) / 1000.0, late.GetPercentile(99) / 1000.0,
+         late.GetPercentile(99.9) / 1000.0, late.GetMax() / 1000.0,
+         late.GetCount(), GetEarly());
+  const auto& jitter = m_timer_jitter_us;
+  Append(out,
+         "Timer jitter (ms): p50 %.1f, p99 %.1f, max %.1f (%" PRIu64
+         " wake-ups)\n",
+         jitter.GetPercentile(50) / 1000.0, jitter.GetPercentile(99) / 1000.0,
+         jitter.GetMax() / 1000.0, jitter.GetCount());
+  const auto& batch = m_batch_size;
+  Append(out,
+         "Batch size: mean %" PRIu64 ", p99 %" PRIu64 ", max %" PRIu64
+         " (%" PRIu64 " batches)\n",
+         batch.GetMean(), batch.GetPercentile(99), batch.GetMax(),
+         batch.GetCount());
+  Append(out, "Dropped messages: %" PRIu64 "\n", GetDropped());
+  return out;
+}
@@ -0,0 +1,148 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Replay timing instrumentation: how closely emitted messages follow the
+ * recorded timing.
+ */
+
+#ifndef REPLAY_STATS_H_
+#define REPLAY_STATS_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Fixed memory histogram of non-negative integer values with log-linear
+ * buckets, HDR histogram style: each power of two range is split in
+ * kSubBuckets / 2 linear buckets, giving a relative error below 12.5% over
+ * the full 64 bit range. Record() is lock-free and may be called from any
+ * thread; readers see a consistent enough snapshot for reporting.
+ */
+class LatencyHistogram {
+public:
+  /** Sub-buckets per power of two, values below this are exact. */
+  static constexpr unsigned kSubBucketBits = 4;
+  static constexpr uint64_t kSubBuckets = 1u << kSubBucketBits;
+  static constexpr size_t kBucketCount =
+      (64 - kSubBucketBits + 1) * (kSubBuckets / 2) + kSubBuckets / 2;
+
+  LatencyHistogram();
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  /** Add a value. */
+  void Record(uint64_t value);
+
+  /** Remove all values. Not atomic with respect to concurrent Record(). */
+  void Reset();
+
+  [[nodiscard]] uint64_t GetCount() const { return m_count; }
+
+  [[nodiscard]] uint64_t GetMax() const { return m_max; }
+
+  /** Return mean value, rounded down, or 0 if empty. */
+  [[nodiscard]] uint64_t GetMean() const;
+
+  /**
+   * Return upper bound of the value at given percentile, limited to max.
+   * @param percentile Percentile in range 0..100.
+   */
+  [[nodiscard]] uint64_t GetPercentile(double percentile) const;
+
+  /**
+   * Append histogram as a JSON object: count, mean, max, a few percentiles
+   * and the non-empty buckets as [upper bound, count] pairs.
+   */
+  void AppendJson(std::string& out) const;
+
+  /** Return index of bucket holding value. */
+  static size_t BucketIndex(uint64_t value);
+
+  /** Return largest value stored in bucket. */
+  static uint64_t BucketUpperBound(size_t index);
+
+private:
+  std::array<std::atomic<uint64_t>, kBucketCount> m_buckets;
+  std::atomic<uint64_t> m_count;
+  std::atomic<uint64_t> m_sum;
+  std::atomic<uint64_t> m_max;
+};
+
+/** Replay timing statistics for one playback session. */
+class ReplayStats {
+public:
+  ReplayStats();
+
+  /**
+   * Record a message emitted at emit_us which was scheduled for
+   * scheduled_us, both in microseconds on the same clock. Messages sent
+   * ahead of schedule are counted but not part of the lateness histogram.
+   */
+  void RecordEmission(int64_t scheduled_us, int64_t emit_us);
+
+  /** Record number of messages emitted in one batch. */
+  void RecordBatch(size_t size) { m_batch_size.Record(size); }
+
+  /** Record how late the replay timer fired, in microseconds. */
+  void RecordTimerJitter(int64_t late_us);
+
+  /** Set total number of messages dropped by sinks. */
+  void SetDropped(uint64_t dropped) { m_dropped = dropped; }
+
+  void Reset();
+
+  [[nodiscard]] const LatencyHistogram& GetLateness() const {
+    return m_lateness_us;
+  }
+
+  [[nodiscard]] const LatencyHistogram& GetBatchSize() const {
+    return m_batch_size;
+  }
+
+  [[nodiscard]] const LatencyHistogram& GetTimerJitter() const {
+    return m_timer_jitter_us;
+  }
+
+  [[nodiscard]] uint64_t GetEarly() const { return m_early; }
+
+  [[nodiscard]] uint64_t GetDropped() const { return m_dropped; }
+
+  /**
+   * Return all statistics as a JSON object.
+   * @param speed Playback speed multiplier, included for reference.
+   */
+  [[nodiscard]] std::string ToJson(int speed) const;
+
+  /** Return a short, human readable multi-line summary. */
+  [[nodiscard]] std::string FormatSummary() const;
+
+private:
+  LatencyHistogram m_lateness_us;      //!< Emission minus scheduled time
+  LatencyHistogram m_batch_size;       //!< Messages per batch
+  LatencyHistogram m_timer_jitter_us;  //!< Timer wake-up lateness
+  std::atomic<uint64_t> m_early;       //!< Messages emitted ahead of time
+  std::atomic<uint64_t> m_dropped;     //!< Messages dropped by sinks
+};
+
+#endif  // REPLAY_STATS_H_
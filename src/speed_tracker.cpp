@@ -0,0 +1,128 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Implement speed_tracker.h
+ */
+
+#include "speed_tracker.h"
+
+/** Conversion factor from m/s to knots. */
+static constexpr double kMpsToKnots = 1.94384;
+
+/** A field in a NMEA 0183 sentence. */
+struct NmeaField {
+  const char* begin;
+  const char* end;
+
+  [[nodiscard]] bool Is(char c) const {
+    return end - begin == 1 && *begin == c;
+  }
+};
+
+/**
+ * Split sentence in fields, field 0 being the address, stopping at the
+ * checksum or line ending.
+ * @return Number of fields found, at most max_fields.
+ */
+static int SplitFields(const char* sentence, size_t len, NmeaField* fields,
+                       int max_fields) {
+  const char* end = sentence + len;
+  const char* begin = sentence;
+  int count = 0;
+  for (const char* p = sentence; count < max_fields; ++p) {
+    if (p == end || *p == ',' || *p == '*' || *p == '\r' || *p == '\n') {
+      fields[count++] = {begin, p};
+      if (p == end || *p != ',') break;
+      begin = p + 1;
+    }
+  }
+  return count;
+}
+
+/** Parse a non-negative decimal number, not using locales. */
+static bool ParseDecimal(const NmeaField& field, double& value) {
+  double result = 0;
+  double scale = 0;  // Weight of next fraction digit, 0 in integer part.
+  bool has_digits = false;
+  for (const char* p = field.begin; p < field.end; ++p) {
+    if (*p >= '0' && *p <= '9') {
+      has_digits = true;
+      if (scale == 0) {
+        result = 10 * result + (*p - '0');
+      } else {
+        result += scale * (*p - '0');
+        scale /= 10;
+      }
+    } else if (*p == '.' && scale == 0) {
+      scale = 0.1;
+    } else {
+      return false;
+    }
+  }
+  if (!has_digits) return false;
+  value = result;
+  return true;
+}
+
+bool ParseNmeaSog(const char* sentence, size_t len, SpeedSource& source,
+                  double& knots) {
+  if (!IsNmeaSogSentence(sentence, len)) return false;
+  constexpr int kMaxFields = 8;
+  NmeaField fields[kMaxFields];
+  const int count = SplitFields(sentence, len, fields, kMaxFields);
+
+  if (sentence[3] == 'R') {
+    // $--RMC,time,status,lat,N/S,lon,E/W,sog,cog,...
+    if (count < 8 || fields[2].Is('V')) return false;
+    if (!ParseDecimal(fields[7], knots)) return false;
+    source = SpeedSource::kRmc;
+    return true;
+  }
+  // $--VTG,cog,T,cog,M,sog,N,sog,K,... where NMEA 1.5 lacks the units:
+  // $--VTG,cog,cog,sog,sog
+  const int sog_field = count > 2 && fields[2].Is('T') ? 5 : 3;
+  if (count <= sog_field || !ParseDecimal(fields[sog_field], knots)) {
+    return false;
+  }
+  source = SpeedSource::kVtg;
+  return true;
+}
+
+bool ParseN2kSog(const uint8_t* payload, size_t len, double& knots) {
+  // 11 header bytes + 8 data bytes: SID, COG reference, COG (2 bytes),
+  // SOG (2 bytes, 0.01 m/s) and reserved.
+  if (len < 19) return false;
+  const unsigned raw_sog = payload[17] | (payload[18] << 8);
+  if (raw_sog >= 0xfffd) return false;  // Not available or out of range.
+  knots = raw_sog * 0.01 * kMpsToKnots;
+  return true;
+}
+
+bool SpeedTracker::Update(SpeedSource source, double knots,
+                          Clock::time_point now) {
+  if (m_has_speed && source != m_source && now - m_updated < kSourceTimeout) {
+    return false;
+  }
+  m_has_speed = true;
+  m_source = source;
+  m_speed = knots;
+  m_updated = now;
+  return true;
+}
@@ -0,0 +1,116 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * Speed over ground used by auto recording. Sentences are classified and
+ * parsed in place, one pass and no allocations, since this runs for every
+ * received message.
+ */
+
+#ifndef SPEED_TRACKER_H_
+#define SPEED_TRACKER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/** Messages providing speed over ground. */
+enum class SpeedSource {
+  kRmc,       //!< NMEA 0183 RMC
+  kVtg,       //!< NMEA 0183 VTG
+  kN2kCogSog  //!< NMEA 2000 PGN 129026, COG & SOG rapid update
+};
+
+/**
+ * Return true if sentence is a RMC or VTG sentence from any talker.
+ * @param sentence Any type indexable by position e.g., const char* or
+ *     wxString, so sentences can be classified before being converted.
+ */
+template <typename Chars>
+[[nodiscard]] bool IsNmeaSogSentence(const Chars& sentence, size_t len) {
+  if (len < 6 || sentence[0] != '$') return false;
+  if (len > 6 && sentence[6] != ',') return false;
+  return (sentence[3] == 'R' && sentence[4] == 'M' && sentence[5] == 'C') ||
+         (sentence[3] == 'V' && sentence[4] == 'T' && sentence[5] == 'G');
+}
+
+/**
+ * Get speed over ground from a RMC or VTG sentence.
+ * @param sentence Complete sentence, checksum and line ending optional.
+ * @param source Updated with the sentence type on success.
+ * @param knots Updated with speed in knots on success.
+ * @return false if sentence is not a RMC or VTG sentence, the fix is
+ *     invalid or the speed is missing.
+ */
+bool ParseNmeaSog(const char* sentence, size_t len, SpeedSource& source,
+                  double& knots);
+
+/** NMEA 2000 COG & SOG, Rapid Update PGN providing speed over ground. */
+static constexpr uint32_t kN2kSogPgn = 129026;
+
+/**
+ * Get speed over ground from PGN 129026 as returned by GetN2000Payload().
+ * @return false if payload is too short or speed is not available.
+ */
+bool ParseN2kSog(const uint8_t* payload, size_t len, double& knots);
+
+/**
+ * Last known speed over ground from one or more sources. The source which
+ * last provided a speed is kept as long as it is alive, other sources only
+ * take over after it has been silent for kSourceTimeout. This avoids the
+ * speed bouncing between e.g. a GPS and a NMEA 2000 sensor.
+ */
+class SpeedTracker {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /** Time without updates before another source is accepted. */
+  static constexpr std::chrono::seconds kSourceTimeout{5};
+
+  SpeedTracker()
+      : m_has_speed(false), m_source(SpeedSource::kRmc), m_speed(0) {}
+
+  /**
+   * Update speed from source.
+   * @return true if the speed was accepted, false if ignored in favour
+   *     of another source.
+   */
+  bool Update(SpeedSource source, double knots,
+              Clock::time_point now = Clock::now());
+
+  /** Return true if a speed has been accepted by Update(). */
+  [[nodiscard]] bool HasSpeed() const { return m_has_speed; }
+
+  /** Return last accepted speed in knots, 0 if none. */
+  [[nodiscard]] double GetSpeed() const { return m_speed; }
+
+  /** Return source of last accepted speed. */
+  [[nodiscard]] SpeedSource GetSource() const { return m_source; }
+
+  /** Forget current speed and source. */
+  void Reset() { *this = SpeedTracker(); }
+
+private:
+  bool m_has_speed;
+  SpeedSource m_source;
+  double m_speed;  //!< Knots
+  Clock::time_point m_updated;
+};
+
+#endif  // SPEED_TRACKER_H_
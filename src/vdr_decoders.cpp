@@ -0,0 +1,488 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+
+/**
+ * \file
+ *
+ * Implement vdr_decoders.h
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <wx/strconv.h>
+#include <wx/tokenzr.h>
+
+#include "file_path.h"
+#include "n2k_encoder.h"
+#include "vdr_decoders.h"
+
+/** Return true if c is whitespace, not using locales. */
+static bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' ||
+         c == '\v';
+}
+
+/** Position file at offset, supporting files larger than 2 GB. */
+static bool SeekFile(std::FILE* file, uint64_t offset) {
+#ifdef _WIN32
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+/** Return timestamp as ms since 1/1 1970. */
+static uint64_t ToStamp(const wxDateTime& timestamp) {
+  return static_cast<uint64_t>(timestamp.GetValue().GetValue());
+}
+
+/** Return true if the message is a NMEA0183 or AIS message */
+static bool IsNmea0183OrAis(const wxString& message) {
+  // NMEA sentences start with $ or !
+  return message.StartsWith("$") || message.StartsWith("!");
+}
+
+LineReader::LineReader()
+    : m_file(nullptr), m_block(kBlockSize), m_block_offset(0), m_pos(0),
+      m_end(0) {}
+
+LineReader::~LineReader() { Close(); }
+
+void LineReader::Close() {
+  if (m_file) std::fclose(m_file);
+  m_file = nullptr;
+  m_block_offset = 0;
+  m_pos = 0;
+  m_end = 0;
+}
+
+bool LineReader::Open(const std::string& path, uint64_t offset) {
+  Close();
+  m_file = OpenStdioFile(path, "rb");
+  if (!m_file) return false;
+  m_block_offset = offset > 0 ? offset - 1 : 0;
+  if (m_block_offset > 0 && !SeekFile(m_file, m_block_offset)) {
+    Close();
+    return false;
+  }
+  if (offset == 0) return true;
+  // Skip the line containing offset - 1.
+  while (m_pos < m_end || FillBlock()) {
+    const char* begin = m_block.data() + m_pos;
+    auto nl = static_cast<const char*>(std::memchr(begin, '\n', m_end - m_pos));
+    if (nl) {
+      m_pos = nl + 1 - m_block.data();
+      break;
+    }
+    m_pos = m_end;
+  }
+  return true;
+}
+
+bool LineReader::FillBlock() {
+  if (!m_file) return false;
+  m_block_offset += m_end;
+  m_pos = 0;
+  m_end = std::fread(m_block.data(), 1, m_block.size(), m_file);
+  return m_end > 0;
+}
+
+bool LineReader::ReadLine(wxString& line, uint64_t& offset) {
+  while (m_pos < m_end || FillBlock()) {
+    const uint64_t line_offset = m_block_offset + m_pos;
+    m_line.clear();
+    for (;;) {
+      const char* begin = m_block.data() + m_pos;
+      auto nl =
+          static_cast<const char*>(std::memchr(begin, '\n', m_end - m_pos));
+      const char* end = nl ? nl : m_block.data() + m_end;
+      m_line.append(begin, end);
+      m_pos = end - m_block.data();
+      if (nl) {
+        m_pos += 1;
+        break;
+      }
+      if (!FillBlock()) break;  // Last line lacking newline
+    }
+    size_t first = 0;
+    size_t last = m_line.size();
+    while (first < last && IsSpace(m_line[first])) ++first;
+    while (last > first && IsSpace(m_line[last - 1])) --last;
+    if (first == last || m_line[first] == '#') continue;
+
+    line = wxString::FromUTF8(m_line.data() + first, last - first);
+    if (line.IsEmpty()) {
+      line = wxString(m_line.data() + first, wxConvISO8859_1, last - first);
+    }
+    offset = line_offset;
+    return true;
+  }
+  return false;
+}
+
+RawNmeaDecoder::RawNmeaDecoder(const FileSniff& sniff)
+    : m_path(sniff.path),
+      m_size(sniff.size),
+      m_has_primary(false),
+      m_valid_sentences(0),
+      m_invalid_sentences(0),
+      m_stamp(0) {}
+
+bool RawNmeaDecoder::Open(uint64_t offset) {
+  m_stamp = 0;
+  if (m_has_primary) {
+    // Records before the first timestamp are played with it.
+    if (!m_reader.Open(m_path, offset)) return false;
+    uint64_t line_offset;
+    while (m_reader.ReadLine(m_line, line_offset)) {
+      if (ParseStamp(m_line, m_stamp)) break;
+    }
+  }
+  return m_reader.Open(m_path, offset);
+}
+
+bool RawNmeaDecoder::Read(ReplayRecord& record) {
+  while (m_reader.ReadLine(m_line, record.offset)) {
+    uint64_t stamp;
+    if (ParseStamp(m_line, stamp)) m_stamp = stamp;
+
+    // Sentences are replayed without the receive time tag block.
+    TagBlock tag;
+    TimestampParser::ParseTagBlock(m_line, tag);
+    const wxScopedCharBuffer utf8 = m_line.Mid(tag.length).utf8_str();
+    if (utf8.length() == 0) continue;
+    ParseReplayLine(utf8.data(), utf8.length(), record.msg);
+    record.stamp = m_stamp;
+    return true;
+  }
+  return false;
+}
+
+void RawNmeaDecoder::Scan(const ScanVisitor& visitor) {
+  if (!m_has_primary) return;
+  LineReader reader;
+  if (!reader.Open(m_path, 0)) return;
+  wxString line;
+  uint64_t offset;
+  uint64_t stamp;
+  while (reader.ReadLine(line, offset)) {
+    if (ParseStamp(line, stamp)) visitor(stamp, offset);
+  }
+}
+
+bool RawNmeaDecoder::ParseStamp(const wxString& line, uint64_t& stamp) {
+  // Signal K deltas in raw recordings are timed by surrounding NMEA data.
+  if (!m_has_primary || line.StartsWith("{")) return false;
+  wxDateTime timestamp;
+  int precision;
+  if (!m_parser.ParseTimestamp(line, timestamp, precision)) return false;
+  stamp = ToStamp(timestamp);
+  return true;
+}
+
+void RawNmeaDecoder::ScanTimeSources() {
+  m_time_sources.clear();
+  m_has_primary = false;
+  m_valid_sentences = 0;
+  m_invalid_sentences = 0;
+  m_parser.Reset();
+
+  LineReader reader;
+  if (!reader.Open(m_path, 0)) return;
+  wxString line;
+  uint64_t offset;
+  while (reader.ReadLine(line, offset)) {
+    wxString talker_id, sentence_id;
+    bool has_timestamp;
+    TagBlock tag;
+    if (TimestampParser::ParseTagBlock(line, tag) && tag.has_time) {
+      // Receive time from the tag block, no need to parse the sentence.
+      talker_id = "";
+      sentence_id = TimestampParser::kTagBlockSource;
+      has_timestamp = true;
+    } else if (!ParseNmeaComponents(line.Mid(tag.length), talker_id,
+                                    sentence_id, has_timestamp)) {
+      m_invalid_sentences++;
+      continue;
+    }
+    // Valid sentence found
+    m_valid_sentences++;
+    if (!has_timestamp) continue;
+
+    wxDateTime timestamp;
+    int precision = 0;
+    if (!m_parser.ParseTimestamp(line, timestamp, precision)) continue;
+    const TimeSource source(talker_id, sentence_id, precision);
+    auto it = m_time_sources.find(source);
+    if (it == m_time_sources.end()) {
+      TimeSourceDetails details;
+      details.start_time = timestamp;
+      details.current_time = timestamp;
+      details.end_time = timestamp;
+      details.is_chronological = true;
+      m_time_sources[source] = details;
+    } else {
+      // Check if timestamps are still chronological
+      TimeSourceDetails& details = it->second;
+      if (timestamp < details.current_time) {
+        details.is_chronological = false;
+      }
+      details.current_time = timestamp;
+      details.end_time = timestamp;
+    }
+  }
+
+  SelectPrimaryTimeSource();
+  if (m_has_primary) {
+    m_parser.SetPrimaryTimeSource(m_primary.talker_id, m_primary.sentence_id,
+                                  m_primary.precision);
+  }
+}
+
+bool RawNmeaDecoder::ParseNmeaComponents(wxString nmea, wxString& talker_id,
+                                         wxString& sentence_id,
+                                         bool& has_timestamp) {
+  // Basic length check - minimum NMEA sentence should be at least 10 chars
+  // $GPGGA,*hh
+  if (nmea.IsEmpty() || (nmea[0] != '$' && nmea[0] != '!')) {
+    return false;
+  }
+
+  // Split the sentence into fields
+  wxStringTokenizer tok(nmea, ",*");
+  if (!tok.HasMoreTokens()) return false;
+
+  wxString header = tok.GetNextToken();
+  // Need exactly $GPXXX or !AIVDM format
+  if (header.length() != 6) return false;
+
+  // Extract talker ID (GP, GN, etc.) and sentence ID (RMC, ZDA, etc.)
+  talker_id = header.Mid(1, 2);
+  sentence_id = header.Mid(3);
+
+  // Special handling for AIS messages starting with !
+  bool is_ais = (nmea[0] == '!');
+
+  // Validate talker ID:
+  // - Must be exactly 2 chars
+  // - Must be ASCII
+  // - Must be alphabetic
+  // - Must be uppercase
+  if (talker_id.length() != 2 || !talker_id.IsAscii() || !talker_id.IsWord()) {
+    return false;
+  }
+
+  if (is_ais) {
+    // For AIS messages, only accept specific talker IDs.
+    if (talker_id != "AI" && talker_id != "AB" && talker_id != "BS") {
+      return false;
+    }
+  } else {
+    // Standard NMEA.
+    if (!talker_id.IsWord() || talker_id != talker_id.Upper()) {
+      return false;
+    }
+  }
+
+  // Validate sentence ID:
+  // - Must be exactly 3 chars
+  // - Must be ASCII
+  // - Must be alphabetic
+  // - Must be uppercase
+  if (sentence_id.length() != 3 || !sentence_id.IsAscii() ||
+      !sentence_id.IsWord()) {
+    return false;
+  }
+
+  // Check if sentence_id is uppercase by comparing with its uppercase version
+  if (sentence_id != sentence_id.Upper()) {
+    return false;
+  }
+
+  // Additional validation: must contain comma after header and checksum after
+  // data
+  size_t last_comma = nmea.Find(',');
+  size_t checksum_pos = nmea.Find('*');
+
+  if (last_comma == wxString::npos || checksum_pos == wxString::npos ||
+      checksum_pos < last_comma) {
+    return false;
+  }
+
+  // Check for known sentence types containing timestamps.
+  if (sentence_id == "RMC" || sentence_id == "ZDA" || sentence_id == "GGA" ||
+      sentence_id == "GBS" || sentence_id == "GLL") {
+    has_timestamp = true;
+    return true;
+  }
+  // Unknown sentence type but valid NMEA format.
+  has_timestamp = false;
+  return true;
+}
+
+void RawNmeaDecoder::SelectPrimaryTimeSource() {
+  m_has_primary = false;
+  if (m_time_sources.empty()) return;
+
+  // Scoring criteria for each source
+  struct SourceScore {
+    TimeSource source;
+    int score;
+  };
+
+  std::vector<SourceScore> scores;
+
+  for (const auto& source : m_time_sources) {
+    if (!source.second.is_chronological) {
+      // Skip sources with non-chronological timestamps
+      continue;
+    }
+    SourceScore score = {source.first, 0};
+    // Tag block receive times cover all sentences including AIS, and are
+    // written by the recorder itself.
+    if (source.first.sentence_id == TimestampParser::kTagBlockSource) {
+      score.score += 100;
+    }
+    // Prefer sources with complete date+time
+    if (source.first.sentence_id.Contains("RMC") ||
+        source.first.sentence_id.Contains("ZDA")) {
+      score.score += 10;
+    }
+
+    // Prefer higher precision
+    score.score += source.first.precision * 2;
+    scores.push_back(score);
+  }
+
+  // Sort by score
+  std::sort(scores.begin(), scores.end(),
+            [](const SourceScore& a, const SourceScore& b) {
+              return a.score > b.score;
+            });
+
+  // Select highest scoring source as primary
+  if (!scores.empty()) {
+    m_primary = scores[0].source;
+    m_has_primary = true;
+  }
+}
+
+VdrCsvDecoder::VdrCsvDecoder(const FileSniff& sniff)
+    : m_path(sniff.path),
+      m_size(sniff.size),
+      m_timestamp_idx(kNoColumn),
+      m_message_idx(kNoColumn),
+      m_type_idx(kNoColumn) {
+  ParseHeader(wxString::FromUTF8(sniff.GetFirstDataLine().c_str()));
+}
+
+bool VdrCsvDecoder::ParseHeader(const wxString& header) {
+  m_timestamp_idx = kNoColumn;
+  m_message_idx = kNoColumn;
+  m_type_idx = kNoColumn;
+
+  // If it looks like NMEA/AIS, it's not a header
+  if (IsNmea0183OrAis(header)) return false;
+
+  wxStringTokenizer tokens(header, ",");
+  unsigned idx = 0;
+  while (tokens.HasMoreTokens()) {
+    wxString field = tokens.GetNextToken().Trim(true).Trim(false).Lower();
+    if (field.Contains("timestamp")) {
+      m_timestamp_idx = idx;
+    } else if (field.Contains("message")) {
+      m_message_idx = idx;
+    } else if (field == "type") {
+      m_type_idx = idx;
+    }
+    idx++;
+  }
+  return m_timestamp_idx != kNoColumn && m_message_idx != kNoColumn;
+}
+
+bool VdrCsvDecoder::Open(uint64_t offset) {
+  if (!m_reader.Open(m_path, offset)) return false;
+  if (offset == 0) {
+    // Skip header, parsed by the constructor.
+    uint64_t header_offset;
+    m_reader.ReadLine(m_line, header_offset);
+  }
+  return true;
+}
+
+bool VdrCsvDecoder::Read(ReplayRecord& record) {
+  while (m_reader.ReadLine(m_line, record.offset)) {
+    if (ParseRow(m_line, record)) return true;
+  }
+  return false;
+}
+
+bool VdrCsvDecoder::ParseRow(const wxString& line, ReplayRecord& record) {
+  wxDateTime timestamp;
+  if (!TimestampParser::ParseCsvLineTimestamp(line, m_timestamp_idx,
+                                              m_message_idx, &m_message,
+                                              &timestamp) ||
+      !timestamp.IsValid()) {
+    return false;
+  }
+  m_message.Trim(true);
+  if (m_message.IsEmpty()) return false;
+
+  const wxScopedCharBuffer utf8 = m_message.utf8_str();
+  if (!m_message.StartsWith("{") && !IsNmea0183OrAis(m_message) &&
+      IsN2kRow(line)) {
+    // Hex encoded NMEA 2000 payload, no text to replay.
+    record.msg.type = ReplayMsgType::kN2k;
+    record.msg.text.clear();
+    record.msg.source.clear();
+    record.msg.msg_type.clear();
+    record.msg.has_n2k =
+        ParseOcpnN2kHex(utf8.data(), utf8.length(), record.msg.n2k);
+  } else {
+    ParseReplayLine(utf8.data(), utf8.length(), record.msg);
+  }
+  record.stamp = ToStamp(timestamp);
+  return true;
+}
+
+bool VdrCsvDecoder::IsN2kRow(const wxString& line) const {
+  if (m_type_idx == kNoColumn) return false;
+  wxString type;
+  bool ok = TimestampParser::ParseCsvLineTimestamp(line, kNoColumn, m_type_idx,
+                                                   &type, nullptr);
+  return ok && type == "NMEA2000";
+}
+
+void VdrCsvDecoder::Scan(const ScanVisitor& visitor) {
+  LineReader reader;
+  if (!reader.Open(m_path, 0)) return;
+  wxString line;
+  wxString message;
+  uint64_t offset;
+  reader.ReadLine(line, offset);  // Header
+  while (reader.ReadLine(line, offset)) {
+    wxDateTime timestamp;
+    if (!TimestampParser::ParseCsvLineTimestamp(
+            line, m_timestamp_idx, m_message_idx, &message, &timestamp) ||
+        !timestamp.IsValid()) {
+      continue;
+    }
+    visitor(ToStamp(timestamp), offset);
+  }
+}
@@ -0,0 +1,214 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+
+/**
+ * \file
+ *
+ * Decoders of the plugin's own recording formats, raw NMEA and VDR CSV,
+ * played by a ReplayEngine like Data Monitor logs.
+ */
+
+#ifndef VDR_DECODERS_H_
+#define VDR_DECODERS_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <wx/string.h>
+
+#include "file_sniffer.h"
+#include "replay_engine.h"
+#include "vdr_pi_time.h"
+
+/** All time sources in a raw recording. */
+using TimeSourceMap =
+    std::unordered_map<TimeSource, TimeSourceDetails, TimeSourceHash>;
+
+/**
+ * Read lines of a text file together with their file offsets, skipping
+ * blank lines and comments starting with '#'.
+ */
+class LineReader {
+public:
+  LineReader();
+
+  ~LineReader();
+
+  LineReader(const LineReader&) = delete;
+  LineReader& operator=(const LineReader&) = delete;
+
+  /**
+   * Open file on path. If offset is not 0 the line containing offset - 1
+   * is skipped, i.e., reading starts at the first line starting at offset
+   * or later.
+   * @return false if file cannot be opened.
+   */
+  bool Open(const std::string& path, uint64_t offset);
+
+  void Close();
+
+  /**
+   * Read next line which is not blank or a comment.
+   * @param line Line without surrounding whitespace. UTF-8 is decoded,
+   *     other text is taken as ISO-8859-1.
+   * @param offset File offset of line.
+   * @return false at end of file.
+   */
+  bool ReadLine(wxString& line, uint64_t& offset);
+
+private:
+  static constexpr size_t kBlockSize = 64 * 1024;
+
+  /** Read next block, return false at end of file or error. */
+  bool FillBlock();
+
+  std::FILE* m_file;
+  std::vector<char> m_block;
+  uint64_t m_block_offset;  //!< File offset of m_block[0]
+  size_t m_pos;             //!< Next unread byte in m_block
+  size_t m_end;             //!< End of valid data in m_block
+  std::string m_line;       //!< Current line, reused
+};
+
+/**
+ * ReplayDecoder reading raw NMEA 0183, AIS, NMEA 2000 text and Signal K
+ * lines. Records are timed by the primary time source selected by
+ * ScanTimeSources(), records without such a timestamp are played together
+ * with the nearest timestamp before them. Without a primary time source
+ * all records are untimed.
+ */
+class RawNmeaDecoder : public ReplayDecoder {
+public:
+  /** @param sniff Recording as returned by SniffFile(). */
+  explicit RawNmeaDecoder(const FileSniff& sniff);
+
+  bool Open(uint64_t offset) override;
+
+  bool Read(ReplayRecord& record) override;
+
+  [[nodiscard]] uint64_t GetSize() const override { return m_size; }
+
+  void Scan(const ScanVisitor& visitor) override;
+
+  /**
+   * Read the whole file, collect all time sources and select the primary
+   * one. A source is identified by talker, sentence and precision, or is
+   * the receive time in tag blocks.
+   */
+  void ScanTimeSources();
+
+  /** Return time sources found by ScanTimeSources(). */
+  [[nodiscard]] const TimeSourceMap& GetTimeSources() const {
+    return m_time_sources;
+  }
+
+  /** Return true if ScanTimeSources() found a usable time source. */
+  [[nodiscard]] bool HasPrimaryTimeSource() const { return m_has_primary; }
+
+  /** Return time source used, valid if HasPrimaryTimeSource(). */
+  [[nodiscard]] const TimeSource& GetPrimaryTimeSource() const {
+    return m_primary;
+  }
+
+  /** Return number of NMEA sentences found by ScanTimeSources(). */
+  [[nodiscard]] int GetValidSentences() const { return m_valid_sentences; }
+
+  /** Return number of other lines found by ScanTimeSources(). */
+  [[nodiscard]] int GetInvalidSentences() const {
+    return m_invalid_sentences;
+  }
+
+  /** Helper function to extract NMEA sentence components. */
+  static bool ParseNmeaComponents(wxString nmea, wxString& talker_id,
+                                  wxString& sentence_id, bool& has_timestamp);
+
+private:
+  /** Helper to select the best primary time source. */
+  void SelectPrimaryTimeSource();
+
+  /**
+   * Parse timestamp of primary time source in line.
+   * @param stamp Timestamp, ms since 1/1 1970.
+   * @return false if there is no such timestamp.
+   */
+  bool ParseStamp(const wxString& line, uint64_t& stamp);
+
+  const std::string m_path;
+  const uint64_t m_size;
+  LineReader m_reader;
+
+  /** Date of RMC and ZDA sentences is kept for time only sentences. */
+  TimestampParser m_parser;
+
+  TimeSourceMap m_time_sources;
+  TimeSource m_primary;
+  bool m_has_primary;
+  int m_valid_sentences;
+  int m_invalid_sentences;
+
+  uint64_t m_stamp;  //!< Timestamp of records read, 0 if untimed
+  wxString m_line;   //!< Current line, reused
+};
+
+/**
+ * ReplayDecoder reading the VDR CSV format, with a header naming at least
+ * timestamp and message columns. NMEA 2000 rows, as told by a type column,
+ * carry the message as hex encoded payload.
+ */
+class VdrCsvDecoder : public ReplayDecoder {
+public:
+  /** @param sniff Recording as returned by SniffFile(). */
+  explicit VdrCsvDecoder(const FileSniff& sniff);
+
+  bool Open(uint64_t offset) override;
+
+  bool Read(ReplayRecord& record) override;
+
+  [[nodiscard]] uint64_t GetSize() const override { return m_size; }
+
+  void Scan(const ScanVisitor& visitor) override;
+
+  /**
+   * Parse CSV header, setting the column indexes.
+   * @return true if timestamp and message columns are found.
+   */
+  bool ParseHeader(const wxString& header);
+
+private:
+  static constexpr unsigned kNoColumn = static_cast<unsigned>(-1);
+
+  /** Parse a CSV row into record, return false if it is not valid. */
+  bool ParseRow(const wxString& line, ReplayRecord& record);
+
+  /** Return true if CSV line is a NMEA2000 record according to type column. */
+  bool IsN2kRow(const wxString& line) const;
+
+  const std::string m_path;
+  const uint64_t m_size;
+  LineReader m_reader;
+  unsigned m_timestamp_idx;
+  unsigned m_message_idx;
+  unsigned m_type_idx;
+  wxString m_line;     //!< Current line, reused
+  wxString m_message;  //!< Message column of current line, reused
+};
+
+#endif  // VDR_DECODERS_H_
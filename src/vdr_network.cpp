@@ -20,6 +20,29 @@
 
 #include <algorithm>
 
+#include <wx/thread.h>
+
+bool OutputBuffer::Append(const void* data, size_t length) {
+  if (GetSize() > 0 && GetSize() + length > m_max_bytes) {
+    m_dropped += 1;
+    return false;
+  }
+  m_data.append(static_cast<const char*>(data), length);
+  return true;
+}
+
+void OutputBuffer::Consume(size_t count) {
+  m_offset += std::min(count, GetSize());
+  if (m_offset == m_data.size()) {
+    m_data.clear();
+    m_offset = 0;
+  } else if (m_offset > m_data.size() / 2) {
+    // Moves less than half of the data, the capacity is kept.
+    m_data.erase(0, m_offset);
+    m_offset = 0;
+  }
+}
+
 // Avoid strange wxDFEFINE_EVENT(...) macro:
 static const wxEventTypeTag<wxSocketEvent> EvtTcpSocket(wxNewEventType());
 
@@ -28,7 +51,9 @@ VdrNetworkServer::VdrNetworkServer()
       m_udp_socket(nullptr),
       m_running(false),
       m_useTCP(true),
-      m_port(kDefaultPort) {
+      m_port(kDefaultPort),
+      m_pending_bytes(0),
+      m_send_posted(false) {
   // Initialize socket handling
   wxSocketBase::Initialize();
   Bind(EvtTcpSocket, [&](wxSocketEvent& ev) { OnTcpEvent(ev); });
@@ -68,6 +93,11 @@ bool VdrNetworkServer::Start(bool useTCP, int port, wxString& error) {
 }
 
 void VdrNetworkServer::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.clear();
+    m_pending_bytes = 0;
+  }
   if (m_tcp_server) {
     m_tcp_server->Notify(false);
     delete m_tcp_server;
@@ -79,10 +109,15 @@ void VdrNetworkServer::Stop() {
     m_udp_socket = nullptr;
   }
 
-  m_tcp_clients.clear();
+  CloseClients();
   m_running = false;
 }
 
+void VdrNetworkServer::CloseClients() {
+  for (auto& client : m_tcp_clients) client->socket->Destroy();
+  m_tcp_clients.clear();
+}
+
 bool VdrNetworkServer::SendText(const wxString& message) {
   if (!m_running) {
     return false;
@@ -93,7 +128,8 @@ bool VdrNetworkServer::SendText(const wxString& message) {
   if (!formatted_msg.EndsWith("\r\n")) {
     formatted_msg += "\r\n";
   }
-  return SendImpl(formatted_msg.c_str(), formatted_msg.Length());
+  const wxScopedCharBuffer utf8 = formatted_msg.ToUTF8();
+  return SendImpl(utf8.data(), utf8.length());
 }
 
 bool VdrNetworkServer::SendBinary(const void* data, size_t length) {
@@ -105,17 +141,53 @@ bool VdrNetworkServer::SendBinary(const void* data, size_t length) {
 }
 
 bool VdrNetworkServer::SendImpl(const void* data, size_t length) {
-  if (m_useTCP) {
-    // Remove any dead connections before sending
-    CleanupDeadConnections();
+  if (wxThread::IsMain()) return SendNow(data, length);
+  // Sockets are driven by main thread events and must not be used from
+  // other threads. Whole messages are dropped if the main thread lags.
+  bool post = false;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending_bytes > 0 &&
+        m_pending_bytes + length > OutputBuffer::kMaxBytes) {
+      return false;
+    }
+    m_pending.emplace_back(static_cast<const char*>(data), length);
+    m_pending_bytes += length;
+    post = !m_send_posted;
+    m_send_posted = true;
+  }
+  if (post) CallAfter(&VdrNetworkServer::SendPending);
+  return true;
+}
+
+void VdrNetworkServer::SendPending() {
+  std::vector<std::string> pending;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    pending.swap(m_pending);
+    m_pending_bytes = 0;
+    m_send_posted = false;
+  }
+  if (!m_running) return;
+  for (const auto& message : pending) SendNow(message.data(), message.size());
+}
 
-    // Send to all TCP clients
+bool VdrNetworkServer::SendNow(const void* data, size_t length) {
+  if (m_useTCP) {
+    // Send to all TCP clients. Dead connections are removed when the socket
+    // lost event arrives.
     bool success = true;
-    for (auto client : m_tcp_clients) {
-      client->Write(data, length);
-      if (client->Error()) {
+    for (auto& client : m_tcp_clients) {
+      if (!client->socket->IsConnected()) continue;
+      if (!client->out.Append(data, length)) {
+        if (client->out.GetDropped() == 1) {
+          wxLogMessage("TCP client on port %d is too slow, dropping data",
+                       m_port);
+        }
         success = false;
+        continue;
       }
+      Drain(*client);
     }
     return success && !m_tcp_clients.empty();
   } else {
@@ -132,6 +204,16 @@ bool VdrNetworkServer::SendImpl(const void* data, size_t length) {
   return false;
 }
 
+void VdrNetworkServer::Drain(TcpClient& client) {
+  while (client.out.GetSize() > 0) {
+    // Non blocking, the rest is written on the next output event.
+    client.socket->Write(client.out.GetData(), client.out.GetSize());
+    const size_t written = client.socket->LastCount();
+    if (written == 0) break;
+    client.out.Consume(written);
+  }
+}
+
 bool VdrNetworkServer::InitTCP(int port, wxString& error) {
   wxIPV4address addr;
   if (!addr.Hostname("127.0.0.1")) {
@@ -204,21 +286,36 @@ void VdrNetworkServer::OnTcpEvent(wxSocketEvent& event) {
       // Accept new client connection
       wxSocketBase* client = m_tcp_server->Accept(false);
       if (client) {
+        // Writes never block, output is buffered until the socket is
+        // writable again.
+        client->SetFlags(wxSOCKET_NOWAIT_WRITE);
         client->SetEventHandler(*this, EvtTcpSocket);
-        client->SetNotify(wxSOCKET_LOST_FLAG);
+        client->SetNotify(wxSOCKET_LOST_FLAG | wxSOCKET_OUTPUT_FLAG);
         client->Notify(true);
-        m_tcp_clients.push_back(client);
+        CleanupDeadConnections();
+        m_tcp_clients.push_back(
+            std::make_unique<TcpClient>(TcpClient{client, OutputBuffer()}));
         wxLogMessage("New TCP client connected. Total clients: %zu",
                      m_tcp_clients.size());
       }
       break;
     }
 
+    case wxSOCKET_OUTPUT: {
+      // Socket writable again, continue with buffered output.
+      for (auto& client : m_tcp_clients) {
+        if (client->socket == event.GetSocket()) Drain(*client);
+      }
+      break;
+    }
+
     case wxSOCKET_LOST: {
       // Handle client disconnection
       wxSocketBase* client = event.GetSocket();
       if (client) {
-        auto it = std::find(m_tcp_clients.begin(), m_tcp_clients.end(), client);
+        auto it = std::find_if(
+            m_tcp_clients.begin(), m_tcp_clients.end(),
+            [client](const auto& c) { return c->socket == client; });
         if (it != m_tcp_clients.end()) {
           m_tcp_clients.erase(it);
           client->Destroy();
@@ -237,9 +334,9 @@ void VdrNetworkServer::OnTcpEvent(wxSocketEvent& event) {
 void VdrNetworkServer::CleanupDeadConnections() {
   auto it = m_tcp_clients.begin();
   while (it != m_tcp_clients.end()) {
-    wxSocketBase* client = *it;
-    if (!client || !client->IsConnected()) {
-      delete client;
+    wxSocketBase* client = (*it)->socket;
+    if (!client->IsConnected()) {
+      client->Destroy();
       it = m_tcp_clients.erase(it);
     } else {
       ++it;
@@ -19,18 +19,67 @@
 #ifndef VDR_NETWORK_H_
 #define VDR_NETWORK_H_
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include <wx/wx.h>
 #include <wx/socket.h>
 #include <wx/string.h>
 
+/**
+ * Output pending for a TCP client. Data is appended as whole messages and
+ * a message which does not fit is dropped as a whole, so a slow client
+ * misses messages but never gets a partial line or binary frame.
+ */
+class OutputBuffer {
+public:
+  /** Default max pending bytes. */
+  static constexpr size_t kMaxBytes = 256 * 1024;
+
+  explicit OutputBuffer(size_t max_bytes = kMaxBytes)
+      : m_offset(0), m_max_bytes(max_bytes), m_dropped(0) {}
+
+  /**
+   * Append a message. A message larger than the limit is accepted when the
+   * buffer is empty.
+   * @return false if the message was dropped.
+   */
+  bool Append(const void* data, size_t length);
+
+  /** Return start of data not yet written. */
+  [[nodiscard]] const char* GetData() const { return m_data.data() + m_offset; }
+
+  /** Return number of bytes not yet written. */
+  [[nodiscard]] size_t GetSize() const { return m_data.size() - m_offset; }
+
+  /** Remove count written bytes from the start. */
+  void Consume(size_t count);
+
+  /** Return number of messages dropped. */
+  [[nodiscard]] uint64_t GetDropped() const { return m_dropped; }
+
+private:
+  std::string m_data;
+  size_t m_offset;  //!< Bytes at start of m_data already written
+  const size_t m_max_bytes;
+  uint64_t m_dropped;
+};
+
 /**
  * Network server for replaying NMEA messages over TCP or UDP.
  *
  * Provides a server that can listen on a specified port and protocol (TCP/UDP)
  * and broadcast messages to connected clients. For TCP, maintains a list of
  * connected clients. For UDP, broadcasts to localhost on the specified port.
+ *
+ * Sockets are only used on the main thread. SendText() and SendBinary() may
+ * also be used from a replay sink thread, the data is then handed over to
+ * the main thread. Each TCP client has an OutputBuffer, drained without
+ * blocking when the socket is writable.
  */
 class VdrNetworkServer : public wxEvtHandler {
 public:
@@ -86,12 +135,27 @@ public:
   [[nodiscard]] int GetPort() const { return m_port; }
 
 private:
+  /** A connected TCP client. */
+  struct TcpClient {
+    wxSocketBase* socket;
+    OutputBuffer out;
+  };
+
   /** Handle incoming TCP socket events. */
   void OnTcpEvent(wxSocketEvent& event);
 
   /** Remove any dead or disconnected TCP clients. */
   void CleanupDeadConnections();
 
+  /** Destroy all TCP client sockets. */
+  void CloseClients();
+
+  /** Write as much buffered output as the client socket accepts. */
+  void Drain(TcpClient& client);
+
+  /** Send messages handed over by other threads, main thread. */
+  void SendPending();
+
   /** Initialize TCP server. */
   bool InitTCP(int port, wxString& error);
 
@@ -99,18 +163,29 @@ private:
   bool InitUDP(int port, wxString& error);
 
   /**
-   * Internal send implementation.
-   * Handles the actual sending of data for both TCP and UDP.
+   * Internal send implementation, hands data over to the main thread if
+   * needed.
    */
   bool SendImpl(const void* data, size_t length);
 
+  /**
+   * Send data to all clients, main thread.
+   * Handles the actual sending of data for both TCP and UDP.
+   */
+  bool SendNow(const void* data, size_t length);
+
 private:
-  wxSocketServer* m_tcp_server;              //!< TCP server socket
-  wxDatagramSocket* m_udp_socket;            //!< UDP socket
-  std::vector<wxSocketBase*> m_tcp_clients;  //!< Connected TCP clients
-  bool m_running;                            //!< Server running state
-  bool m_useTCP;                             //!< Current protocol
-  int m_port;                                //!< Current port
+  wxSocketServer* m_tcp_server;    //!< TCP server socket
+  wxDatagramSocket* m_udp_socket;  //!< UDP socket
+  std::vector<std::unique_ptr<TcpClient>> m_tcp_clients;  //!< Main thread
+  std::atomic<bool> m_running;     //!< Server running state
+  bool m_useTCP;                   //!< Current protocol
+  int m_port;                      //!< Current port
+
+  std::mutex m_mutex;  //!< Guards the pending messages below
+  std::vector<std::string> m_pending;  //!< From other threads, in order
+  size_t m_pending_bytes;
+  bool m_send_posted;  //!< SendPending() is queued on the main thread
 
   static constexpr int kDefaultPort = 10111;  //!< Default NMEA port
 };
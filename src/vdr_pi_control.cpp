@@ -22,13 +22,19 @@
 #include <wx/colour.h>
 #include <wx/dcclient.h>
 #include <wx/display.h>
+#include <wx/filedlg.h>
+#include <wx/filename.h>
 #include <wx/gdicmn.h>
+#include <wx/progdlg.h>
 #include <wx/sizer.h>
 #include <wx/slider.h>
 #include <wx/statbox.h>
+#include <wx/textctrl.h>
 
 #include "vdr_pi_control.h"
 #include "vdr_pi.h"
+#include "dm_converter.h"
+#include "file_path.h"
 #include "icons.h"
 
 const char* const kBadVdrFormat =
@@ -42,12 +48,26 @@ in VDR mode. You might want to adjust the Replay
 preferences to "Use loopback driver" to be able to
 play it.)");
 
-bool VdrControl::LoadFile(const wxString& current_file) {
+const char* const kConvertNonVdrFormat =
+    _(R"(This file seems to be recorded by Data Monitor
+in VDR mode. It can be played after adjusting the
+Replay preferences to "Use loopback driver", or be
+converted to a VDR recording playable using the
+current preferences.
+
+Convert it now?)");
+
+const char* const kConvertFailed =
+    _(R"(Converting the Data Monitor log failed, see
+the log for details.)");
+
+bool VdrControl::LoadFile(const wxString& current_file,
+                          const FileSniff* sniff) {
   bool status = true;
   wxString error;
   UpdatePlaybackStatus(_("Stopped"));
   UpdateNetworkStatus("");
-  if (m_record_play_mgr->LoadFile(current_file, &error)) {
+  if (m_record_play_mgr->LoadFile(current_file, &error, sniff)) {
     bool has_valid_timestamps;
     bool success =
         m_record_play_mgr->ScanFileTimestamps(has_valid_timestamps, error);
@@ -215,6 +235,12 @@ void VdrControl::CreateControls() {
   playback_status_sizer->Add(m_playback_status_lbl, 1, wxALIGN_CENTER_VERTICAL);
   status_sizer->Add(playback_status_sizer, 0, wxEXPAND | wxALL, 5);
 
+  // Replay timing statistics
+  m_stats_btn = new wxButton(this, wxID_ANY, _("Timing statistics..."));
+  m_stats_btn->Bind(wxEVT_BUTTON,
+                    [&](wxCommandEvent& ev) { OnStatsButton(ev); });
+  status_sizer->Add(m_stats_btn, 0, wxALL, 5);
+
   main_sizer->Add(status_sizer, 0, wxEXPAND | wxALL, 5);
 
   SetSizer(main_sizer);
@@ -264,15 +290,62 @@ void VdrControl::OnLoadButton(wxCommandEvent& event) {
                                             init_directory, "", "*.*");
   if (response != wxID_OK) return;
 
-  bool is_vdrfile = DataMonitorReplayMgr::IsVdrFormat(file.ToStdString());
+  // Read file head once, reused when loading unless the file is converted.
+  FileSniff sniff;
+  const FileSniff* loaded_sniff = nullptr;
+  if (SniffFile(ToFilePath(file), sniff)) loaded_sniff = &sniff;
+  bool is_vdrfile = loaded_sniff && sniff.format == VdrFileFormat::kDataMonitor;
+  // Compressed recordings are unpacked and checked by LoadFile().
+  bool is_gzip = loaded_sniff && sniff.format == VdrFileFormat::kGzip;
   if (m_record_play_mgr->IsUsingLoopback()) {
-    if (!is_vdrfile)
+    if (!is_vdrfile && !is_gzip)
       OCPNMessageBox_PlugIn(GetOCPNCanvasWindow(), kBadVdrFormat);
-  } else {
-    if (is_vdrfile)
+  } else if (is_vdrfile) {
+    int answer = OCPNMessageBox_PlugIn(
+        GetOCPNCanvasWindow(), kConvertNonVdrFormat, _("VDR"), wxYES_NO);
+    if (answer == wxID_YES) {
+      wxString converted = ConvertDataMonitorFile(file);
+      if (converted.IsEmpty()) {
+        OCPNMessageBox_PlugIn(GetOCPNCanvasWindow(), kConvertFailed);
+        return;
+      }
+      file = converted;
+      loaded_sniff = nullptr;
+    } else {
       OCPNMessageBox_PlugIn(GetOCPNCanvasWindow(), kBadNonVdrFormat);
+    }
   }
-  LoadFile(file);
+  LoadFile(file, loaded_sniff);
+}
+
+wxString VdrControl::ConvertDataMonitorFile(const wxString& path) {
+  wxFileName fn(path);
+  fn.SetName(fn.GetName() + "-vdr");
+  fn.SetExt("csv");
+  const wxString dest = fn.GetFullPath();
+
+  // Messages are logged from worker threads, which wxLog handles.
+  DataMonitorConverter converter(
+      ToFilePath(path), ToFilePath(dest),
+      [](VdrMsgType type, const std::string& msg) {
+        if (type != VdrMsgType::kDebug) wxLogMessage("%s", msg.c_str());
+      });
+  converter.Start();
+  wxProgressDialog progress(
+      _("Converting Data Monitor log"), fn.GetFullName(), 1000,
+      GetOCPNCanvasWindow(),
+      wxPD_APP_MODAL | wxPD_CAN_ABORT | wxPD_AUTO_HIDE | wxPD_ELAPSED_TIME);
+  while (!converter.IsDone()) {
+    if (!progress.Update(static_cast<int>(converter.GetProgress() * 999))) {
+      converter.Cancel();
+    }
+    wxMilliSleep(100);
+  }
+  if (!converter.IsOk()) return "";
+  wxLogMessage("Converted %s to %s, %llu records, %llu skipped", path, dest,
+               static_cast<unsigned long long>(converter.GetConverted()),
+               static_cast<unsigned long long>(converter.GetSkipped()));
+  return dest;
 }
 
 void VdrControl::OnProgressSliderUpdated(wxScrollWinEvent& event) {
@@ -418,6 +491,43 @@ void VdrControl::OnSettingsButton(wxCommandEvent& event) {
   event.Skip();
 }
 
+void VdrControl::OnStatsButton(wxCommandEvent& event) {
+  wxDialog dialog(this, wxID_ANY, _("Replay Timing Statistics"),
+                  wxDefaultPosition, wxDefaultSize,
+                  wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER);
+  auto* sizer = new wxBoxSizer(wxVERTICAL);
+  auto* text = new wxTextCtrl(
+      &dialog, wxID_ANY, m_record_play_mgr->GetReplayStatsSummary(),
+      wxDefaultPosition, wxSize(480, 120), wxTE_MULTILINE | wxTE_READONLY);
+  sizer->Add(text, 1, wxEXPAND | wxALL, 5);
+
+  auto* button_sizer = new wxBoxSizer(wxHORIZONTAL);
+  auto* refresh_btn = new wxButton(&dialog, wxID_REFRESH);
+  refresh_btn->Bind(wxEVT_BUTTON, [&](wxCommandEvent&) {
+    text->SetValue(m_record_play_mgr->GetReplayStatsSummary());
+  });
+  button_sizer->Add(refresh_btn, 0, wxALL, 5);
+
+  auto* export_btn = new wxButton(&dialog, wxID_ANY, _("Export JSON..."));
+  export_btn->Bind(wxEVT_BUTTON, [&](wxCommandEvent&) {
+    wxFileDialog file_dialog(&dialog, _("Export Timing Statistics"), "",
+                             "replay_timing.json", "JSON (*.json)|*.json",
+                             wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+    if (file_dialog.ShowModal() != wxID_OK) return;
+    if (!m_record_play_mgr->ExportReplayStats(file_dialog.GetPath())) {
+      OCPNMessageBox_PlugIn(&dialog, _("Failed to write file."),
+                            _("VDR Plugin"), wxOK | wxICON_ERROR);
+    }
+  });
+  button_sizer->Add(export_btn, 0, wxALL, 5);
+  button_sizer->Add(new wxButton(&dialog, wxID_CLOSE), 0, wxALL, 5);
+  dialog.SetEscapeId(wxID_CLOSE);
+  sizer->Add(button_sizer, 0, wxALIGN_RIGHT);
+
+  dialog.SetSizerAndFit(sizer);
+  dialog.ShowModal();
+}
+
 void VdrControl::OnSpeedSliderUpdated(wxCommandEvent& event) {
   if (m_record_play_mgr->IsPlaying()) {
     m_record_play_mgr->AdjustPlaybackBaseTime();
@@ -129,6 +129,9 @@ private:
   /** Handle left-click on Settings button. */
   void OnSettingsButton(wxCommandEvent& event);
 
+  /** Show replay timing statistics with an option to export them. */
+  void OnStatsButton(wxCommandEvent& event);
+
   /**
    * Start playback of loaded VDR file and update status.
    */
@@ -144,11 +147,24 @@ private:
    */
   void StopPlayback();
 
-  bool LoadFile(const wxString& current_file);
+  /**
+   * Load playback file and update status.
+   * @param sniff Format and head of file if already read, else nullptr.
+   */
+  bool LoadFile(const wxString& current_file,
+                const FileSniff* sniff = nullptr);
+
+  /**
+   * Convert Data Monitor log to a VDR CSV recording next to it in a
+   * background task, showing progress.
+   * @return Path to converted file, empty on errors or if cancelled.
+   */
+  wxString ConvertDataMonitorFile(const wxString& path);
 
   wxButton* m_load_btn;          //!< Button to load VDR file
   wxButton* m_settings_btn;      //!< Button to open settings dialog
   wxButton* m_play_pause_btn;    //!< Toggle button for play/pause
+  wxButton* m_stats_btn;         //!< Button to show timing statistics
   wxString m_play_btn_tooltip;   //!< Tooltip text for play state
   wxString m_pause_btn_tooltip;  //!< Tooltip text for pause state
   wxString m_stop_btn_tooltip;   //!< Tooltip text for stop state
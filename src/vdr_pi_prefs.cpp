@@ -126,11 +126,11 @@ wxPanel* VdrPrefsDialog::CreateRecordingTab(wxWindow* parent) {
                          [&](wxCommandEvent ev) { OnProtocolCheck(ev); });
   protocol_sizer->Add(m_nmea2000_check, 0, wxALL, 5);
 
-#if 0
-  m_signalKCheck = new wxCheckBox(panel, kSignalkCheckId, _("Signal K"));
+  m_signalKCheck = new wxCheckBox(panel, wxID_ANY, _("Signal K"));
   m_signalKCheck->SetValue(m_protocols.signalK);
+  m_signalKCheck->Bind(wxEVT_CHECKBOX,
+                       [&](wxCommandEvent ev) { OnProtocolCheck(ev); });
   protocol_sizer->Add(m_signalKCheck, 0, wxALL, 5);
-#endif
 
   main_sizer->Add(protocol_sizer, 0, wxEXPAND | wxALL, 5);
 
@@ -303,11 +303,32 @@ wxPanel* VdrPrefsDialog::CreateReplayTab(wxWindow* parent) {
                                ReplayMode::kLoopback);
   main_sizer->Add(m_nmea2000_net_panel, 0, wxEXPAND | wxALL, 5);
 
-#if 0  // Signal K support disabled for now
+  // NMEA 2000 output framing, same order as N2kNetFormat
+  auto* n2k_format_sizer = new wxBoxSizer(wxHORIZONTAL);
+  n2k_format_sizer->Add(
+      new wxStaticText(panel, wxID_ANY, _("NMEA 2000 output format:")), 0,
+      wxALIGN_CENTER_VERTICAL | wxRIGHT, 5);
+  wxArrayString n2k_formats;
+  n2k_formats.Add(_("As recorded (text)"));
+  n2k_formats.Add(_("Actisense N2K binary"));
+  n2k_formats.Add(_("YD RAW"));
+  n2k_formats.Add(_("SocketCAN frames"));
+  m_n2k_format_choice = new wxChoice(panel, wxID_ANY, wxDefaultPosition,
+                                     wxDefaultSize, n2k_formats);
+  m_n2k_format_choice->SetSelection(static_cast<int>(m_protocols.n2k_format));
+  m_n2k_format_choice->Enable(m_protocols.replay_mode != ReplayMode::kLoopback);
+  n2k_format_sizer->Add(m_n2k_format_choice, 0, wxALIGN_CENTER_VERTICAL);
+  main_sizer->Add(n2k_format_sizer, 0, wxEXPAND | wxALL, 5);
+
   m_signalKNetPanel = new ConnectionSettingsPanel(panel, _("Signal K"),
-                                              m_protocols.signalkNet);
+                                                  m_protocols.signalkNet);
+  m_signalKNetPanel->Enable(m_protocols.replay_mode != ReplayMode::kLoopback);
   main_sizer->Add(m_signalKNetPanel, 0, wxEXPAND | wxALL, 5);
-#endif
+
+  m_relay_check = new wxCheckBox(
+      panel, wxID_ANY, _("Relay live data to enabled servers while recording"));
+  m_relay_check->SetValue(m_protocols.relay_while_recording);
+  main_sizer->Add(m_relay_check, 0, wxALL, 5);
 
   panel->SetSizer(main_sizer);
 
@@ -327,16 +348,15 @@ void VdrPrefsDialog::OnOK(wxCommandEvent& event) {
   // Protocol settings
   m_protocols.nmea0183 = m_nmea0183_check->GetValue();
   m_protocols.nmea2000 = m_nmea2000_check->GetValue();
-#if 0
   m_protocols.signalK = m_signalKCheck->GetValue();
-#endif
 
   // Network settings
   m_protocols.nmea0183Net = m_nmea0183_net_panel->GetSettings();
   m_protocols.n2kNet = m_nmea2000_net_panel->GetSettings();
-#if 0
+  m_protocols.n2k_format =
+      static_cast<N2kNetFormat>(m_n2k_format_choice->GetSelection());
   m_protocols.signalkNet = m_signalKNetPanel->GetSettings();
-#endif
+  m_protocols.relay_while_recording = m_relay_check->GetValue();
   if (m_nmea0183_internal_radio->GetValue())
     m_protocols.replay_mode = ReplayMode::kInternalApi;
   else if (m_nmea0183_loopback_radio->GetValue())
@@ -373,4 +393,6 @@ void VdrPrefsDialog::OnUseSpeedThresholdCheck(wxCommandEvent& event) {
 void VdrPrefsDialog::OnNMEA0183ReplayModeChanged(wxCommandEvent& event) {
   m_nmea0183_net_panel->Enable(event.GetId() == kNetworkRadioId);
   m_nmea2000_net_panel->Enable(event.GetId() != kLoopbackRadioId);
+  m_n2k_format_choice->Enable(event.GetId() != kLoopbackRadioId);
+  m_signalKNetPanel->Enable(event.GetId() != kLoopbackRadioId);
 }
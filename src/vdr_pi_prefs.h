@@ -25,6 +25,7 @@
 
 #include <wx/button.h>
 #include <wx/checkbox.h>
+#include <wx/choice.h>
 #include <wx/dialog.h>
 #include <wx/event.h>
 #include <wx/panel.h>
@@ -151,9 +152,7 @@ private:
   // Protocol selection
   wxCheckBox* m_nmea0183_check;  //!< Enable NMEA 0183 recording
   wxCheckBox* m_nmea2000_check;  //!< Enable NMEA 2000 recording
-#if 0
-   wxCheckBox* m_signalKCheck;      //!< Enable Signal K recording
-#endif
+  wxCheckBox* m_signalKCheck;    //!< Enable Signal K recording
 
   // Replay tab controls
   // NMEA 0183 replay mode
@@ -164,9 +163,9 @@ private:
   // Network selection
   ConnectionSettingsPanel* m_nmea0183_net_panel;
   ConnectionSettingsPanel* m_nmea2000_net_panel;
-#if 0
+  wxChoice* m_n2k_format_choice;  //!< NMEA 2000 network output framing
+  wxCheckBox* m_relay_check;      //!< Relay live data while recording
   ConnectionSettingsPanel* m_signalKNetPanel;
-#endif
 
   VdrDataFormat m_format;       //!< Selected data format
   wxString m_recording_dir;     //!< Selected recording directory
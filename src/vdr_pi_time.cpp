@@ -122,8 +122,79 @@ bool TimestampParser::ParseIso8601Timestamp(const wxString& time_str,
   return ret;
 }
 
+/** Return value of hex digit c, -1 if not a hex digit. */
+static int HexValue(wchar_t c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+bool TimestampParser::ParseTagBlock(const wxString& line, TagBlock& tag) {
+  tag = TagBlock();
+  const size_t len = line.length();
+  if (len < 2 || line[0] != '\\') return false;
+
+  // Find end of block and checksum of parameters, up to the '*'.
+  size_t star = 0;
+  size_t end = 1;
+  int checksum = 0;
+  for (; end < len; end++) {
+    const wchar_t c = line[end];
+    if (c == '\\') break;
+    if (c == '*' && star == 0) star = end;
+    if (star == 0) checksum ^= c;
+  }
+  if (end == len) return false;
+  tag.length = end + 1;
+  if (star == 0) {
+    star = end;  // Checksum is optional
+  } else {
+    const int high = end - star == 3 ? HexValue(line[star + 1]) : -1;
+    const int low = end - star == 3 ? HexValue(line[star + 2]) : -1;
+    if (high < 0 || low < 0 || high * 16 + low != checksum) return true;
+  }
+
+  // Look for c:<digits> among the comma separated parameters.
+  for (size_t i = 1; i + 2 < star; i++) {
+    if ((i == 1 || line[i - 1] == ',') && line[i] == 'c' &&
+        line[i + 1] == ':') {
+      uint64_t value = 0;
+      size_t digits = 0;
+      for (i += 2; i < star && line[i] != ','; i++, digits++) {
+        const wchar_t c = line[i];
+        if (c < '0' || c > '9' || digits >= 18) return true;
+        value = 10 * value + (c - '0');
+      }
+      if (digits == 0) return true;
+      tag.has_time = true;
+      tag.precision = digits > 11 ? 3 : 0;
+      tag.ms = digits > 11 ? value : 1000 * value;
+      return true;
+    }
+  }
+  return true;
+}
+
 bool TimestampParser::ParseTimestamp(const wxString& sentence,
                                      wxDateTime& timestamp, int& precision) {
+  // Fast path, no need to look at the sentence if the tag block has a time.
+  TagBlock tag;
+  if (ParseTagBlock(sentence, tag)) {
+    const bool use_tag = !m_use_only_primary_source ||
+                         (m_primary_source.talker_id.IsEmpty() &&
+                          m_primary_source.sentence_id == kTagBlockSource);
+    if (!tag.has_time || !use_tag) {
+      return ParseTimestamp(sentence.Mid(tag.length), timestamp, precision);
+    }
+    // Same representation as times parsed from text below.
+    timestamp.Set(static_cast<time_t>(tag.ms / 1000));
+    timestamp.SetMillisecond(static_cast<unsigned short>(tag.ms % 1000));
+    timestamp.MakeUTC();
+    precision = tag.precision;
+    return true;
+  }
+
   // Check for valid NMEA sentence
   if (sentence.IsEmpty() || sentence[0] != '$') {
     return false;
@@ -19,6 +19,8 @@
 #ifndef VDR_PI_TIME_H_
 #define VDR_PI_TIME_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 #include <wx/wxprec.h>
@@ -40,6 +42,16 @@ struct NmeaTimeInfo {
   [[nodiscard]] bool IsComplete() const { return has_date && has_time; }
 };
 
+/** A NMEA 4.x tag block such as \\c:1736157600123*6F\\ prefixing a sentence. */
+struct TagBlock {
+  size_t length;  //!< Length including both backslashes, 0 if none
+  bool has_time;  //!< True if a valid c: parameter was found
+  uint64_t ms;    //!< c: time, ms since 1/1 1970 UTC
+  int precision;  //!< Millisecond precision, 3 if c: is in ms, else 0
+
+  TagBlock() : length(0), has_time(false), ms(0), precision(0) {}
+};
+
 /**
  * Represents a unique source of time information from NMEA sentences or CSV
  * entry. This is used to track the time source for each NMEA sentence type.
@@ -65,13 +77,17 @@ struct TimeSource {
  */
 class TimestampParser {
 public:
+  /** TimeSource sentence_id of tag block times, talker_id is empty. */
+  static constexpr const char* kTagBlockSource = "\\c";
+
   TimestampParser()
       : m_last_valid_year(0), m_last_valid_month(0), m_last_valid_day(0) {}
   /**
    * Parse a timestamp from a NMEA 0183 sentence.
    *
    * This method supports parsing timestamps from RMC, ZDA, and other sentence
-   * types.
+   * types. A receive time in a leading tag block is used ahead of any time in
+   * the sentence itself, without parsing the sentence.
    *
    * @param sentence NMEA 0183 sentence to parse.
    * @param timestamp Output timestamp.
@@ -92,6 +108,15 @@ public:
   static bool ParseIso8601Timestamp(const wxString& time_str,
                                     wxDateTime* timestamp);
 
+  /**
+   * Parse tag block at start of line. The c: parameter is UNIX time in
+   * seconds, or in milliseconds as written by the VDR plugin; values with
+   * more than 11 digits are taken as milliseconds. A block with a bad
+   * checksum is reported without time.
+   * @return false if line does not start with a complete tag block.
+   */
+  static bool ParseTagBlock(const wxString& line, TagBlock& tag);
+
   // Reset the cached date state
   void Reset();
 
@@ -45,6 +45,13 @@ void ClearNMEASentences() { g_nmea_sentences.clear(); }
 
 const std::vector<wxString> &GetNMEASentences() { return g_nmea_sentences; }
 
+// Payloads written using WriteCommDriver()
+static std::vector<std::string> g_driver_writes;
+
+void ClearDriverWrites() { g_driver_writes.clear(); }
+
+const std::vector<std::string> &GetDriverWrites() { return g_driver_writes; }
+
 // Plugin API mock implementations
 extern "C" {
 
@@ -124,6 +131,16 @@ std::shared_ptr<ObservableListener> DECL_EXP GetListener(NMEA2000Id id,
   return std::make_shared<ObservableListener>(id.id, eh, et);
 }
 
+std::shared_ptr<ObservableListener> DECL_EXP GetListener(SignalkId id,
+                                                         wxEventType et,
+                                                         wxEvtHandler *eh) {
+  return std::make_shared<ObservableListener>(0, eh, et);
+}
+
+std::shared_ptr<void> DECL_EXP GetSignalkPayload(ObservedEvt /* ev */) {
+  return nullptr;  // Tests record deltas through RecordSignalKDelta()
+}
+
 std::string DECL_EXP GetN2000Source(NMEA2000Id /* id */,
                                     ObservedEvt /* evt */) {
   return std::string("MockSource");
@@ -179,5 +196,6 @@ std::vector<DriverHandle> GetActiveDrivers() { return {}; }
 
 CommDriverResult WriteCommDriver(
     DriverHandle handle, const std::shared_ptr<std::vector<uint8_t>> &payload) {
+  g_driver_writes.emplace_back(payload->begin(), payload->end());
   return static_cast<CommDriverResult>(0);
 }
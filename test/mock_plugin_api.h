@@ -19,6 +19,7 @@
 #define _VDR_MOCK_PLUGIN_API_H_
 
 #include "ocpn_plugin.h"
+#include <string>
 #include <vector>
 #include <wx/string.h>
 
@@ -26,6 +27,10 @@
 void ClearNMEASentences();
 const std::vector<wxString>& GetNMEASentences();
 
+// Functions to access payloads passed to WriteCommDriver()
+void ClearDriverWrites();
+const std::vector<std::string>& GetDriverWrites();
+
 // Base mock plugin class implementing all virtual functions with empty
 // implementations
 class mock_plugin_base : public opencpn_plugin_118 {
@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include <cstring>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "n2k_encoder.h"
+
+static N2kMessage MakeMessage(uint32_t pgn, size_t data_len) {
+  N2kMessage msg;
+  msg.pgn = pgn;
+  msg.priority = 2;
+  msg.source = 0x23;
+  msg.data_len = static_cast<uint8_t>(data_len);
+  for (size_t i = 0; i < data_len; i++) msg.data[i] = static_cast<uint8_t>(i);
+  return msg;
+}
+
+/** Test decoding of SeaSmart $PCDIN sentences. */
+TEST(N2kEncoderTest, ParseSeaSmartPcdin) {
+  const char* line = "$PCDIN,01F801,00000000,0F,2AAF00D1067414FF*59\r\n";
+  N2kMessage msg;
+  ASSERT_TRUE(ParsePcdin(line, std::strlen(line), msg));
+  EXPECT_EQ(msg.pgn, 129025u);
+  EXPECT_EQ(msg.source, 0x0F);
+  ASSERT_EQ(msg.data_len, 8);
+  EXPECT_EQ(msg.data[0], 0x2A);
+  EXPECT_EQ(msg.data[7], 0xFF);
+}
+
+/** Test decoding of $PCDIN lines written by raw VDR recordings. */
+TEST(N2kEncoderTest, ParseVdrRawPcdin) {
+  // 0x93, len, prio 3, PGN 127250, dst 255, src 0x11, ts, 3 data bytes
+  std::string line = "$PCDIN,127250,93" "0E" "03" "12F101" "FF" "11"
+                     "00000000" "03" "0A0B0C";
+  N2kMessage msg;
+  ASSERT_TRUE(ParsePcdin(line.c_str(), line.size(), msg));
+  EXPECT_EQ(msg.pgn, 127250u);
+  EXPECT_EQ(msg.priority, 3);
+  EXPECT_EQ(msg.destination, 255);
+  EXPECT_EQ(msg.source, 0x11);
+  ASSERT_EQ(msg.data_len, 3);
+  EXPECT_EQ(msg.data[2], 0x0C);
+
+  line = "$PCDIN,127250,93ZZ";
+  EXPECT_FALSE(ParsePcdin(line.c_str(), line.size(), msg));
+  line = "$GPRMC,1,2";
+  EXPECT_FALSE(ParsePcdin(line.c_str(), line.size(), msg));
+}
+
+/** Test Actisense framing, checksum and DLE escaping. */
+TEST(N2kEncoderTest, ActisenseFraming) {
+  N2kEncoder encoder(N2kNetFormat::kActisense);
+  N2kMessage msg = MakeMessage(129025, 8);
+  msg.data[3] = 0x10;  // DLE in payload must be doubled
+  const std::vector<uint8_t>& out = encoder.Encode(msg, 0);
+
+  ASSERT_GE(out.size(), 4u);
+  EXPECT_EQ(out[0], 0x10);
+  EXPECT_EQ(out[1], 0x02);
+  EXPECT_EQ(out[2], 0x93);
+  EXPECT_EQ(out[3], 11 + 8);
+  EXPECT_EQ(out[out.size() - 2], 0x10);
+  EXPECT_EQ(out[out.size() - 1], 0x03);
+
+  // Unescape body and verify checksum sums to zero.
+  std::vector<uint8_t> body;
+  for (size_t i = 2; i < out.size() - 2; i++) {
+    body.push_back(out[i]);
+    if (out[i] == 0x10) {
+      ASSERT_EQ(out[i + 1], 0x10);
+      i++;
+    }
+  }
+  EXPECT_EQ(body.size(), 2u + 11 + 8 + 1);
+  uint8_t sum = 0;
+  for (uint8_t b : body) sum += b;
+  EXPECT_EQ(sum, 0);
+}
+
+/** Test YD RAW output of a single frame message. */
+TEST(N2kEncoderTest, YdRawSingleFrame) {
+  N2kEncoder encoder(N2kNetFormat::kYdRaw);
+  N2kMessage msg = MakeMessage(129025, 8);
+  const uint32_t ms = ((12 * 60 + 34) * 60 + 56) * 1000 + 789;
+  const std::vector<uint8_t>& out = encoder.Encode(msg, ms);
+  std::string line(out.begin(), out.end());
+  EXPECT_EQ(line, "12:34:56.789 R 09F80123 00 01 02 03 04 05 06 07\r\n");
+}
+
+/** Test that fast packets are split into the expected SocketCAN frames. */
+TEST(N2kEncoderTest, SocketCanFastPacket) {
+  N2kEncoder encoder(N2kNetFormat::kSocketCan);
+  N2kMessage msg = MakeMessage(129029, 43);
+  const std::vector<uint8_t>& out = encoder.Encode(msg, 0);
+
+  // 6 bytes in first frame, 7 in the following: 1 + ceil(37 / 7) = 7
+  ASSERT_EQ(out.size(), 7u * 16);
+  uint32_t can_id = out[0] | out[1] << 8 | out[2] << 16 |
+                    static_cast<uint32_t>(out[3]) << 24;
+  EXPECT_EQ(can_id, 0x80000000u | 0x09F80523u);
+  EXPECT_EQ(out[4], 8);
+  EXPECT_EQ(out[8] & 0x1F, 0);   // frame index
+  EXPECT_EQ(out[9], 43);         // total length
+  EXPECT_EQ(out[16 + 8] & 0x1F, 1);
+  EXPECT_EQ(out[8] & 0xE0, out[16 + 8] & 0xE0);  // same sequence id
+
+  // Next message uses a new sequence id, buffer is reused.
+  const uint8_t seq = out[8] & 0xE0;
+  encoder.Encode(msg, 0);
+  EXPECT_NE(out[8] & 0xE0, seq);
+}
+
+/** Text format leaves the sentence to the caller. */
+TEST(N2kEncoderTest, TextFormatIsEmpty) {
+  N2kEncoder encoder(N2kNetFormat::kText);
+  N2kMessage msg = MakeMessage(129025, 8);
+  EXPECT_TRUE(encoder.Encode(msg, 0).empty());
+}
@@ -21,6 +21,8 @@
 #include "wx/wx.h"
 #endif  // precompiled headers
 #include "wx/tokenzr.h"
+#include "wx/wfstream.h"
+#include "wx/zstream.h"
 
 #include <gtest/gtest.h>
 #include "vdr_pi_time.h"
@@ -75,12 +77,6 @@ class TestableRecordPlayMgr : public RecordPlayMgr {
     return GetTimeSources();
   }
 
-  wxString TestGetNextNonEmptyLine(bool fromStart = false) {
-    return GetNextNonEmptyLine(fromStart);
-  }
-
-  void TestFlushSentenceBuffer() { FlushSentenceBuffer(); }
-
   void TestSetRecordingDir(wxString dir) { SetRecordingDir(dir); }
 };
 
@@ -147,9 +143,6 @@ class PlaybackNoTimestampsApp : public wxAppConsole {
     // Wait a bit more to ensure any pending timer events are processed.
     wxMilliSleep(100);
 
-    // Flush buffer to ensure PushNMEABuffer() has been called for each message.
-    record_play_mgr.TestFlushSentenceBuffer();
-
     // Get sentences sent to NMEA buffer, obtained from mock interface.
     const auto& sentences = GetNMEASentences();
 
@@ -232,9 +225,6 @@ class PlaybackTimestampsApp : public wxAppConsole {
     // Wait a bit more to ensure any pending timer events are processed.
     wxMilliSleep(100);
 
-    // Flush buffer to ensure PushNMEABuffer() has been called for each message.
-    record_play_mgr.TestFlushSentenceBuffer();
-
     // Get sentences sent to NMEA buffer, obtained from mock interface.
     const auto& sentences = GetNMEASentences();
 
@@ -325,9 +315,6 @@ class PlaybackCsvFileApp : public wxAppConsole {
     // Wait a bit more to ensure any pending timer events are processed.
     wxMilliSleep(100);
 
-    // Flush buffer to ensure PushNMEABuffer() has been called for each message.
-    record_play_mgr.TestFlushSentenceBuffer();
-
     // Get sentences sent to NMEA buffer, obtained from mock interface.
     const auto& sentences = GetNMEASentences();
 
@@ -606,6 +593,42 @@ TEST(VDRPluginTests, LoadFileErrors) {
   wxLog::EnableLogging(true);
 }
 
+TEST(VDRPluginTests, LoadCompressedFile) {
+  wxLog::SetLogLevel(wxLOG_Error);
+  VdrPi plugin(nullptr);
+  MockControlGui control_gui;
+  TestableRecordPlayMgr record_play_mgr(&plugin, &control_gui);
+
+  // Compress a test file as done by the CompressRecordings option.
+  wxString testfile = wxString(TESTDATA) + wxString("/with_timestamps.txt");
+  wxString gzfile = wxString(CMAKE_BINARY_DIR) + "/with_timestamps.txt.gz";
+  {
+    wxFileInputStream input(testfile);
+    wxFileOutputStream output(gzfile);
+    wxZlibOutputStream zlib(output, wxZ_DEFAULT_COMPRESSION, wxZLIB_GZIP);
+    zlib.Write(input);
+    ASSERT_TRUE(zlib.Close());
+  }
+  ASSERT_TRUE(record_play_mgr.LoadFile(gzfile)) << "Failed to load gzip file";
+  EXPECT_EQ(record_play_mgr.GetInputFile(), gzfile);
+  bool hasValidTimestamps;
+  wxString error;
+  EXPECT_TRUE(record_play_mgr.ScanFileTimestamps(hasValidTimestamps, error))
+      << wxString::Format("Failed to scan timestamps: %s", error);
+  EXPECT_TRUE(hasValidTimestamps);
+
+  // Truncated gzip data is rejected.
+  {
+    wxFileOutputStream output(gzfile);
+    output.Write("\x1f\x8b\x08\x00", 4);
+  }
+  wxLog::EnableLogging(false);
+  EXPECT_FALSE(record_play_mgr.LoadFile(gzfile, &error));
+  EXPECT_FALSE(error.IsEmpty());
+  wxLog::EnableLogging(true);
+  wxRemoveFile(gzfile);
+}
+
 TEST(VDRPluginTests, HandleFileWithoutTimestamps) {
   wxLog::SetLogLevel(wxLOG_Error);
   VdrPi plugin(nullptr);
@@ -673,25 +696,24 @@ TEST(VDRPluginTests, PlaybackCsvFile) {
 
 TEST(VDRPluginTests, CommentLineHandling) {
   wxLog::SetLogLevel(wxLOG_Error);
-  VdrPi plugin(nullptr);
-  MockControlGui control_gui;
-  TestableRecordPlayMgr record_play_mgr(&plugin, &control_gui);
-
-  wxString testfile = wxString(TESTDATA) + wxString("/data_with_comments.txt");
-  ASSERT_TRUE(record_play_mgr.LoadFile(testfile)) << "Failed to load test file";
+  std::string testfile = std::string(TESTDATA) + "/data_with_comments.txt";
+  FileSniff sniff;
+  ASSERT_TRUE(SniffFile(testfile, sniff)) << "Failed to sniff test file";
+  RawNmeaDecoder decoder(sniff);
+  ASSERT_TRUE(decoder.Open(0)) << "Failed to open test file";
 
   // Test reading from start
-  wxString line = record_play_mgr.TestGetNextNonEmptyLine(true);
-  EXPECT_TRUE(line.StartsWith("$GPRMC"))
-      << "Expected first NMEA line, got: " << line;
+  ReplayRecord record;
+  ASSERT_TRUE(decoder.Read(record));
+  EXPECT_EQ(record.msg.text.rfind("$GPRMC", 0), 0u)
+      << "Expected first NMEA line, got: " << record.msg.text;
 
   // Test reading next line
-  line = record_play_mgr.TestGetNextNonEmptyLine();
-  EXPECT_TRUE(line.StartsWith("$IIRMC"))
-      << "Expected second NMEA line, got: " << line;
+  ASSERT_TRUE(decoder.Read(record));
+  EXPECT_EQ(record.msg.text.rfind("$IIRMC", 0), 0u)
+      << "Expected second NMEA line, got: " << record.msg.text;
 
-  line = record_play_mgr.TestGetNextNonEmptyLine();  // EOF.
-  EXPECT_EQ(line, "") << "Expected empty line, got: " << line;
+  EXPECT_FALSE(decoder.Read(record)) << "Expected EOF";
 }
 
 TEST(VDRPluginTests, PlaybackNonChronologicalTimestamps) {
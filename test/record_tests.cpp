@@ -29,7 +29,13 @@
 #include "vdr_pi_time.h"
 #include "vdr_pi.h"
 #include "mock_plugin_api.h"
+#include "n2k_ingest.h"
+#include "pre_record_buffer.h"
+#include "record_clock.h"
+#include "record_decimator.h"
+#include "record_dedup.h"
 #include "record_play_mgr.h"
+#include "record_writer.h"
 
 #include <wx/dir.h>
 #include <wx/file.h>
@@ -37,6 +43,11 @@
 #include <wx/textfile.h>
 #include <wx/tokenzr.h>
 
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
 static bool ValidateTimestamp(const wxString& timestamp) {
   // The timestamp format from the plugin is: YYYY-MM-DDThh:mm:ss.sssZ
   // Example: 2025-02-04T12:05:36.748Z
@@ -55,13 +66,19 @@ class TestableRecordPlayMgr : public RecordPlayMgr {
   TestableRecordPlayMgr(opencpn_plugin* parent, VdrControlGui* control_gui)
       : RecordPlayMgr(parent, control_gui) {}
 
-  void TestStopRecording() { StopRecording(); }
+  void TestStopRecording() {
+    StopRecording();
+    WaitRecordingsClosed();
+  }
   void TestStartRecording() { StartRecording(); }
   void TestSetRecordingDir(const wxString& dir) { SetRecordingDir(dir); }
   void TestSetDataFormat(VdrDataFormat dataFormat) {
     SetDataFormat(dataFormat);
   }
   void TestSetLogRotate(bool enable) { SetLogRotate(enable); }
+  void TestRecordSignalKDelta(const wxString& delta) {
+    RecordSignalKDelta(delta);
+  }
 };
 
 class RecordRawNmeaApp : public wxAppConsole {
@@ -307,6 +324,68 @@ class RecordNmeaWithCsvApp : public wxAppConsole {
   }
 };
 
+class RecordSignalKWithCsvApp : public wxAppConsole {
+public:
+  RecordSignalKWithCsvApp() : wxAppConsole() {}
+
+  void Run() {
+    wxLog::SetLogLevel(wxLOG_Error);
+    wxString tempDir = wxFileName::GetTempDir();
+    wxString uniqueId = wxDateTime::Now().Format("%Y%m%d%H%M%S") +
+                        wxString::Format("%d", rand());
+    wxString testDir = tempDir + "/vdr_test_" + uniqueId;
+    ASSERT_TRUE(wxFileName::Mkdir(testDir))
+        << "Failed to create directory: " << testDir;
+
+    VdrPi plugin(nullptr);
+    MockControlGui control_gui;
+    TestableRecordPlayMgr record_play_mgr(&plugin, &control_gui);
+    record_play_mgr.TestSetRecordingDir(CMAKE_BINARY_DIR);
+    record_play_mgr.Init();
+
+    record_play_mgr.TestSetRecordingDir(testDir);
+    record_play_mgr.TestSetDataFormat(VdrDataFormat::kCsv);
+    record_play_mgr.TestSetLogRotate(false);
+    record_play_mgr.TestStartRecording();
+    ASSERT_TRUE(record_play_mgr.IsRecording()) << "Recording should be active";
+
+    // Compact delta with quotes and commas which must survive CSV escaping.
+    wxString delta(
+        "{\"context\":\"vessels.self\",\"updates\":[{\"timestamp\":"
+        "\"2025-02-04T12:05:36.748Z\",\"values\":[{\"path\":"
+        "\"navigation.speedOverGround\",\"value\":3.85}]}]}");
+    record_play_mgr.TestRecordSignalKDelta(delta);
+    record_play_mgr.TestStopRecording();
+
+    wxArrayString files;
+    wxDir dir(testDir);
+    ASSERT_TRUE(dir.GetAllFiles(testDir, &files, "vdr_*.csv"))
+        << "Failed to find recording files";
+    ASSERT_EQ(files.size(), 1) << "Expected one recording file";
+
+    wxTextFile file;
+    ASSERT_TRUE(file.Open(files[0])) << "Failed to open file: " << files[0];
+    EXPECT_EQ(file.GetFirstLine(), "timestamp,type,id,message");
+    wxString line = file.GetNextLine();
+
+    // Replay parses the line back into the identical delta.
+    wxString type;
+    wxString message;
+    wxDateTime timestamp;
+    EXPECT_TRUE(TimestampParser::ParseCsvLineTimestamp(line, 0, 1, &type,
+                                                       &timestamp));
+    EXPECT_EQ(type, "SignalK");
+    EXPECT_TRUE(timestamp.IsValid());
+    EXPECT_TRUE(
+        TimestampParser::ParseCsvLineTimestamp(line, 0, 3, &message, nullptr));
+    EXPECT_EQ(message, delta);
+
+    file.Close();
+    record_play_mgr.DeInit();
+    wxDir::Remove(testDir, wxPATH_RMDIR_RECURSIVE);
+  }
+};
+
 /** Test recording NMEA 0183 data in raw NMEA format. */
 TEST(VDRRecordTests, RecordRawNMEA) {
   RecordRawNmeaApp app;
@@ -319,4 +398,394 @@ TEST(VDRRecordTests, RecordNMEAWithCSV) {
   app.Run();
 }
 
+/** Test recording Signal K deltas in CSV format. */
+TEST(VDRRecordTests, RecordSignalKWithCSV) {
+  RecordSignalKWithCsvApp app;
+  app.Run();
+}
+
+/** Test the buffer of messages kept before auto recording starts. */
+TEST(VDRRecordTests, PreRecordBuffer) {
+  using std::chrono::seconds;
+  PreRecordBuffer buffer;
+  std::string out;
+  auto writer = [&out](const char* data, size_t len) { out.append(data, len); };
+  const PreRecordBuffer::Clock::time_point start;
+  buffer.Push("a\n", 2, start);
+  EXPECT_FALSE(buffer.IsEnabled());
+  EXPECT_EQ(buffer.GetCount(), 0u);
+
+  // Size limit, room for 128 / PreRecordBuffer::kMinMessageSize messages,
+  // wrapping around the end of the arena.
+  buffer.SetLimits(seconds(10), 128);
+  for (int i = 0; i < 20; i++) {
+    const std::string line = "line " + std::to_string(i) + "\n";
+    buffer.Push(line.data(), line.size(), start + seconds(1));
+  }
+  EXPECT_EQ(buffer.GetCount(), 8u);
+  buffer.Flush(writer, start + seconds(2));
+  EXPECT_EQ(out, "line 12\nline 13\nline 14\nline 15\nline 16\nline 17\n"
+                 "line 18\nline 19\n");
+  EXPECT_EQ(buffer.GetCount(), 0u);
+
+  // Time limit, both when pushing and flushing.
+  out.clear();
+  buffer.Push("old\n", 4, start);
+  buffer.Push("mid\n", 4, start + seconds(5));
+  buffer.Push("new\n", 4, start + seconds(11));
+  EXPECT_EQ(buffer.GetCount(), 2u);
+  buffer.Flush(writer, start + seconds(16));
+  EXPECT_EQ(out, "new\n");
+
+  buffer.SetLimits(seconds(0), 64);
+  EXPECT_FALSE(buffer.IsEnabled());
+}
+
+/** Test the clock stamping recorded messages. */
+TEST(VDRRecordTests, RecordClock) {
+  using std::chrono::microseconds;
+  using std::chrono::milliseconds;
+  const RecordClock::Clock::time_point mono;
+  const RecordClock::SystemClock::time_point utc(microseconds(1000000));
+  RecordClock clock;
+  EXPECT_EQ(clock.Now(mono, utc), 1000000u);
+  // Equal steady times still give unique, increasing stamps.
+  EXPECT_EQ(clock.Now(mono, utc), 1000001u);
+  EXPECT_EQ(clock.Now(mono + microseconds(10), utc), 1000010u);
+  // System clock jitter within kMaxDrift is ignored.
+  EXPECT_EQ(clock.Now(mono + milliseconds(1000), utc + milliseconds(1050)),
+            2000000u);
+  // The system clock is not used between checks.
+  EXPECT_EQ(clock.Now(mono + milliseconds(1500), utc), 2500000u);
+  // A step of the system clock is followed, also backwards.
+  EXPECT_EQ(clock.Now(mono + milliseconds(2000), utc + milliseconds(500)),
+            1500000u);
+  EXPECT_EQ(clock.Now(mono + milliseconds(2001), utc), 1501000u);
+
+  RecordClock real_clock;
+  const uint64_t first = real_clock.Now();
+  EXPECT_GT(real_clock.Now(), first);
+  const auto system_now = std::chrono::duration_cast<microseconds>(
+      RecordClock::SystemClock::now().time_since_epoch());
+  EXPECT_NEAR(static_cast<double>(first), system_now.count(), 1e6);
+}
+
+/** Test dropping of duplicate sentences. */
+TEST(VDRRecordTests, RecordDedup) {
+  RecordDedup dedup;
+  const std::string gga = "$GPGGA,123519,4807.038,N,01131.000,E,1,08*47";
+  const std::string vdm = "!AIVDM,1,1,,A,13u?etPv2;0n:dDPwUM1U1Cb069D,0*23";
+  EXPECT_FALSE(dedup.IsDuplicate(gga.data(), gga.size(), 0));
+  EXPECT_FALSE(dedup.IsDuplicate(gga.data(), gga.size(), 0));
+
+  dedup.SetWindow(std::chrono::milliseconds(500));
+  EXPECT_FALSE(dedup.IsDuplicate(gga.data(), gga.size(), 1000000));
+  EXPECT_FALSE(dedup.IsDuplicate(vdm.data(), vdm.size(), 1000000));
+  EXPECT_TRUE(dedup.IsDuplicate(vdm.data(), vdm.size(), 1010000));
+  EXPECT_TRUE(dedup.IsDuplicate(gga.data(), gga.size(), 1500000));
+  // Window is counted from first copy, a repeating sentence is kept.
+  EXPECT_FALSE(dedup.IsDuplicate(gga.data(), gga.size(), 1500001));
+  EXPECT_EQ(dedup.GetChecked(), 5u);
+  EXPECT_EQ(dedup.GetDropped(), 2u);
+
+  // Many distinct sentences overflowing the table are all kept, also a
+  // sentence differing only in its last character.
+  for (int i = 0; i < 4 * static_cast<int>(RecordDedup::kCapacity); i++) {
+    const std::string sentence = "$GPXTE," + std::to_string(i);
+    EXPECT_FALSE(
+        dedup.IsDuplicate(sentence.data(), sentence.size(), 2000000 + i));
+  }
+  std::string other = gga;
+  other.back() = '8';
+  EXPECT_FALSE(dedup.IsDuplicate(other.data(), other.size(), 3000000));
+  EXPECT_TRUE(dedup.IsDuplicate(other.data(), other.size(), 3000001));
+
+  // Sentences too long to be stored are never dropped.
+  const std::string long_text(RecordDedup::kMaxLength + 1, 'x');
+  EXPECT_FALSE(dedup.IsDuplicate(long_text.data(), long_text.size(), 3000000));
+  EXPECT_FALSE(dedup.IsDuplicate(long_text.data(), long_text.size(), 3000000));
+
+  dedup.SetWindow(std::chrono::milliseconds(0));
+  EXPECT_FALSE(dedup.IsEnabled());
+}
+
+/** Test thinning of sentences and PGNs by recording policy. */
+TEST(VDRRecordTests, RecordDecimator) {
+  RecordDecimator decimator;
+  std::string error;
+  EXPECT_FALSE(decimator.SetPolicy("GSV=x", error));
+  EXPECT_FALSE(error.empty());
+  EXPECT_FALSE(decimator.SetPolicy("GSV=1,200000=1", error));
+  EXPECT_FALSE(decimator.IsEnabled());
+  ASSERT_TRUE(
+      decimator.SetPolicy("gsv=10; GPGSA=0.5 XDR=off,127257=1", error));
+  EXPECT_TRUE(decimator.IsEnabled());
+
+  // Sentences without a rule are always kept.
+  const std::string rmc = "$GPRMC,123519,A,4807.038,N,01131.000,E,5.5,54.7";
+  EXPECT_TRUE(decimator.KeepSentence(rmc.data(), rmc.size(), 0));
+  EXPECT_TRUE(decimator.KeepSentence(rmc.data(), rmc.size(), 0));
+  const std::string xdr = "$IIXDR,C,19.5,C,AIR";
+  EXPECT_FALSE(decimator.KeepSentence(xdr.data(), xdr.size(), 0));
+
+  // Talker specific rule overrides rule for all talkers, with some slack
+  // for jitter.
+  const std::string gpgsa = "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1";
+  const std::string glgsa = "$GLGSA,A,3,65,67,,,,,,,,,,,2.5,1.3,2.1";
+  EXPECT_TRUE(decimator.KeepSentence(gpgsa.data(), gpgsa.size(), 1000000));
+  EXPECT_FALSE(decimator.KeepSentence(gpgsa.data(), gpgsa.size(), 1200000));
+  EXPECT_TRUE(decimator.KeepSentence(gpgsa.data(), gpgsa.size(), 1480000));
+  EXPECT_TRUE(decimator.KeepSentence(glgsa.data(), glgsa.size(), 1480000));
+  EXPECT_TRUE(decimator.KeepSentence(glgsa.data(), glgsa.size(), 1480000));
+
+  // All parts of a multipart sentence follow the first part.
+  const std::string gsv1 = "$GPGSV,2,1,08,01,40,083,46,02,17,308,41*78";
+  const std::string gsv2 = "$GPGSV,2,2,08,12,07,344,39,14,22,228,45*75";
+  EXPECT_TRUE(decimator.KeepSentence(gsv1.data(), gsv1.size(), 2000000));
+  EXPECT_TRUE(decimator.KeepSentence(gsv2.data(), gsv2.size(), 2000000));
+  EXPECT_FALSE(decimator.KeepSentence(gsv1.data(), gsv1.size(), 3000000));
+  EXPECT_FALSE(decimator.KeepSentence(gsv2.data(), gsv2.size(), 3000000));
+  EXPECT_TRUE(decimator.KeepSentence(gsv1.data(), gsv1.size(), 12000000));
+  EXPECT_TRUE(decimator.KeepSentence(gsv2.data(), gsv2.size(), 12000000));
+
+  // PGNs are thinned per source.
+  EXPECT_TRUE(decimator.KeepPgn(127257, 1, 0));
+  EXPECT_FALSE(decimator.KeepPgn(127257, 1, 100000));
+  EXPECT_TRUE(decimator.KeepPgn(127257, 2, 100000));
+  EXPECT_TRUE(decimator.KeepPgn(127257, 1, 1000000));
+  EXPECT_TRUE(decimator.KeepPgn(129025, 1, 1000000));
+  EXPECT_TRUE(decimator.KeepPgn(129025, 1, 1000000));
+  EXPECT_EQ(decimator.GetChecked(), 20u);
+  EXPECT_EQ(decimator.GetDropped(), 5u);
+
+  // A clock going backwards does not stop recording.
+  EXPECT_TRUE(decimator.KeepPgn(127257, 1, 500000));
+
+  ASSERT_TRUE(decimator.SetPolicy("", error));
+  EXPECT_FALSE(decimator.IsEnabled());
+  EXPECT_TRUE(decimator.KeepSentence(xdr.data(), xdr.size(), 0));
+}
+
+/** Test NMEA 2000 PGN allow list and suppression of unchanged data. */
+TEST(VDRRecordTests, N2kIngest) {
+  N2kIngest ingest;
+  EXPECT_TRUE(ingest.IsAllowed(129026));
+  EXPECT_FALSE(ingest.IsAllowed(130312));
+  EXPECT_FALSE(ingest.IsAllowed(N2kIngest::kPgnCount));
+  const size_t default_count = ingest.GetAllowedPgns().size();
+  EXPECT_EQ(default_count, 49u);
+
+  std::string error;
+  ASSERT_TRUE(ingest.SetAllowList("Default, 130312 !127257", error));
+  EXPECT_TRUE(ingest.IsAllowed(130312));
+  EXPECT_FALSE(ingest.IsAllowed(127257));
+  EXPECT_EQ(ingest.GetAllowedPgns().size(), default_count);
+  ASSERT_TRUE(ingest.SetAllowList("129025;129026", error));
+  EXPECT_EQ(ingest.GetAllowedPgns(), (std::vector<uint32_t>{129025, 129026}));
+  EXPECT_FALSE(ingest.SetAllowList("129025,999999", error));
+  EXPECT_FALSE(error.empty());
+  EXPECT_EQ(ingest.GetAllowedPgns().size(), default_count);
+
+  N2kMessage msg;
+  msg.pgn = 127505;
+  msg.source = 3;
+  msg.data_len = 8;
+  std::memset(msg.data, 0x11, msg.data_len);
+  EXPECT_TRUE(ingest.Accept(msg, 0));
+  EXPECT_TRUE(ingest.Accept(msg, 0));
+  msg.pgn = 130312;
+  EXPECT_FALSE(ingest.Accept(msg, 0));
+  msg.pgn = 127505;
+
+  // Unchanged data is recorded once per interval, per source and PGN.
+  ingest.SetRepeatInterval(std::chrono::milliseconds(10000));
+  EXPECT_TRUE(ingest.Accept(msg, 1000000));
+  EXPECT_FALSE(ingest.Accept(msg, 2000000));
+  msg.source = 4;
+  EXPECT_TRUE(ingest.Accept(msg, 2000000));
+  msg.source = 3;
+  msg.data[0] = 0x12;
+  EXPECT_TRUE(ingest.Accept(msg, 3000000));
+  EXPECT_FALSE(ingest.Accept(msg, 12000000));
+  EXPECT_TRUE(ingest.Accept(msg, 13000000));
+  // Changed destination is not a repeat, nor is a clock going backwards.
+  msg.destination = 3;
+  EXPECT_TRUE(ingest.Accept(msg, 13000000));
+  EXPECT_TRUE(ingest.Accept(msg, 1000000));
+  EXPECT_EQ(ingest.GetChecked(), 8u);
+  EXPECT_EQ(ingest.GetRepeats(), 2u);
+
+  // Many sources of a PGN, and PGNs sharing low bits, are all tracked.
+  ASSERT_TRUE(ingest.SetAllowList("126481, 127505, 128529", error));
+  ingest.Clear();
+  for (uint32_t pgn : {127505u, 127505u + 1024, 127505u - 1024}) {
+    msg.pgn = pgn;
+    for (int source = 0; source < 100; source++) {
+      msg.source = static_cast<uint8_t>(source);
+      EXPECT_TRUE(ingest.Accept(msg, 20000000));
+    }
+  }
+  for (uint32_t pgn : {127505u, 127505u + 1024, 127505u - 1024}) {
+    msg.pgn = pgn;
+    for (int source = 0; source < 100; source++) {
+      msg.source = static_cast<uint8_t>(source);
+      EXPECT_FALSE(ingest.Accept(msg, 21000000)) << pgn << " " << source;
+    }
+  }
+
+  ingest.SetRepeatInterval(std::chrono::milliseconds(0));
+  EXPECT_TRUE(ingest.Accept(msg, 1000000));
+}
+
+/** Test rotation of recording files by size and on the hour. */
+TEST(VDRRecordTests, RecordWriterRotation) {
+  using std::chrono::seconds;
+  using Clock = RecordWriter::Clock;
+  const wxString dir = wxString(CMAKE_BINARY_DIR) + "/record_writer";
+  wxFileName::Rmdir(dir, wxPATH_RMDIR_RECURSIVE);
+  ASSERT_TRUE(wxFileName::Mkdir(dir));
+
+  std::vector<Clock::time_point> starts;
+  std::vector<std::string> closed;
+  std::mutex mutex;
+  RecordWriter writer;
+  writer.SetHeader("header\n");
+  writer.SetPathFunc([&](Clock::time_point start) {
+    starts.push_back(start);
+    return (dir + "/rotated.txt").ToStdString();
+  });
+  writer.SetClosedFunc([&](const std::string& path, bool ok) {
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_TRUE(ok);
+    closed.push_back(path);
+  });
+
+  // Size limit, room for the header and 7 lines in each file.
+  RotationPolicy policy;
+  policy.max_bytes = 64;
+  writer.SetPolicy(policy);
+  const Clock::time_point start(seconds(100 * 3600 + 1800));
+  ASSERT_TRUE(writer.Open(start));
+  std::string expected;
+  for (int i = 10; i < 30; i++) {
+    const std::string line = "line " + std::to_string(i) + "\n";
+    expected += line;
+    EXPECT_TRUE(writer.Write(line.data(), line.size(), start));
+  }
+  EXPECT_EQ(writer.GetRotations(), 2u);
+  writer.Close();
+  writer.WaitIdle();
+  ASSERT_EQ(closed.size(), 3u);
+  std::string data;
+  for (const auto& path : closed) {
+    std::ifstream stream(path, std::ios::binary);
+    std::stringstream content;
+    content << stream.rdbuf();
+    ASSERT_EQ(content.str().substr(0, 7), "header\n");
+    EXPECT_LE(content.str().size(), 64u);
+    data += content.str().substr(7);
+  }
+  EXPECT_EQ(data, expected);
+  EXPECT_EQ(closed[1], (dir + "/rotated-1.txt").ToStdString());
+
+  // Hourly rotation, the next file is opened ahead and named after the hour.
+  wxFileName::Rmdir(dir, wxPATH_RMDIR_RECURSIVE);
+  ASSERT_TRUE(wxFileName::Mkdir(dir));
+  starts.clear();
+  closed.clear();
+  policy.max_bytes = 0;
+  policy.interval = seconds(3600);
+  policy.aligned = true;
+  writer.SetPolicy(policy);
+  const Clock::time_point hour(seconds(101 * 3600));
+  ASSERT_TRUE(writer.Open(start));
+  EXPECT_TRUE(writer.Write("a\n", 2, start));
+  EXPECT_TRUE(writer.Write("b\n", 2, hour - seconds(5)));
+  EXPECT_EQ(starts.size(), 2u);
+  EXPECT_TRUE(writer.Write("c\n", 2, hour));
+  EXPECT_TRUE(writer.Write("d\n", 2, hour + seconds(3599)));
+  EXPECT_TRUE(writer.Write("e\n", 2, hour + seconds(3600)));
+  writer.Close();
+  writer.WaitIdle();
+  EXPECT_EQ(writer.GetRotations(), 4u);
+  ASSERT_EQ(starts.size(), 3u);
+  EXPECT_EQ(starts[0], start);
+  EXPECT_EQ(starts[1], hour);
+  EXPECT_EQ(starts[2], hour + seconds(3600));
+  EXPECT_EQ(closed.size(), 3u);
+
+  // Tasks run after the files closed before them.
+  size_t closed_before_task = 0;
+  ASSERT_TRUE(writer.Open(hour));
+  writer.Close();
+  writer.Run([&] {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed_before_task = closed.size();
+  });
+  writer.WaitIdle();
+  EXPECT_EQ(closed_before_task, 4u);
+}
+
+/** Test checkpoints and repair of files left behind by a crash. */
+TEST(VDRRecordTests, RecordWriterRecover) {
+  using std::chrono::seconds;
+  using Clock = RecordWriter::Clock;
+  const std::string dir = CMAKE_BINARY_DIR "/record_recover";
+  const std::string path = dir + "/recording.txt";
+  const std::string checkpoint = path + RecordWriter::kCheckpointSuffix;
+  wxFileName::Rmdir(dir, wxPATH_RMDIR_RECURSIVE);
+  ASSERT_TRUE(wxFileName::Mkdir(dir));
+  auto read_file = [](const std::string& file_path) {
+    std::ifstream stream(file_path, std::ios::binary);
+    std::stringstream content;
+    content << stream.rdbuf();
+    return content.str();
+  };
+
+  // Checkpoint is updated while recording and removed when closed.
+  {
+    RecordWriter writer;
+    writer.SetPathFunc([&](Clock::time_point) { return path; });
+    writer.SetSyncInterval(seconds(10));
+    const Clock::time_point start(seconds(1000));
+    ASSERT_TRUE(writer.Open(start));
+    EXPECT_TRUE(writer.Write("a\n", 2, start));
+    EXPECT_TRUE(writer.Write("b\n", 2, start + seconds(5)));
+    writer.WaitIdle();
+    EXPECT_EQ(read_file(checkpoint), "2\n");
+    EXPECT_TRUE(writer.Write("c\n", 2, start + seconds(10)));
+    writer.WaitIdle();
+    EXPECT_EQ(read_file(checkpoint), "6\n");
+    writer.Close();
+    writer.WaitIdle();
+    EXPECT_FALSE(wxFileExists(checkpoint));
+    EXPECT_EQ(read_file(path), "a\nb\nc\n");
+  }
+  EXPECT_TRUE(RecordWriter::Recover(dir).empty());
+
+  // Partial line and zero filled blocks after the checkpoint are removed.
+  {
+    std::ofstream stream(path, std::ios::binary);
+    const std::string data("a\nb\nc\nd,partial\0\0\0\ne\n", 22);
+    stream << data;
+    std::ofstream(checkpoint) << "4\n";
+  }
+  auto recovered = RecordWriter::Recover(dir);
+  ASSERT_EQ(recovered.size(), 1u);
+  EXPECT_EQ(recovered[0].path, path);
+  EXPECT_EQ(recovered[0].size, 6u);
+  EXPECT_EQ(recovered[0].removed, 16u);
+  EXPECT_EQ(read_file(path), "a\nb\nc\n");
+  EXPECT_FALSE(wxFileExists(checkpoint));
+
+  // Invalid checkpoint, the whole file is checked.
+  {
+    std::ofstream(path, std::ios::binary) << "a\nb";
+    std::ofstream(checkpoint) << "garbage";
+  }
+  recovered = RecordWriter::Recover(dir);
+  ASSERT_EQ(recovered.size(), 1u);
+  EXPECT_EQ(read_file(path), "a\n");
+}
+
 /** Test recording NMEA0183 with pause. */
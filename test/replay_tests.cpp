@@ -0,0 +1,618 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "dm_converter.h"
+#include "dm_decoder.h"
+#include "dm_replay_mgr.h"
+#include "file_sniffer.h"
+#include "mock_plugin_api.h"
+#include "record_formatter.h"
+#include "replay_engine.h"
+#include "replay_fanout.h"
+#include "replay_stats.h"
+#include "vdr_network.h"
+
+/** Sink collecting delivered texts. */
+class CollectSink : public ReplaySink {
+public:
+  CollectSink(bool threaded, int delay_ms = 0)
+      : m_threaded(threaded), m_delay_ms(delay_ms), m_flushes(0) {}
+
+  const char* GetName() const override { return "collect"; }
+  bool IsThreaded() const override { return m_threaded; }
+
+  void Deliver(const ReplayMessage& msg) override {
+    if (m_delay_ms > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(m_delay_ms));
+    }
+    texts.push_back(msg.text);
+  }
+
+  void Flush() override { m_flushes++; }
+
+  std::vector<std::string> texts;
+
+private:
+  const bool m_threaded;
+  const int m_delay_ms;
+  int m_flushes;
+};
+
+static ReplayMessage MakeMessage(const std::string& line) {
+  ReplayMessage msg;
+  ParseReplayLine(line.c_str(), line.size(), msg);
+  return msg;
+}
+
+/** Test classification of recorded lines. */
+TEST(ReplayFanoutTest, ParseReplayLine) {
+  ReplayMessage msg = MakeMessage("$GPRMC,092750.000,A,5321.6802,N*43");
+  EXPECT_EQ(msg.type, ReplayMsgType::kNmea0183);
+  EXPECT_FALSE(msg.has_n2k);
+
+  msg = MakeMessage("{\"updates\":[]}");
+  EXPECT_EQ(msg.type, ReplayMsgType::kSignalK);
+
+  msg = MakeMessage("$PCDIN,01F801,00000000,0F,2AAF00D1067414FF*59");
+  EXPECT_EQ(msg.type, ReplayMsgType::kN2k);
+  ASSERT_TRUE(msg.has_n2k);
+  EXPECT_EQ(msg.n2k.pgn, 129025u);
+
+  msg = MakeMessage("$MXPGN,01F801,2801,C1");
+  EXPECT_EQ(msg.type, ReplayMsgType::kN2k);
+  EXPECT_FALSE(msg.has_n2k);
+}
+
+/** Round trip of a decoded message through AppendPcdin(). */
+TEST(ReplayFanoutTest, AppendPcdin) {
+  const char* line = "$PCDIN,01F801,00000000,0F,2AAF00D1067414FF*59";
+  N2kMessage n2k;
+  ASSERT_TRUE(ParsePcdin(line, std::strlen(line), n2k));
+  std::string out;
+  AppendPcdin(n2k, out);
+  EXPECT_EQ(out, line);
+}
+
+/** One loopback driver write per Data Monitor message, reusing payloads. */
+TEST(DataMonitorReplayTest, LoopbackSink) {
+  ClearDriverWrites();
+  LoopbackSink sink("loopback");
+  ReplayMessage msg = MakeMessage("$GPGGA,1");
+  sink.Deliver(msg);  // No msg_type, not from Data Monitor
+  EXPECT_TRUE(GetDriverWrites().empty());
+
+  msg.source = "src";
+  msg.msg_type = "GGA";
+  for (int i = 0; i < 40; i++) {
+    msg.text = "$GPGGA," + std::to_string(i);
+    sink.Deliver(msg);
+  }
+  const std::vector<std::string>& writes = GetDriverWrites();
+  ASSERT_EQ(writes.size(), 40u);
+  EXPECT_EQ(writes[0], "nmea0183 src GGA $GPGGA,0");
+  EXPECT_EQ(writes[39], "nmea0183 src GGA $GPGGA,39");
+
+  ReplayMessage n2k = MakeMessage("$PCDIN,129026,930D0202F801");
+  n2k.source = "can0";
+  n2k.msg_type = "129026";
+  n2k.text = "930D0202F801";
+  sink.Deliver(n2k);
+  ASSERT_EQ(writes.size(), 41u);
+  EXPECT_EQ(writes[40], "nmea2000 can0 129026 930D0202F801");
+  ClearDriverWrites();
+}
+
+/** All sinks, inline and threaded, get all messages in order. */
+TEST(ReplayFanoutTest, DeliverToAllSinks) {
+  ReplayFanout fanout;
+  auto inline_sink = std::make_shared<CollectSink>(false);
+  auto threaded_sink1 = std::make_shared<CollectSink>(true);
+  auto threaded_sink2 = std::make_shared<CollectSink>(true);
+  fanout.AddSink(inline_sink);
+  fanout.AddSink(threaded_sink1);
+  fanout.AddSink(threaded_sink2);
+
+  for (int i = 0; i < 1000; i++) {
+    fanout.Publish(MakeMessage("$GPTXT," + std::to_string(i)));
+    if (i % 10 == 9) fanout.EndBatch();
+  }
+  fanout.Stop();
+
+  for (const auto& sink : {inline_sink, threaded_sink1, threaded_sink2}) {
+    ASSERT_EQ(sink->texts.size(), 1000u);
+    EXPECT_EQ(sink->texts[0], "$GPTXT,0");
+    EXPECT_EQ(sink->texts[999], "$GPTXT,999");
+    EXPECT_EQ(sink->GetDropped(), 0u);
+  }
+}
+
+/** A slow sink loses messages but does not block producer or other sinks. */
+TEST(ReplayFanoutTest, SlowSinkDrops) {
+  ReplayFanout fanout(64);
+  auto slow_sink = std::make_shared<CollectSink>(true, 5);
+  auto fast_sink = std::make_shared<CollectSink>(false);
+  fanout.AddSink(slow_sink);
+  fanout.AddSink(fast_sink);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 1000; i++) {
+    fanout.Publish(MakeMessage("$GPTXT," + std::to_string(i)));
+  }
+  fanout.EndBatch();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  // 1000 messages at 5 ms each would take 5 s if the producer waited.
+  EXPECT_LT(elapsed, std::chrono::seconds(1));
+  fanout.Stop();
+
+  EXPECT_EQ(fast_sink->texts.size(), 1000u);
+  EXPECT_GT(slow_sink->GetDropped(), 0u);
+  EXPECT_EQ(slow_sink->texts.size() + slow_sink->GetDropped(), 1000u);
+  EXPECT_EQ(slow_sink->texts.back(), "$GPTXT,999");
+}
+
+/** With a latency bound, messages are delivered without EndBatch(). */
+TEST(ReplayFanoutTest, MaxLatencyDelivery) {
+  class CountSink : public ReplaySink {
+  public:
+    const char* GetName() const override { return "count"; }
+    void Deliver(const ReplayMessage&) override { count++; }
+    std::atomic<int> count{0};
+  };
+  ReplayFanout fanout;
+  fanout.SetMaxLatency(std::chrono::milliseconds(10));
+  auto sink = std::make_shared<CountSink>();
+  fanout.AddSink(sink);
+
+  fanout.Publish(MakeMessage("$GPTXT,live"));
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (sink->count == 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(sink->count, 1);
+  fanout.Stop();
+}
+
+/** Tiny rings are rounded up, latency can change while consuming. */
+TEST(ReplayFanoutTest, TinyCapacity) {
+  ReplayFanout fanout(1);
+  auto sink = std::make_shared<CollectSink>(true);
+  fanout.AddSink(sink);
+  fanout.SetMaxLatency(std::chrono::milliseconds(1));
+  for (int i = 0; i < 100; i++) {
+    fanout.Publish(MakeMessage("$GPTXT," + std::to_string(i)));
+  }
+  fanout.SetMaxLatency(std::chrono::milliseconds(0));
+  fanout.EndBatch();
+  fanout.Stop();
+  EXPECT_EQ(sink->texts.size() + sink->GetDropped(), 100u);
+  EXPECT_EQ(sink->texts.back(), "$GPTXT,99");
+}
+
+/** Slow network clients lose whole messages, never part of one. */
+TEST(ReplayFanoutTest, NetworkOutputBuffer) {
+  OutputBuffer out(10);
+  EXPECT_TRUE(out.Append("$A,1\r\n", 6));
+  EXPECT_FALSE(out.Append("$B,2\r\n", 6));
+  EXPECT_EQ(out.GetDropped(), 1u);
+  out.Consume(4);
+  ASSERT_EQ(out.GetSize(), 2u);
+  EXPECT_EQ(std::string(out.GetData(), 2), "\r\n");
+  EXPECT_TRUE(out.Append("$C,3\r\n", 6));
+  EXPECT_EQ(std::string(out.GetData(), out.GetSize()), "\r\n$C,3\r\n");
+  out.Consume(out.GetSize());
+  EXPECT_EQ(out.GetSize(), 0u);
+
+  // A message larger than the limit still gets through an empty buffer.
+  const std::string large(20, 'x');
+  EXPECT_TRUE(out.Append(large.data(), large.size()));
+  EXPECT_EQ(out.GetSize(), 20u);
+}
+
+/** Histogram buckets cover the value range with bounded relative error. */
+TEST(ReplayStatsTest, HistogramBuckets) {
+  for (uint64_t v : {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull,
+                     ~0ull}) {
+    const size_t idx = LatencyHistogram::BucketIndex(v);
+    ASSERT_LT(idx, LatencyHistogram::kBucketCount);
+    const uint64_t upper = LatencyHistogram::BucketUpperBound(idx);
+    EXPECT_GE(upper, v);
+    EXPECT_LE(upper - v, v / 8);
+    if (idx > 0) {
+      EXPECT_LT(LatencyHistogram::BucketUpperBound(idx - 1), v);
+    }
+  }
+
+  LatencyHistogram histogram;
+  for (uint64_t v = 1; v <= 1000; v++) histogram.Record(v * 1000);
+  EXPECT_EQ(histogram.GetCount(), 1000u);
+  EXPECT_EQ(histogram.GetMax(), 1000000u);
+  EXPECT_EQ(histogram.GetMean(), 500500u);
+  EXPECT_NEAR(histogram.GetPercentile(50), 500000.0, 500000.0 / 8);
+  EXPECT_NEAR(histogram.GetPercentile(99), 990000.0, 990000.0 / 8);
+  EXPECT_EQ(histogram.GetPercentile(100), 1000000u);
+}
+
+/** Lateness, early messages and JSON export. */
+TEST(ReplayStatsTest, ReplayStats) {
+  ReplayStats stats;
+  stats.RecordEmission(1000, 3000);
+  stats.RecordEmission(5000, 4000);
+  stats.RecordBatch(10);
+  stats.RecordTimerJitter(-5);
+  stats.SetDropped(7);
+  EXPECT_EQ(stats.GetLateness().GetCount(), 1u);
+  EXPECT_EQ(stats.GetLateness().GetMax(), 2000u);
+  EXPECT_EQ(stats.GetEarly(), 1u);
+  EXPECT_EQ(stats.GetTimerJitter().GetMax(), 0u);
+
+  const std::string json = stats.ToJson(10);
+  EXPECT_EQ(json.rfind("{\"speed\":10,\"lateness_us\":{\"count\":1,", 0),
+            0u);
+  EXPECT_NE(json.find("\"batch_size\":{\"count\":1,\"mean\":10,"),
+            std::string::npos);
+  EXPECT_NE(json.find("\"early\":1,\"dropped\":7}"), std::string::npos);
+
+  stats.Reset();
+  EXPECT_EQ(stats.GetLateness().GetCount(), 0u);
+  EXPECT_EQ(stats.GetDropped(), 0u);
+}
+
+/** Decoder replaying records "<n>" with stamp n * 10 at offset n * 100. */
+class CountingDecoder : public ReplayDecoder {
+public:
+  explicit CountingDecoder(int count) : m_count(count), m_next(0) {}
+
+  bool Open(uint64_t offset) override {
+    m_next = static_cast<int>((offset + 99) / 100);
+    return true;
+  }
+
+  bool Read(ReplayRecord& record) override {
+    if (m_next >= m_count) return false;
+    record.stamp = kStart + m_next * 10;
+    record.offset = m_next * 100;
+    const std::string text = std::to_string(m_next);
+    ParseReplayLine(text.c_str(), text.size(), record.msg);
+    m_next += 1;
+    return true;
+  }
+
+  uint64_t GetSize() const override { return m_count * 100; }
+
+  void Scan(const ScanVisitor& visitor) override {
+    for (int i = 0; i < m_count; i++) visitor(kStart + i * 10, i * 100);
+  }
+
+  static constexpr uint64_t kStart = 1736157600000;
+
+private:
+  const int m_count;
+  int m_next;
+};
+
+/** Timing follows speed changes and pauses without jumps. */
+TEST(ReplayEngineTest, Scheduler) {
+  using namespace std::chrono;
+  ReplayScheduler scheduler;
+  const auto t0 = ReplayScheduler::Clock::now();
+  EXPECT_EQ(scheduler.GetDueTime(1000, t0), t0);
+  EXPECT_EQ(scheduler.GetDueTime(2000, t0), t0 + seconds(1));
+
+  // At 0.5 s timestamp 1500 is played, 500 ms left at 10x is 50 ms.
+  scheduler.SetSpeed(10, t0 + milliseconds(500));
+  EXPECT_EQ(scheduler.GetDueTime(2000, t0), t0 + milliseconds(550));
+
+  // A 2 s pause delays everything 2 s.
+  scheduler.Pause(t0 + milliseconds(500));
+  scheduler.Resume(t0 + milliseconds(2500));
+  EXPECT_EQ(scheduler.GetDueTime(2000, t0), t0 + milliseconds(2550));
+
+  // Untimed records follow in batches of 10, every 100 ms at 10x.
+  for (unsigned i = 0; i < ReplayScheduler::kUntimedBatch; i++) {
+    EXPECT_EQ(scheduler.GetDueTime(0, t0), t0 + milliseconds(2550));
+  }
+  EXPECT_EQ(scheduler.GetDueTime(0, t0), t0 + milliseconds(2650));
+
+  scheduler.Reset();
+  EXPECT_EQ(scheduler.GetDueTime(0, t0), t0);
+  scheduler.Reset();
+  EXPECT_EQ(scheduler.GetDueTime(5000, t0), t0);
+}
+
+/** Play, seek and index using a synthetic decoder. */
+TEST(ReplayEngineTest, PlayAndSeek) {
+  ReplayFanout fanout;
+  auto sink = std::make_shared<CollectSink>(false);
+  fanout.AddSink(sink);
+  ReplayEngine engine(std::make_unique<CountingDecoder>(1000), fanout);
+  ASSERT_TRUE(engine.Open());
+  engine.SetSpeed(ReplayEngine::kMaxSpeed);
+  engine.Start();
+  int delay;
+  while ((delay = engine.Notify()) >= 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+  }
+  EXPECT_TRUE(engine.IsAtEnd());
+  ASSERT_EQ(sink->texts.size(), 1000u);
+  EXPECT_EQ(sink->texts[999], "999");
+  EXPECT_DOUBLE_EQ(engine.GetProgressFraction(), 1.0);
+
+  engine.BuildIndex();
+  EXPECT_EQ(engine.GetFirstTimestamp(), CountingDecoder::kStart);
+  EXPECT_EQ(engine.GetLastTimestamp(), CountingDecoder::kStart + 9990);
+
+  sink->texts.clear();
+  ASSERT_TRUE(engine.SeekToTimestamp(CountingDecoder::kStart + 4321));
+  EXPECT_TRUE(engine.IsPaused());
+  EXPECT_EQ(engine.GetCurrentTimestamp(), CountingDecoder::kStart + 4330);
+  engine.Start();
+  engine.Notify();
+  ASSERT_FALSE(sink->texts.empty());
+  EXPECT_EQ(sink->texts[0], "433");
+
+  engine.Pause();
+  ASSERT_TRUE(engine.SeekToFraction(0.5));
+  EXPECT_DOUBLE_EQ(engine.GetProgressFraction(), 0.5);
+}
+
+/** Appended and saved indexes work as the one built by Add(). */
+TEST(ReplayEngineTest, IndexFile) {
+  const uint64_t step = ReplayIndex::kInterval;
+  ReplayIndex chunk;
+  for (uint64_t i = 0; i < 10; ++i) chunk.Add(1000 + i, i * step);
+  ReplayIndex index;
+  index.Append(chunk, 0);
+  chunk.Clear();
+  for (uint64_t i = 0; i < 10; ++i) chunk.Add(2000 + i, i * step);
+  index.Append(chunk, 10 * step);
+  EXPECT_EQ(index.GetSize(), 20u);
+  EXPECT_EQ(index.GetFirstStamp(), 1000u);
+  EXPECT_EQ(index.GetLastStamp(), 2009u);
+  EXPECT_TRUE(index.IsChronological());
+  EXPECT_EQ(index.Lookup(2005), 14 * step);
+
+  const std::string path = std::string(CMAKE_BINARY_DIR) + "/replay.idx";
+  ASSERT_TRUE(index.Save(path, 20 * step));
+  ReplayIndex loaded;
+  EXPECT_FALSE(loaded.Load(path, 20 * step + 1));
+  EXPECT_EQ(loaded.GetSize(), 0u);
+  ASSERT_TRUE(loaded.Load(path, 20 * step));
+  EXPECT_EQ(loaded.GetSize(), 20u);
+  EXPECT_EQ(loaded.GetFirstStamp(), 1000u);
+  EXPECT_EQ(loaded.GetLastStamp(), 2009u);
+  EXPECT_EQ(loaded.Lookup(2005), 14 * step);
+
+  index.Append(chunk, 20 * step);
+  EXPECT_FALSE(index.IsChronological());
+}
+
+/** Conversion output does not depend on chunking and threads. */
+TEST(DataMonitorConverterTest, Convert) {
+  const std::string src = std::string(CMAKE_BINARY_DIR) + "/dm_convert.csv";
+  const std::string dest = std::string(CMAKE_BINARY_DIR) + "/dm_convert.vdr";
+  {
+    std::ofstream stream(src);
+    stream << "# timestamp_format: EPOCH_MILLIS\n"
+           << "received_at,protocol,msg_type,source,raw_data\n";
+    for (int i = 0; i < 200; ++i) {
+      stream << 1736157600000 + i << ",NMEA0183,RMC,s,\"$GPRMC," << i
+             << "\"\n"
+             << 1736157600000 + i << ",SignalK,delta,s,\"{\"\"v\"\":" << i
+             << "}\"\n"
+             << 1736157600000 + i << ",NMEA2000,129026,s,"
+             << "\"93 0D 02 02 F8 01 FF 03 00 00 00 00 01 2A\"\n"
+             << "bad,NMEA0183,RMC,s,\"$GPRMC\"\n";
+    }
+  }
+  std::string expected;
+  for (int threads : {1, 3}) {
+    DataMonitorConverter converter(src, dest,
+                                   [](VdrMsgType, const std::string&) {});
+    converter.SetThreads(threads);
+    converter.SetChunkSize(threads == 1 ? 1 << 20 : 1000);
+    ASSERT_TRUE(converter.Run());
+    EXPECT_EQ(converter.GetConverted(), 600u);
+    EXPECT_EQ(converter.GetSkipped(), 200u);
+    std::ifstream stream(dest);
+    std::stringstream text;
+    text << stream.rdbuf();
+    if (expected.empty()) expected = text.str();
+    EXPECT_EQ(text.str(), expected);
+
+    ReplayIndex index;
+    ASSERT_TRUE(index.Load(ReplayIndex::GetPath(dest), expected.size()));
+    EXPECT_EQ(index.GetSize(), 1u);
+    EXPECT_EQ(index.GetFirstStamp(), 1736157600000u);
+    EXPECT_EQ(index.GetLastStamp(), 1736157600199u);
+    EXPECT_TRUE(index.IsChronological());
+    EXPECT_EQ(index.Lookup(1736157600000), 0u);
+  }
+  std::istringstream lines(expected);
+  std::string line;
+  std::getline(lines, line);
+  EXPECT_EQ(line, "timestamp,type,id,message");
+  std::getline(lines, line);
+  EXPECT_EQ(line, "2025-01-06T10:00:00.000Z,NMEA0183,,\"$GPRMC,0\"");
+  std::getline(lines, line);
+  EXPECT_EQ(line, "2025-01-06T10:00:00.000Z,SignalK,,\"{\"\"v\"\":0}\"");
+  std::getline(lines, line);
+  EXPECT_EQ(line,
+            "2025-01-06T10:00:00.000Z,NMEA2000,129026,"
+            "930D0202F801FF0300000000012A");
+}
+
+/** Bad input and aborts fail the conversion, leaving dest untouched. */
+TEST(DataMonitorConverterTest, Failure) {
+  const std::string src = std::string(CMAKE_BINARY_DIR) + "/dm_bad.csv";
+  const std::string dest = std::string(CMAKE_BINARY_DIR) + "/dm_bad.vdr";
+  std::remove(dest.c_str());
+  {
+    std::ofstream stream(src);
+    stream << "time,what\n1,2\n";
+  }
+  DataMonitorConverter bad_header(src, dest,
+                                  [](VdrMsgType, const std::string&) {});
+  EXPECT_FALSE(bad_header.Run());
+  EXPECT_FALSE(bad_header.IsOk());
+  EXPECT_FALSE(std::ifstream(dest).good());
+
+  {
+    std::ofstream stream(src);
+    stream << "received_at,protocol,msg_type,source,raw_data\n"
+           << "1736157600000,NMEA0183,RMC,s,\"$GPRMC,0\"\n";
+  }
+  DataMonitorConverter aborted(src, dest,
+                               [](VdrMsgType, const std::string&) {});
+  aborted.Cancel();
+  EXPECT_FALSE(aborted.Run());
+  EXPECT_FALSE(std::ifstream(dest).good());
+}
+
+/** Rows are split without the CSV library, bad rows are reported. */
+TEST(DataMonitorDecoderTest, ReadRows) {
+  const std::string path = std::string(CMAKE_BINARY_DIR) + "/dm_rows.csv";
+  {
+    std::ofstream stream(path, std::ios::binary);
+    stream << "# Created at: Mon Jan  6 09:00:00 2025\n"
+           << "source, received_at,extra,protocol,msg_type,raw_data\r\n"
+           << "s1,100,x,NMEA0183,RMC, \"$GPRMC,1\" \r\n"
+           << "s2,101,x,NMEA0183\n"
+           << "s3,102,x,Unknown,X,data\n"
+           << "s4,103,x,SignalK,delta,\"{\"\"v\"\":1}\"\n"
+           << "s5,bad,x,NMEA2000,129026,93 0D";
+  }
+  EXPECT_GT(DataMonitorDecoder::ParseCreatedAt("x\n# Created at: Mon Jan  "
+                                               "6 09:00:00 2025\n"),
+            0u);
+  EXPECT_EQ(DataMonitorDecoder::ParseCreatedAt("# Created"), 0u);
+
+  FileSniff sniff;
+  ASSERT_TRUE(SniffFile(path, sniff));
+  int errors = 0;
+  DataMonitorDecoder decoder(sniff, [&](VdrMsgType type, const std::string&) {
+    if (type == VdrMsgType::kMessage) errors++;
+  });
+  ASSERT_TRUE(decoder.Open(0));
+  ReplayRecord record;
+  ASSERT_TRUE(decoder.Read(record));
+  EXPECT_EQ(record.stamp, 100u);
+  EXPECT_EQ(record.msg.type, ReplayMsgType::kNmea0183);
+  EXPECT_EQ(record.msg.source, "s1");
+  EXPECT_EQ(record.msg.msg_type, "RMC");
+  EXPECT_EQ(record.msg.text, "$GPRMC,1");
+  ASSERT_TRUE(decoder.Read(record));
+  EXPECT_EQ(errors, 1);
+  EXPECT_EQ(record.stamp, 103u);
+  EXPECT_EQ(record.msg.type, ReplayMsgType::kSignalK);
+  EXPECT_EQ(record.msg.text, "{\"v\":1}");
+  ASSERT_TRUE(decoder.Read(record));
+  EXPECT_EQ(record.stamp, 0u);
+  EXPECT_EQ(record.msg.type, ReplayMsgType::kN2k);
+  EXPECT_EQ(record.msg.text, "93 0D");
+  EXPECT_FALSE(decoder.Read(record));
+
+  // Starting mid-file uses the header from the head of the file.
+  ASSERT_TRUE(decoder.Open(record.offset));
+  ASSERT_TRUE(decoder.Read(record));
+  EXPECT_EQ(record.msg.source, "s5");
+}
+
+TEST(FileSnifferTest, ClassifyHead) {
+  EXPECT_EQ(ClassifyHead(""), VdrFileFormat::kEmpty);
+  EXPECT_EQ(ClassifyHead("# comment\n\n"), VdrFileFormat::kEmpty);
+  EXPECT_EQ(ClassifyHead(std::string("\x1f\x8b\x08\x00", 4)),
+            VdrFileFormat::kGzip);
+  EXPECT_EQ(ClassifyHead(std::string("BZh91AY", 7)),
+            VdrFileFormat::kCompressed);
+  EXPECT_EQ(ClassifyHead(std::string("$GPRMC\0,", 8)), VdrFileFormat::kBinary);
+  EXPECT_EQ(ClassifyHead("# timestamp_format: EPOCH_MILLIS\n"
+                         "received_at,protocol,msg_type,source,raw_data\n"),
+            VdrFileFormat::kDataMonitor);
+  EXPECT_EQ(ClassifyHead("Timestamp,type,id,Message\n"),
+            VdrFileFormat::kVdrCsv);
+  EXPECT_EQ(ClassifyHead("# Recorded\n  $GPRMC,1*00\r\n"),
+            VdrFileFormat::kRawNmea);
+  EXPECT_EQ(ClassifyHead("!AIVDM,1\n"), VdrFileFormat::kRawNmea);
+  EXPECT_EQ(ClassifyHead("hello,world\n"), VdrFileFormat::kUnknown);
+}
+
+TEST(FileSnifferTest, SniffFile) {
+  const std::string path = std::string(CMAKE_BINARY_DIR) + "/sniff.csv";
+  FileSniff sniff;
+  EXPECT_FALSE(SniffFile(path + ".missing", sniff));
+  {
+    std::ofstream stream(path);
+    stream << "\n# comment\ntimestamp,message\n2025-01-06T10:00:00Z,$GPRMC\n";
+  }
+  ASSERT_TRUE(SniffFile(path, sniff));
+  EXPECT_EQ(sniff.format, VdrFileFormat::kVdrCsv);
+  EXPECT_TRUE(sniff.IsComplete());
+  EXPECT_EQ(sniff.GetFirstDataLine(), "timestamp,message");
+  {
+    std::ofstream stream(path);
+    stream << "$GPRMC,1\n" << std::string(FileSniff::kHeadSize, 'x');
+  }
+  ASSERT_TRUE(SniffFile(path, sniff));
+  EXPECT_EQ(sniff.format, VdrFileFormat::kRawNmea);
+  EXPECT_EQ(sniff.head.size(), FileSniff::kHeadSize);
+  EXPECT_EQ(sniff.size, FileSniff::kHeadSize + 9);
+  EXPECT_FALSE(sniff.IsComplete());
+}
+
+TEST(RecordFormatterTest, Format) {
+  RecordFormatter formatter;
+  std::string out;
+  const std::string nmea = " $GPRMC,1*00\r\n";
+  formatter.AppendNmea0183Csv(1736157600123, nmea.data(), nmea.size(), out);
+  EXPECT_EQ(out, "2025-01-06T10:00:00.123Z,NMEA0183,,\"$GPRMC,1*00\"\n");
+  out.clear();
+  const std::string ais = "!AIVDM,1";
+  formatter.AppendNmea0183Csv(1736157601005, ais.data(), ais.size(), out);
+  EXPECT_EQ(out, "2025-01-06T10:00:01.005Z,AIS,,\"!AIVDM,1\"\n");
+  out.clear();
+  const std::string delta = "{\"v\":\n1}";
+  formatter.AppendSignalKCsv(1736157601005, delta.data(), delta.size(), out);
+  EXPECT_EQ(out, "2025-01-06T10:00:01.005Z,SignalK,,\"{\"\"v\"\": 1}\"\n");
+  out.clear();
+  formatter.AppendNmea0183Csv(0, "$GPTXT", 6, out);
+  EXPECT_EQ(out, "1970-01-01T00:00:00.000Z,NMEA0183,,$GPTXT\n");
+
+  const uint8_t payload[] = {0x93, 0x0d, 0x02, 0x02, 0xf8, 0x01};
+  out.clear();
+  formatter.AppendN2kCsv(1736157600000, 129026, payload, sizeof(payload), out);
+  EXPECT_EQ(out, "2025-01-06T10:00:00.000Z,NMEA2000,129026,930D0202F801\n");
+  out.clear();
+  RecordFormatter::AppendPcdin(129026, payload, sizeof(payload), out);
+  EXPECT_EQ(out, "$PCDIN,129026,930D0202F801\r\n");
+  out.clear();
+  RecordFormatter::AppendRawLine(nmea.data(), nmea.size(), out);
+  EXPECT_EQ(out, " $GPRMC,1*00\r\n");
+  out.clear();
+  RecordFormatter::AppendTagBlock(1736157600123, out);
+  EXPECT_EQ(out, "\\c:1736157600123*6F\\");
+}
@@ -0,0 +1,105 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+#include <cstring>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "speed_tracker.h"
+
+static bool ParseSog(const char* sentence, SpeedSource& source,
+                     double& knots) {
+  return ParseNmeaSog(sentence, std::strlen(sentence), source, knots);
+}
+
+/** Test speed from RMC and VTG sentences. */
+TEST(SpeedTrackerTest, ParseNmeaSog) {
+  SpeedSource source;
+  double knots = -1;
+  ASSERT_TRUE(ParseSog("$GPRMC,092750.000,A,5321.6802,N,00630.3372,W,"
+                       "12.25,54.7,191194,020.3,E*68\r\n",
+                       source, knots));
+  EXPECT_EQ(source, SpeedSource::kRmc);
+  EXPECT_DOUBLE_EQ(knots, 12.25);
+  ASSERT_TRUE(ParseSog("$GNRMC,,A,,,,,3", source, knots));
+  EXPECT_DOUBLE_EQ(knots, 3);
+
+  ASSERT_TRUE(ParseSog("$IIVTG,054.7,T,034.4,M,005.5,N,010.2,K*48", source,
+                       knots));
+  EXPECT_EQ(source, SpeedSource::kVtg);
+  EXPECT_DOUBLE_EQ(knots, 5.5);
+  ASSERT_TRUE(ParseSog("$GPVTG,054.7,034.4,0.5,1.0*48", source, knots));
+  EXPECT_DOUBLE_EQ(knots, 0.5);
+
+  knots = -1;
+  EXPECT_FALSE(ParseSog("$GPRMC,092750.000,V,,,,,0.0,,191194,,*00", source,
+                        knots));
+  EXPECT_FALSE(ParseSog("$GPRMC,092750.000,A,,,,,,,191194,,*00", source,
+                        knots));
+  EXPECT_FALSE(ParseSog("$GPRMC,092750.000,A,,,,,1e3,", source, knots));
+  EXPECT_FALSE(ParseSog("$GPRMC,092750.000,A,,,,", source, knots));
+  EXPECT_FALSE(ParseSog("$GPGGA,092750.000,5321.6802,N", source, knots));
+  EXPECT_FALSE(ParseSog("$PGRMCX,1,2,3,4,5,6,7", source, knots));
+  EXPECT_FALSE(ParseSog("!AIVDM,1,1,,A,13Hj5J7000Od<fdKQJ3Iw`S>28FK,0*27",
+                        source, knots));
+  EXPECT_DOUBLE_EQ(knots, -1);
+}
+
+/** Test the sentence type check, on raw and string sentences. */
+TEST(SpeedTrackerTest, IsNmeaSogSentence) {
+  EXPECT_TRUE(IsNmeaSogSentence("$GPRMC,", 7));
+  EXPECT_TRUE(IsNmeaSogSentence("$IIVTG", 6));
+  EXPECT_FALSE(IsNmeaSogSentence("$IIVT", 5));
+  EXPECT_FALSE(IsNmeaSogSentence("!AIVTG,", 7));
+  const std::string rmc("$GNRMC,,A,,,,,3");
+  EXPECT_TRUE(IsNmeaSogSentence(rmc, rmc.size()));
+  const std::string gga("$GPGGA,092750.000");
+  EXPECT_FALSE(IsNmeaSogSentence(gga, gga.size()));
+  const std::string proprietary("$PGRMCX,1");
+  EXPECT_FALSE(IsNmeaSogSentence(proprietary, proprietary.size()));
+}
+
+/** Test speed from PGN 129026 payloads. */
+TEST(SpeedTrackerTest, ParseN2kSog) {
+  uint8_t payload[19] = {0x93, 0x13, 0x02, 0x02, 0xf8, 0x01, 0xff, 0x03,
+                         0, 0, 0, 0x2a, 0, 0xff, 0xff, 0, 0, 0, 0};
+  payload[17] = 0xf4;  // 5 m/s
+  payload[18] = 0x01;
+  double knots = -1;
+  ASSERT_TRUE(ParseN2kSog(payload, sizeof(payload), knots));
+  EXPECT_NEAR(knots, 5 * 1.94384, 1e-9);
+  EXPECT_FALSE(ParseN2kSog(payload, sizeof(payload) - 1, knots));
+  payload[17] = 0xff;
+  payload[18] = 0xff;
+  EXPECT_FALSE(ParseN2kSog(payload, sizeof(payload), knots));
+}
+
+/** The current source is kept until it times out. */
+TEST(SpeedTrackerTest, SourceSelection) {
+  using std::chrono::seconds;
+  SpeedTracker tracker;
+  EXPECT_FALSE(tracker.HasSpeed());
+  const SpeedTracker::Clock::time_point start;
+  EXPECT_TRUE(tracker.Update(SpeedSource::kN2kCogSog, 4, start));
+  EXPECT_FALSE(tracker.Update(SpeedSource::kRmc, 6, start + seconds(1)));
+  EXPECT_TRUE(tracker.Update(SpeedSource::kN2kCogSog, 5, start + seconds(2)));
+  EXPECT_DOUBLE_EQ(tracker.GetSpeed(), 5);
+  EXPECT_FALSE(tracker.Update(SpeedSource::kRmc, 6, start + seconds(6)));
+  EXPECT_TRUE(tracker.Update(SpeedSource::kRmc, 6, start + seconds(7)));
+  EXPECT_EQ(tracker.GetSource(), SpeedSource::kRmc);
+  EXPECT_DOUBLE_EQ(tracker.GetSpeed(), 6);
+}
@@ -314,6 +314,61 @@ TEST_F(VDRTimeTest, CSVParsingISO8601) {
   EXPECT_EQ(timestamp.GetMillisecond(), 0);
 }
 
+/** Test parsing of NMEA 4.x tag blocks with receive time. */
+TEST_F(VDRTimeTest, TagBlockParsing) {
+  TagBlock tag;
+  EXPECT_FALSE(TimestampParser::ParseTagBlock("$GPGGA,1*00", tag));
+  EXPECT_FALSE(TimestampParser::ParseTagBlock("\\c:1736157600123*6F", tag));
+
+  // Milliseconds, as written by the recorder.
+  const wxString ais = "!AIVDM,1,1,,A,13u?etPv2;0n:dDPwUM1U1Cb069D,0*23";
+  EXPECT_TRUE(TimestampParser::ParseTagBlock("\\c:1736157600123*6F\\" + ais,
+                                             tag));
+  EXPECT_EQ(tag.length, 20u);
+  EXPECT_TRUE(tag.has_time);
+  EXPECT_EQ(tag.ms, 1736157600123u);
+  EXPECT_EQ(tag.precision, 3);
+
+  // Seconds, with other parameters.
+  EXPECT_TRUE(
+      TimestampParser::ParseTagBlock("\\s:r003669945,c:1241544035*79\\", tag));
+  EXPECT_TRUE(tag.has_time);
+  EXPECT_EQ(tag.ms, 1241544035000u);
+  EXPECT_EQ(tag.precision, 0);
+
+  // Bad checksum, or no time.
+  EXPECT_TRUE(TimestampParser::ParseTagBlock("\\c:1736157600123*6E\\", tag));
+  EXPECT_EQ(tag.length, 20u);
+  EXPECT_FALSE(tag.has_time);
+  EXPECT_TRUE(TimestampParser::ParseTagBlock("\\s:r003669945\\", tag));
+  EXPECT_FALSE(tag.has_time);
+
+  // Tag block time is used ahead of the sentence time, also for AIS.
+  const wxString rmc =
+      "$GPRMC,100000.12,A,5759.09700,N,01144.34344,E,5.257,28.27,060125,,,A*52";
+  wxDateTime expected;
+  ASSERT_TRUE(TimestampParser::ParseIso8601Timestamp(
+      "2025-01-06T10:00:00.123Z", &expected));
+  wxDateTime timestamp;
+  int precision;
+  EXPECT_TRUE(parser.ParseTimestamp("\\c:1736157600123*6F\\" + ais,
+                                    timestamp, precision));
+  EXPECT_EQ(timestamp, expected);
+  EXPECT_EQ(precision, 3);
+  EXPECT_TRUE(parser.ParseTimestamp("\\c:1736157000000*69\\" + rmc,
+                                    timestamp, precision));
+  EXPECT_EQ(timestamp, expected - wxTimeSpan::Milliseconds(600123));
+
+  // Other primary time source, the sentence is parsed.
+  parser.SetPrimaryTimeSource("GP", "RMC", 2);
+  EXPECT_FALSE(parser.ParseTimestamp("\\c:1736157600123*6F\\" + ais,
+                                     timestamp, precision));
+  EXPECT_TRUE(parser.ParseTimestamp("\\c:1736157000000*69\\" + rmc,
+                                    timestamp, precision));
+  EXPECT_EQ(timestamp, expected - wxTimeSpan::Milliseconds(3));
+  EXPECT_EQ(precision, 2);
+}
+
 TEST(TimestampParserTests, ParseISO8601) {
   TimestampParser parser;
   for (int i = 0; i < 24; i++) {
@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   Copyright (C) 2025 by the vdr_pi authors                              *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <https://www.gnu.org/licenses/>. *
+ **************************************************************************/
+
+/**
+ * \file
+ *
+ * dm2vdr: convert a Data Monitor VDR mode log to a VDR CSV recording.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <wx/string.h>
+
+#include "dm_converter.h"
+#include "file_path.h"
+
+static const char* const kUsage =
+    "Usage: dm2vdr [-j threads] [-v] <data monitor log> <vdr csv file>\n"
+    "Convert a Data Monitor VDR mode log to a VDR plugin CSV recording.\n"
+    "A seek index is written to <vdr csv file>.idx.\n";
+
+/** Return file name in the encoding expected by the converter. */
+static std::string ArgPath(const char* arg) {
+#ifdef _WIN32
+  // Arguments are in the ANSI code page, file names are UTF-8 on Windows.
+  return ToFilePath(wxString(arg, wxConvLocal));
+#else
+  return arg;
+#endif
+}
+
+int main(int argc, char** argv) {
+  unsigned threads = 0;
+  bool verbose = false;
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+    if (std::strcmp(argv[arg], "-j") == 0 && arg + 1 < argc) {
+      threads = static_cast<unsigned>(std::atoi(argv[++arg]));
+    } else if (std::strcmp(argv[arg], "-v") == 0) {
+      verbose = true;
+    } else {
+      std::cerr << kUsage;
+      return 1;
+    }
+  }
+  if (argc - arg != 2) {
+    std::cerr << kUsage;
+    return 1;
+  }
+  const std::string src = ArgPath(argv[arg]);
+  const std::string dest = ArgPath(argv[arg + 1]);
+  if (!DataMonitorDecoder::IsVdrFormat(src)) {
+    std::cerr << src << ": Not a Data Monitor VDR mode log\n";
+    return 1;
+  }
+
+  DataMonitorConverter converter(
+      src, dest, [verbose](VdrMsgType type, const std::string& msg) {
+        if (verbose || type != VdrMsgType::kDebug) std::cerr << msg << "\n";
+      });
+  converter.SetThreads(threads);
+  if (!converter.Run()) {
+    std::cerr << "Conversion failed\n";
+    return 2;
+  }
+  std::cout << "Converted " << converter.GetConverted() << " records, skipped "
+            << converter.GetSkipped() << "\n";
+  return 0;
+}